@@ -5,7 +5,10 @@
 #include <bench/bench.h>
 
 #include <clientversion.h>
+#include <crypto/Lyra2RE/Lyra2RE.h>
+#include <crypto/scrypt.h>
 #include <crypto/sha256.h>
+#include <crypto/sha3.h>
 #include <fs.h>
 #include <util/strencodings.h>
 #include <util/system.h>
@@ -49,6 +52,9 @@ int main(int argc, char** argv)
     ArgsManager argsman;
     SetupBenchArgs(argsman);
     SHA256AutoDetect();
+    SHA3AutoDetect();
+    Lyra2AutoDetect();
+    ScryptAutoDetect();
     std::string error;
     if (!argsman.ParseParameters(argc, argv, error)) {
         tfm::format(std::cerr, "Error parsing command line arguments: %s\n", error);
@@ -0,0 +1,378 @@
+// Copyright (c) 2021 The Vertcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <crypto/Lyra2RE/Lyra2RE.h>
+#include <crypto/scrypt.h>
+#include <crypto/verthash.h>
+#include <crypto/verthash_datfile.h>
+#include <pow.h>
+#include <random.h>
+#include <test/util/setup_common.h>
+#include <uint256.h>
+#include <util/system.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+/* Number of headers hashed per iteration by the batch and multi-threaded benches */
+static const size_t BATCH_SIZE = 64;
+/* Size of the synthetic datafile. Large enough that the lookups miss the caches,
+ * small enough to write for every run instead of needing the 1.2 GB file. */
+static const size_t SYNTHETIC_DATFILE_SIZE = 64 << 20;
+
+static std::vector<std::vector<unsigned char>> RandomHeaders(size_t count)
+{
+    FastRandomContext rng(/* fDeterministic */ true);
+    std::vector<std::vector<unsigned char>> headers;
+    for (size_t i = 0; i < count; i++) headers.push_back(rng.randbytes(80));
+    return headers;
+}
+
+/** Runs a bench with a datadir holding a synthetic verthash.dat */
+class VerthashSetup
+{
+    const std::unique_ptr<const BasicTestingSetup> m_testing_setup{MakeNoLogFileContext<const BasicTestingSetup>()};
+
+public:
+    VerthashSetup()
+    {
+        FastRandomContext rng(/* fDeterministic */ true);
+        const std::vector<unsigned char> data = rng.randbytes(SYNTHETIC_DATFILE_SIZE);
+        FILE* file = fsbridge::fopen(gArgs.GetDataDirNet() / "verthash.dat", "wb");
+        assert(file != nullptr);
+        const size_t written = fwrite(data.data(), 1, data.size(), file);
+        assert(written == data.size());
+        fclose(file);
+    }
+    ~VerthashSetup() { Verthash::Unload(); }
+};
+
+static void VerthashInRam(benchmark::Bench& bench)
+{
+    const VerthashSetup setup;
+    Verthash::LoadInRam();
+    const auto headers = RandomHeaders(1);
+    uint256 hash;
+    bench.unit("header").run([&] {
+        Verthash::Hash((const char*)headers[0].data(), (char*)hash.begin());
+    });
+}
+
+static void VerthashDiskOnly(benchmark::Bench& bench)
+{
+    const VerthashSetup setup;
+    Verthash::OpenFile();
+    const auto headers = RandomHeaders(1);
+    uint256 hash;
+    bench.unit("header").run([&] {
+        Verthash::Hash((const char*)headers[0].data(), (char*)hash.begin());
+    });
+}
+
+static void VerthashBatch(benchmark::Bench& bench)
+{
+    const VerthashSetup setup;
+    Verthash::LoadInRam();
+    const auto headers = RandomHeaders(BATCH_SIZE);
+    std::vector<const char*> inputs;
+    for (const auto& header : headers) inputs.push_back((const char*)header.data());
+    std::vector<uint256> hashes(BATCH_SIZE);
+    bench.batch(BATCH_SIZE).unit("header").run([&] {
+        Verthash::HashBatch(inputs, hashes);
+    });
+}
+
+/** Hash BATCH_SIZE headers per thread on every core, as a miner or a parallel
+ *  header check would */
+static void RunMultiThreaded(benchmark::Bench& bench, void (*hash)(const char*, char*))
+{
+    const size_t threads = std::max(GetNumCores(), 1);
+    const auto headers = RandomHeaders(BATCH_SIZE);
+    bench.batch(BATCH_SIZE * threads).unit("header").run([&] {
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; t++) {
+            workers.emplace_back([&] {
+                uint256 result;
+                for (const auto& header : headers) hash((const char*)header.data(), (char*)result.begin());
+            });
+        }
+        for (std::thread& worker : workers) worker.join();
+    });
+}
+
+static void VerthashMultiThreaded(benchmark::Bench& bench)
+{
+    const VerthashSetup setup;
+    Verthash::LoadInRam();
+    RunMultiThreaded(bench, Verthash::Hash);
+}
+
+/** Runs the calling thread on the CPUs of one NUMA node while in scope.
+ *  Does nothing where the nodes are unknown. */
+class NumaNodePin
+{
+#ifdef __linux__
+    cpu_set_t m_previous;
+    bool m_pinned{false};
+#endif
+
+public:
+    explicit NumaNodePin(const std::vector<int>& cpus)
+    {
+#ifdef __linux__
+        if (cpus.empty() || sched_getaffinity(0, sizeof(m_previous), &m_previous) != 0) return;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) CPU_SET(cpu, &set);
+        m_pinned = sched_setaffinity(0, sizeof(set), &set) == 0;
+#endif
+    }
+    ~NumaNodePin()
+    {
+#ifdef __linux__
+        if (m_pinned) sched_setaffinity(0, sizeof(m_previous), &m_previous);
+#endif
+    }
+};
+
+/** Hash on the last NUMA node with the datafile loaded from the first one,
+ *  optionally placed with the given policy. On a single node system all
+ *  variants read local memory. */
+static void VerthashNuma(benchmark::Bench& bench, bool remote, Verthash::NumaPolicy policy)
+{
+    const VerthashSetup setup;
+    const auto nodes = Verthash::GetNumaNodes();
+    const std::vector<int> first = nodes.empty() ? std::vector<int>{} : nodes.begin()->second;
+    const std::vector<int> last = nodes.empty() ? std::vector<int>{} : nodes.rbegin()->second;
+    {
+        // Reading the file in touches its pages first, which places them
+        const NumaNodePin pin(first);
+        Verthash::LoadInRam();
+    }
+    Verthash::PlaceOnNumaNodes(policy);
+    const NumaNodePin pin(remote ? last : first);
+    const auto headers = RandomHeaders(1);
+    uint256 hash;
+    bench.unit("header").run([&] {
+        Verthash::Hash((const char*)headers[0].data(), (char*)hash.begin());
+    });
+}
+
+static void VerthashNumaLocal(benchmark::Bench& bench)
+{
+    VerthashNuma(bench, /* remote */ false, Verthash::NumaPolicy::NONE);
+}
+
+static void VerthashNumaRemote(benchmark::Bench& bench)
+{
+    VerthashNuma(bench, /* remote */ true, Verthash::NumaPolicy::NONE);
+}
+
+static void VerthashNumaRemoteInterleaved(benchmark::Bench& bench)
+{
+    VerthashNuma(bench, /* remote */ true, Verthash::NumaPolicy::INTERLEAVE);
+}
+
+static void VerthashNumaRemoteReplicated(benchmark::Bench& bench)
+{
+    VerthashNuma(bench, /* remote */ true, Verthash::NumaPolicy::REPLICATE);
+}
+
+static void VerthashDatFileGeneration(benchmark::Bench& bench, int threads)
+{
+    const auto testing_setup = MakeNoLogFileContext<const BasicTestingSetup>();
+    const fs::path path = gArgs.GetDataDirNet() / "graph.dat";
+    // A graph of index 10 is about 3.5 MB; mainnet's index 17 is 1.2 GB
+    bench.unit("datfile").run([&] {
+        VerthashDatFile::GenerateDataFile(path, 10, threads);
+    });
+}
+
+static void VerthashDatFileGeneration1Thread(benchmark::Bench& bench)
+{
+    VerthashDatFileGeneration(bench, 1);
+}
+
+static void VerthashDatFileGenerationAllThreads(benchmark::Bench& bench)
+{
+    VerthashDatFileGeneration(bench, std::max(GetNumCores(), 1));
+}
+
+static void RunSingle(benchmark::Bench& bench, void (*hash)(const char*, char*))
+{
+    const auto headers = RandomHeaders(1);
+    uint256 result;
+    bench.unit("header").run([&] {
+        hash((const char*)headers[0].data(), (char*)result.begin());
+    });
+}
+
+static void RunBatch(benchmark::Bench& bench, void (*batch)(const char* const*, char* const*, size_t))
+{
+    const auto headers = RandomHeaders(BATCH_SIZE);
+    std::vector<uint256> hashes(BATCH_SIZE);
+    std::vector<const char*> inputs;
+    std::vector<char*> outputs;
+    for (size_t i = 0; i < BATCH_SIZE; i++) {
+        inputs.push_back((const char*)headers[i].data());
+        outputs.push_back((char*)hashes[i].begin());
+    }
+    bench.batch(BATCH_SIZE).unit("header").run([&] {
+        batch(inputs.data(), outputs.data(), BATCH_SIZE);
+    });
+}
+
+static void Lyra2RE(benchmark::Bench& bench)
+{
+    RunSingle(bench, lyra2re_hash);
+}
+
+static void Lyra2REv2(benchmark::Bench& bench)
+{
+    RunSingle(bench, lyra2re2_hash);
+}
+
+static void Lyra2REv2Batch(benchmark::Bench& bench)
+{
+    RunBatch(bench, lyra2re2_hash_batch);
+}
+
+static void Lyra2REv2MultiThreaded(benchmark::Bench& bench)
+{
+    RunMultiThreaded(bench, lyra2re2_hash);
+}
+
+static void Lyra2REv3(benchmark::Bench& bench)
+{
+    RunSingle(bench, lyra2re3_hash);
+}
+
+static void Lyra2REv3Batch(benchmark::Bench& bench)
+{
+    RunBatch(bench, lyra2re3_hash_batch);
+}
+
+static void Lyra2REv3MultiThreaded(benchmark::Bench& bench)
+{
+    RunMultiThreaded(bench, lyra2re3_hash);
+}
+
+static void ScryptN(benchmark::Bench& bench)
+{
+    RunSingle(bench, [](const char* input, char* output) { scrypt_N_1_1_256(input, output, 10); });
+}
+
+static void ScryptNBatch(benchmark::Bench& bench)
+{
+    RunBatch(bench, [](const char* const* inputs, char* const* outputs, size_t count) {
+        scrypt_N_1_1_256_batch(inputs, outputs, count, 10);
+    });
+}
+
+static void ScryptNMultiThreaded(benchmark::Bench& bench)
+{
+    RunMultiThreaded(bench, [](const char* input, char* output) { scrypt_N_1_1_256(input, output, 10); });
+}
+
+static void KimotoGravityWellWeek(benchmark::Bench& bench)
+{
+    const auto chain_params = CreateChainParams(ArgsManager{}, CBaseChainParams::MAIN);
+    // Blocks exactly on target never cross the event horizon, so every
+    // call reads the full week of blocks KGW looks back at
+    std::vector<CBlockIndex> blocks(5000);
+    for (size_t i = 0; i < blocks.size(); i++) {
+        blocks[i].pprev = i ? &blocks[i - 1] : nullptr;
+        blocks[i].nHeight = 2000000 + i;
+        blocks[i].nTime = 1600000000 + i * 150;
+        blocks[i].nBits = 0x1b0ffff0;
+    }
+    CBlockHeader header;
+    bench.unit("block").run([&] {
+        const unsigned int bits = KimotoGravityWell(&blocks.back(), &header, 150, 144, 4032, chain_params->GetConsensus());
+        ankerl::nanobench::doNotOptimizeAway(bits);
+    });
+}
+
+/** KGW for each new header of a synced chain, which reuses the window of its parent */
+static void KimotoGravityWellHeaderSync(benchmark::Bench& bench)
+{
+    const auto chain_params = CreateChainParams(ArgsManager{}, CBaseChainParams::MAIN);
+    FastRandomContext rng(/* fDeterministic */ true);
+    std::vector<CBlockIndex> blocks(5000);
+    std::vector<uint256> hashes(blocks.size());
+    for (size_t i = 0; i < blocks.size(); i++) {
+        hashes[i] = rng.rand256();
+        blocks[i].phashBlock = &hashes[i];
+        blocks[i].pprev = i ? &blocks[i - 1] : nullptr;
+        blocks[i].nHeight = 2000000 + i;
+        blocks[i].nTime = 1600000000 + i * 150;
+        blocks[i].nBits = 0x1b0ffff0;
+    }
+    CBlockHeader header;
+    bench.batch(1000).unit("block").run([&] {
+        for (size_t i = blocks.size() - 1000; i < blocks.size(); i++) {
+            const unsigned int bits = KimotoGravityWell(&blocks[i], &header, 150, 144, 4032, chain_params->GetConsensus());
+            ankerl::nanobench::doNotOptimizeAway(bits);
+        }
+    });
+}
+
+/** KGW alternating between the headers of two forks, as getblocktemplate
+ *  during header sync or competing forks do, each reusing its own window */
+static void KimotoGravityWellAlternatingTips(benchmark::Bench& bench)
+{
+    const auto chain_params = CreateChainParams(ArgsManager{}, CBaseChainParams::MAIN);
+    FastRandomContext rng(/* fDeterministic */ true);
+    // A chain of 5000 blocks and a fork of 1000 blocks off its 4000th
+    std::vector<CBlockIndex> blocks(6000);
+    std::vector<uint256> hashes(blocks.size());
+    for (size_t i = 0; i < blocks.size(); i++) {
+        hashes[i] = rng.rand256();
+        blocks[i].phashBlock = &hashes[i];
+        blocks[i].pprev = i == 5000 ? &blocks[3999] : i ? &blocks[i - 1] : nullptr;
+        blocks[i].nHeight = blocks[i].pprev ? blocks[i].pprev->nHeight + 1 : 2000000;
+        // Block times spread like on mainnet, so KGW stops at the event horizon
+        blocks[i].nTime = blocks[i].pprev ? blocks[i].pprev->nTime + rng.randrange(300) : 1600000000;
+        blocks[i].nBits = 0x1b0ffff0;
+    }
+    CBlockHeader header;
+    bench.batch(2000).unit("block").run([&] {
+        for (size_t i = 0; i < 1000; i++) {
+            ankerl::nanobench::doNotOptimizeAway(KimotoGravityWell(&blocks[4000 + i], &header, 150, 144, 4032, chain_params->GetConsensus()));
+            ankerl::nanobench::doNotOptimizeAway(KimotoGravityWell(&blocks[5000 + i], &header, 150, 144, 4032, chain_params->GetConsensus()));
+        }
+    });
+}
+
+BENCHMARK(VerthashInRam);
+BENCHMARK(VerthashDiskOnly);
+BENCHMARK(VerthashBatch);
+BENCHMARK(VerthashMultiThreaded);
+BENCHMARK(VerthashNumaLocal);
+BENCHMARK(VerthashNumaRemote);
+BENCHMARK(VerthashNumaRemoteInterleaved);
+BENCHMARK(VerthashNumaRemoteReplicated);
+BENCHMARK(VerthashDatFileGeneration1Thread);
+BENCHMARK(VerthashDatFileGenerationAllThreads);
+BENCHMARK(Lyra2RE);
+BENCHMARK(Lyra2REv2);
+BENCHMARK(Lyra2REv2Batch);
+BENCHMARK(Lyra2REv2MultiThreaded);
+BENCHMARK(Lyra2REv3);
+BENCHMARK(Lyra2REv3Batch);
+BENCHMARK(Lyra2REv3MultiThreaded);
+BENCHMARK(ScryptN);
+BENCHMARK(ScryptNBatch);
+BENCHMARK(ScryptNMultiThreaded);
+BENCHMARK(KimotoGravityWellWeek);
+BENCHMARK(KimotoGravityWellHeaderSync);
+BENCHMARK(KimotoGravityWellAlternatingTips);
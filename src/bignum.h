@@ -10,6 +10,7 @@
 #define BITCOIN_BIGNUM_H
 
 #include "serialize.h"
+#include "uint256.h"
 #include "version.h"
 
 #include <stdexcept>
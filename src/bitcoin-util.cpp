@@ -12,13 +12,15 @@
 #include <chainparamsbase.h>
 #include <clientversion.h>
 #include <core_io.h>
+#include <crypto/verthash.h>
+#include <powsearch.h>
 #include <streams.h>
 #include <util/system.h>
 #include <util/translation.h>
 
-#include <atomic>
 #include <cstdio>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <thread>
 
@@ -33,6 +35,10 @@ static void SetupBitcoinUtilArgs(ArgsManager &argsman)
     SetupHelpOptions(argsman);
 
     argsman.AddArg("-version", "Print version and exit", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-datadir=<dir>", "Specify data directory, where grind finds the Verthash datafile", ArgsManager::ALLOW_ANY | ArgsManager::DISALLOW_NEGATION, OptionsCategory::OPTIONS);
+    argsman.AddArg("-verthashfile=<file>", strprintf("Verthash datafile for grind. Relative paths are prefixed by a net-specific datadir location. (default: %s)", DEFAULT_VERTHASH_FILE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-height=<n>", "Height of the header to grind, which selects its proof of work algorithm (default: the height of the chain's last algorithm change)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-threads=<n>", "Number of threads to grind on (default: one per core)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 
     argsman.AddCommand("grind", "Perform proof of work on hex header string");
 
@@ -82,32 +88,6 @@ static int AppInitUtil(ArgsManager& args, int argc, char* argv[])
     return CONTINUE_EXECUTION;
 }
 
-static void grind_task(uint32_t nBits, CBlockHeader& header_orig, uint32_t offset, uint32_t step, std::atomic<bool>& found)
-{
-    arith_uint256 target;
-    bool neg, over;
-    target.SetCompact(nBits, &neg, &over);
-    if (target == 0 || neg || over) return;
-    CBlockHeader header = header_orig; // working copy
-    header.nNonce = offset;
-
-    uint32_t finish = std::numeric_limits<uint32_t>::max() - step;
-    finish = finish - (finish % step) + offset;
-
-    while (!found && header.nNonce < finish) {
-        const uint32_t next = (finish - header.nNonce < 5000*step) ? finish : header.nNonce + 5000*step;
-        do {
-            if (UintToArith256(header.GetHash()) <= target) {
-                if (!found.exchange(true)) {
-                    header_orig.nNonce = header.nNonce;
-                }
-                return;
-            }
-            header.nNonce += step;
-        } while(header.nNonce != next);
-    }
-}
-
 static int Grind(const std::vector<std::string>& args, std::string& strPrint)
 {
     if (args.size() != 1) {
@@ -121,18 +101,27 @@ static int Grind(const std::vector<std::string>& args, std::string& strPrint)
         return EXIT_FAILURE;
     }
 
-    uint32_t nBits = header.nBits;
-    std::atomic<bool> found{false};
-
-    std::vector<std::thread> threads;
-    int n_tasks = std::max(1u, std::thread::hardware_concurrency());
-    for (int i = 0; i < n_tasks; ++i) {
-        threads.emplace_back( grind_task, nBits, std::ref(header), i, n_tasks, std::ref(found) );
+    // The header does not tell its height, which selects the algorithm that
+    // consensus checks the proof of work with
+    const Consensus::Params& consensus = Params().GetConsensus();
+    const int height = gArgs.GetIntArg("-height", consensus.powAlgorithmSchedule.back().height);
+    if (height < 0) {
+        strPrint = "Height must not be negative";
+        return EXIT_FAILURE;
     }
-    for (auto& t : threads) {
-        t.join();
+    if (consensus.GetPoWAlgorithm(height) == Consensus::PoWAlgorithm::VERTHASH) {
+        if (!CheckDataDirOption()) {
+            strPrint = strprintf("Specified data directory \"%s\" does not exist.", gArgs.GetArg("-datadir", ""));
+            return EXIT_FAILURE;
+        }
+        Verthash::LoadInRam();
     }
-    if (!found) {
+
+    const int threads = gArgs.GetIntArg("-threads", std::max(1u, std::thread::hardware_concurrency()));
+    header.nNonce = 0;
+    const PoWSearchResult result{SearchNonce(header, height, std::numeric_limits<uint64_t>::max(), std::max(threads, 1))};
+    tfm::format(std::cerr, "Hashed %u nonces in %.3fs (%.1f hashes/s)\n", result.hashes, result.seconds, result.HashRate());
+    if (!result.found) {
         strPrint = "Could not satisfy difficulty target";
         return EXIT_FAILURE;
     }
@@ -141,6 +141,13 @@ enum BlockStatus : uint32_t {
      * on a background chainstate. See `doc/assumeutxo.md`.
      */
     BLOCK_ASSUMED_VALID      =   256,
+
+    /**
+     * If set, the proof of work of this header or of one of its ancestors was
+     * not checked, and is left to a checkpoint the header's chain leads to. Its
+     * work counts toward nothing until that checkpoint is accepted.
+     */
+    BLOCK_POW_PENDING        =   512,
 };
 
 /** The block chain is a tree shaped structure starting with the
@@ -7,6 +7,7 @@
 
 #include <chainparamsseeds.h>
 #include <consensus/merkle.h>
+#include <crypto/verthash.h> // for VERTHASH_FORKBLOCK_*
 #include <deploymentinfo.h>
 #include <hash.h> // for signet block challenge hash
 #include <util/system.h>
@@ -78,6 +79,14 @@ public:
         consensus.powLimit = uint256S("0007ffffffffffffffffffffffffffffffffffffffffffffffffffffffffff80");
         // Value for previous forks
         consensus.preVerthashPowLimit = uint256S("00000fffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
+        consensus.powAlgorithmSchedule = {
+            {0, Consensus::PoWAlgorithm::SCRYPT_N},
+            {208301, Consensus::PoWAlgorithm::LYRA2RE},
+            {347000, Consensus::PoWAlgorithm::LYRA2REV2},
+            {1080001, Consensus::PoWAlgorithm::LYRA2REV3},
+            {VERTHASH_FORKBLOCK_MAINNET, Consensus::PoWAlgorithm::VERTHASH},
+        };
+        consensus.kgwResetHeights = {1080000, VERTHASH_FORKBLOCK_MAINNET};
 
         consensus.nPowTargetTimespan = 3.5 * 24 * 60 * 60; // 3.5 days
         consensus.nPowTargetSpacing = 2.5 * 60;
@@ -193,6 +202,11 @@ public:
         consensus.powLimit = uint256S("7fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
         // Value for previous forks
         consensus.preVerthashPowLimit = uint256S("00000fffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
+        consensus.powAlgorithmSchedule = {
+            {0, Consensus::PoWAlgorithm::LYRA2REV2},
+            {158221, Consensus::PoWAlgorithm::LYRA2REV3},
+            {VERTHASH_FORKBLOCK_TESTNET, Consensus::PoWAlgorithm::VERTHASH},
+        };
         consensus.nPowTargetTimespan = 3.5 * 24 * 60 * 60; // two weeks
         consensus.nPowTargetSpacing = 2.5 * 60;
         consensus.fPowAllowMinDifficultyBlocks = true;
@@ -268,6 +282,45 @@ public:
     }
 };
 
+static void MaybeUpdatePoWSchedule(const ArgsManager& args, Consensus::Params& consensus)
+{
+    if (!args.IsArgSet("-testpowalgorithm")) return;
+
+    std::vector<Consensus::PoWAlgorithmActivation> schedule;
+    for (const std::string& arg : args.GetArgs("-testpowalgorithm")) {
+        const auto found{arg.find('@')};
+        if (found == std::string::npos) {
+            throw std::runtime_error(strprintf("Invalid format (%s) for -testpowalgorithm=name@height.", arg));
+        }
+        const auto name{arg.substr(0, found)};
+        const auto value{arg.substr(found + 1)};
+        int32_t height;
+        if (!ParseInt32(value, &height) || height < 0 || height >= std::numeric_limits<int>::max()) {
+            throw std::runtime_error(strprintf("Invalid height value (%s) for -testpowalgorithm=name@height.", arg));
+        }
+        if (!schedule.empty() && height <= schedule.back().height) {
+            throw std::runtime_error(strprintf("Heights must be increasing (%s) for -testpowalgorithm=name@height.", arg));
+        }
+        if (schedule.empty() && height != 0) {
+            throw std::runtime_error(strprintf("The first -testpowalgorithm=name@height must be at height 0 (%s).", arg));
+        }
+        if (name == "scrypt") {
+            schedule.push_back({height, Consensus::PoWAlgorithm::SCRYPT_N});
+        } else if (name == "lyra2re") {
+            schedule.push_back({height, Consensus::PoWAlgorithm::LYRA2RE});
+        } else if (name == "lyra2rev2") {
+            schedule.push_back({height, Consensus::PoWAlgorithm::LYRA2REV2});
+        } else if (name == "lyra2rev3") {
+            schedule.push_back({height, Consensus::PoWAlgorithm::LYRA2REV3});
+        } else if (name == "verthash") {
+            schedule.push_back({height, Consensus::PoWAlgorithm::VERTHASH});
+        } else {
+            throw std::runtime_error(strprintf("Invalid name (%s) for -testpowalgorithm=name@height.", arg));
+        }
+    }
+    consensus.powAlgorithmSchedule = std::move(schedule);
+}
+
 /**
  * Signet: test network with an additional consensus parameter (see BIP325).
  */
@@ -335,6 +388,13 @@ public:
         consensus.nMinerConfirmationWindow = 2016; // nPowTargetTimespan / nPowTargetSpacing
         consensus.MinBIP9WarningHeight = 0;
         consensus.powLimit = uint256S("00000377ae000000000000000000000000000000000000000000000000000000");
+        consensus.preVerthashPowLimit = consensus.powLimit;
+        consensus.powAlgorithmSchedule = {
+            {0, Consensus::PoWAlgorithm::SCRYPT_N},
+            {208301, Consensus::PoWAlgorithm::LYRA2RE},
+            {347000, Consensus::PoWAlgorithm::LYRA2REV2},
+            {1080001, Consensus::PoWAlgorithm::LYRA2REV3},
+        };
         consensus.vDeployments[Consensus::DEPLOYMENT_TESTDUMMY].bit = 28;
         consensus.vDeployments[Consensus::DEPLOYMENT_TESTDUMMY].nStartTime = Consensus::BIP9Deployment::NEVER_ACTIVE;
         consensus.vDeployments[Consensus::DEPLOYMENT_TESTDUMMY].nTimeout = Consensus::BIP9Deployment::NO_TIMEOUT;
@@ -355,6 +415,8 @@ public:
         nDefaultPort = 38333;
         nPruneAfterHeight = 1000;
 
+        MaybeUpdatePoWSchedule(args, consensus);
+
         genesis = CreateGenesisBlock(1598918400, 52613770, 0x1e0377ae, 1, 50 * COIN);
         consensus.hashGenesisBlock = genesis.GetHash();
         assert(consensus.hashGenesisBlock == uint256S("0xc5e39ee7150e81738eb9fdeabe2d5c7d533eeea2ddd42bbaf531a040a0b25179"));
@@ -398,6 +460,7 @@ public:
         consensus.MinBIP9WarningHeight = 0;
         consensus.powLimit = uint256S("7fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
         consensus.preVerthashPowLimit = consensus.powLimit;
+        consensus.powAlgorithmSchedule = {{0, Consensus::PoWAlgorithm::VERTHASH}};
         consensus.nPowTargetTimespan = 14 * 24 * 60 * 60; // two weeks
         consensus.nPowTargetSpacing = 10 * 60;
         consensus.fPowAllowMinDifficultyBlocks = true;
@@ -519,6 +582,7 @@ static void MaybeUpdateHeights(const ArgsManager& args, Consensus::Params& conse
 void CRegTestParams::UpdateActivationParametersFromArgs(const ArgsManager& args)
 {
     MaybeUpdateHeights(args, consensus);
+    MaybeUpdatePoWSchedule(args, consensus);
 
     if (!args.IsArgSet("-vbparams")) return;
 
@@ -11,6 +11,7 @@
 #include <util/threadnames.h>
 
 #include <algorithm>
+#include <string>
 #include <vector>
 
 template <typename T>
@@ -139,8 +140,9 @@ public:
     {
     }
 
-    //! Create a pool of new worker threads.
-    void StartWorkerThreads(const int threads_num)
+    //! Create a pool of new worker threads, named name.<n> and sandboxed with policy.
+    void StartWorkerThreads(const int threads_num, const std::string& name = "scriptch",
+                            SyscallSandboxPolicy policy = SyscallSandboxPolicy::VALIDATION_SCRIPT_CHECK)
     {
         {
             LOCK(m_mutex);
@@ -150,9 +152,9 @@ public:
         }
         assert(m_worker_threads.empty());
         for (int n = 0; n < threads_num; ++n) {
-            m_worker_threads.emplace_back([this, n]() {
-                util::ThreadRename(strprintf("scriptch.%i", n));
-                SetSyscallSandboxPolicy(SyscallSandboxPolicy::VALIDATION_SCRIPT_CHECK);
+            m_worker_threads.emplace_back([this, n, name, policy]() {
+                util::ThreadRename(strprintf("%s.%i", name, n));
+                SetSyscallSandboxPolicy(policy);
                 Loop(false /* worker thread */);
             });
         }
@@ -8,6 +8,7 @@
 
 #include <uint256.h>
 #include <limits>
+#include <vector>
 
 namespace Consensus {
 
@@ -64,6 +65,21 @@ struct BIP9Deployment {
     static constexpr int64_t NEVER_ACTIVE = -2;
 };
 
+/** Proof-of-work hash algorithms, in the order mainnet adopted them. */
+enum class PoWAlgorithm : uint8_t {
+    SCRYPT_N,  //!< scrypt-N with a fixed Nfactor of 10
+    LYRA2RE,
+    LYRA2REV2,
+    LYRA2REV3,
+    VERTHASH,
+};
+
+/** Switch to a proof-of-work algorithm from a block height on. */
+struct PoWAlgorithmActivation {
+    int height;
+    PoWAlgorithm algorithm;
+};
+
 /**
  * Parameters that influence chain consensus.
  */
@@ -104,6 +120,18 @@ struct Params {
     int64_t nPowTargetSpacing;
     int64_t nPowTargetTimespan;
     int64_t DifficultyAdjustmentInterval() const { return nPowTargetTimespan / nPowTargetSpacing; }
+    /** Proof-of-work algorithm schedule, ordered by height and starting at height 0 */
+    std::vector<PoWAlgorithmActivation> powAlgorithmSchedule;
+    /** Heights Kimoto Gravity Well does not look back past (difficulty resets at hard forks) */
+    std::vector<int> kgwResetHeights;
+    PoWAlgorithm GetPoWAlgorithm(int height) const
+    {
+        // The schedule only has a few entries and recent heights are the common case
+        for (auto it = powAlgorithmSchedule.rbegin(); it != powAlgorithmSchedule.rend(); ++it) {
+            if (height >= it->height) return it->algorithm;
+        }
+        return powAlgorithmSchedule.front().algorithm;
+    }
     /** The best chain should have at least this much work */
     uint256 nMinimumChainWork;
     /** By default assume that the signatures in ancestors of this block are valid */
@@ -27,6 +27,10 @@
  * online backup system.
  */
 
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
 #include "Lyra2RE.h"
 #include <stdlib.h>
 #include <stdint.h>
@@ -39,6 +43,48 @@
 #include "sph_keccak.h"
 #include "sph_skein.h"
 #include "Lyra2.h"
+#include "Sponge.h"
+#include "cubehash32.h"
+
+void cubehash256_32_generic(const void *in, void *out)
+{
+    sph_cubehash256_context ctx_cubehash;
+
+    sph_cubehash256_init(&ctx_cubehash);
+    sph_cubehash256(&ctx_cubehash, in, 32);
+    sph_cubehash256_close(&ctx_cubehash, out);
+}
+
+void cubehash256_32_x4_generic(const void *const in[4], void *const out[4])
+{
+    int i;
+    for (i = 0; i < 4; i++)
+        cubehash256_32_generic(in[i], out[i]);
+}
+
+void (*cubehash256_32)(const void *in, void *out) = cubehash256_32_generic;
+void (*cubehash256_32_x4)(const void *const in[4], void *const out[4]) = cubehash256_32_x4_generic;
+
+const char* Lyra2AutoDetect(void)
+{
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        reducedDuplexRow1 = reducedDuplexRow1_avx2;
+        reducedDuplexRowSetup = reducedDuplexRowSetup_avx2;
+        reducedDuplexRow = reducedDuplexRow_avx2;
+        cubehash256_32 = cubehash256_32_avx2;
+        cubehash256_32_x4 = cubehash256_32_x4_avx2;
+        return "avx2";
+    }
+#endif
+    reducedDuplexRow1 = reducedDuplexRow1_generic;
+    reducedDuplexRowSetup = reducedDuplexRowSetup_generic;
+    reducedDuplexRow = reducedDuplexRow_generic;
+    cubehash256_32 = cubehash256_32_generic;
+    cubehash256_32_x4 = cubehash256_32_x4_generic;
+    return "standard";
+}
 
 void lyra2re_hash(const char* input, char* output)
 {
@@ -73,7 +119,6 @@ void lyra2re_hash(const char* input, char* output)
 void lyra2re2_hash(const char* input, char* output)
 {
 	sph_blake256_context ctx_blake;
-	sph_cubehash256_context ctx_cubehash;
 	sph_keccak256_context ctx_keccak;
 	sph_skein256_context ctx_skein;
 	sph_bmw256_context ctx_bmw;
@@ -88,9 +133,7 @@ void lyra2re2_hash(const char* input, char* output)
     sph_keccak256(&ctx_keccak, hashA, 32); 
     sph_keccak256_close(&ctx_keccak, hashB);
     
-    sph_cubehash256_init(&ctx_cubehash);
-    sph_cubehash256(&ctx_cubehash, hashB, 32);
-    sph_cubehash256_close(&ctx_cubehash, hashA);
+    cubehash256_32(hashB, hashA);
     
     LYRA2(hashB, 32, hashA, 32, hashA, 32, 1, 4, 4);
     
@@ -98,9 +141,7 @@ void lyra2re2_hash(const char* input, char* output)
     sph_skein256(&ctx_skein, hashB, 32); 
     sph_skein256_close(&ctx_skein, hashA);
     
-    sph_cubehash256_init(&ctx_cubehash);
-    sph_cubehash256(&ctx_cubehash, hashA, 32);
-    sph_cubehash256_close(&ctx_cubehash, hashB);
+    cubehash256_32(hashA, hashB);
     
     sph_bmw256_init(&ctx_bmw);
     sph_bmw256(&ctx_bmw, hashB, 32);
@@ -112,7 +153,6 @@ void lyra2re2_hash(const char* input, char* output)
 void lyra2re3_hash(const char* input, char* output)
 {
     sph_blake256_context ctx_blake;
-	sph_cubehash256_context ctx_cubehash;
     sph_bmw256_context ctx_bmw;
 
 	uint32_t hashA[8], hashB[8];
@@ -123,9 +163,7 @@ void lyra2re3_hash(const char* input, char* output)
 
     LYRA2_3(hashB, 32, hashA, 32, hashA, 32, 1, 4, 4);
     
-    sph_cubehash256_init(&ctx_cubehash);
-    sph_cubehash256(&ctx_cubehash, hashB, 32);
-    sph_cubehash256_close(&ctx_cubehash, hashA);
+    cubehash256_32(hashB, hashA);
     
     LYRA2_3(hashB, 32, hashA, 32, hashA, 32, 1, 4, 4);
     
@@ -135,3 +173,101 @@ void lyra2re3_hash(const char* input, char* output)
     
    	memcpy(output, hashA, 32);
 }
+
+/*
+ * The batch versions run each stage of the chain over a group of headers
+ * before moving to the next one, so CubeHash, which takes most of the time,
+ * can hash four messages at once.
+ */
+#define LYRA2RE_BATCH_LANES 4
+
+static void cubehash256_32_lanes(uint32_t in[LYRA2RE_BATCH_LANES][8], uint32_t out[LYRA2RE_BATCH_LANES][8], size_t lanes)
+{
+    size_t i;
+    if (lanes == LYRA2RE_BATCH_LANES) {
+        const void *const ins[4] = {in[0], in[1], in[2], in[3]};
+        void *const outs[4] = {out[0], out[1], out[2], out[3]};
+        cubehash256_32_x4(ins, outs);
+        return;
+    }
+    for (i = 0; i < lanes; i++)
+        cubehash256_32(in[i], out[i]);
+}
+
+void lyra2re2_hash_batch(const char* const* inputs, char* const* outputs, size_t count)
+{
+    sph_blake256_context ctx_blake;
+    sph_keccak256_context ctx_keccak;
+    sph_skein256_context ctx_skein;
+    sph_bmw256_context ctx_bmw;
+
+    uint32_t hashA[LYRA2RE_BATCH_LANES][8], hashB[LYRA2RE_BATCH_LANES][8];
+    size_t first, lanes, i;
+
+    for (first = 0; first < count; first += lanes) {
+        lanes = count - first < LYRA2RE_BATCH_LANES ? count - first : LYRA2RE_BATCH_LANES;
+
+        for (i = 0; i < lanes; i++) {
+            sph_blake256_init(&ctx_blake);
+            sph_blake256(&ctx_blake, inputs[first + i], 80);
+            sph_blake256_close(&ctx_blake, hashA[i]);
+
+            sph_keccak256_init(&ctx_keccak);
+            sph_keccak256(&ctx_keccak, hashA[i], 32);
+            sph_keccak256_close(&ctx_keccak, hashB[i]);
+        }
+
+        cubehash256_32_lanes(hashB, hashA, lanes);
+
+        for (i = 0; i < lanes; i++) {
+            LYRA2(hashB[i], 32, hashA[i], 32, hashA[i], 32, 1, 4, 4);
+
+            sph_skein256_init(&ctx_skein);
+            sph_skein256(&ctx_skein, hashB[i], 32);
+            sph_skein256_close(&ctx_skein, hashA[i]);
+        }
+
+        cubehash256_32_lanes(hashA, hashB, lanes);
+
+        for (i = 0; i < lanes; i++) {
+            sph_bmw256_init(&ctx_bmw);
+            sph_bmw256(&ctx_bmw, hashB[i], 32);
+            sph_bmw256_close(&ctx_bmw, hashA[i]);
+
+            memcpy(outputs[first + i], hashA[i], 32);
+        }
+    }
+}
+
+void lyra2re3_hash_batch(const char* const* inputs, char* const* outputs, size_t count)
+{
+    sph_blake256_context ctx_blake;
+    sph_bmw256_context ctx_bmw;
+
+    uint32_t hashA[LYRA2RE_BATCH_LANES][8], hashB[LYRA2RE_BATCH_LANES][8];
+    size_t first, lanes, i;
+
+    for (first = 0; first < count; first += lanes) {
+        lanes = count - first < LYRA2RE_BATCH_LANES ? count - first : LYRA2RE_BATCH_LANES;
+
+        for (i = 0; i < lanes; i++) {
+            sph_blake256_init(&ctx_blake);
+            sph_blake256(&ctx_blake, inputs[first + i], 80);
+            sph_blake256_close(&ctx_blake, hashA[i]);
+
+            LYRA2_3(hashB[i], 32, hashA[i], 32, hashA[i], 32, 1, 4, 4);
+        }
+
+        cubehash256_32_lanes(hashB, hashA, lanes);
+
+        for (i = 0; i < lanes; i++) {
+            LYRA2_3(hashB[i], 32, hashA[i], 32, hashA[i], 32, 1, 4, 4);
+
+            sph_bmw256_init(&ctx_bmw);
+            sph_bmw256(&ctx_bmw, hashB[i], 32);
+            sph_bmw256_close(&ctx_bmw, hashA[i]);
+
+            memcpy(outputs[first + i], hashA[i], 32);
+        }
+    }
+}
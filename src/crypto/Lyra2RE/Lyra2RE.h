@@ -1,6 +1,8 @@
 #ifndef LYRA2RE_H
 #define LYRA2RE_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -9,6 +11,13 @@ void lyra2re_hash(const char* input, char* output);
 void lyra2re2_hash(const char* input, char* output);
 void lyra2re3_hash(const char* input, char* output);
 
+/** Hash count headers, as count calls to lyra2re2_hash/lyra2re3_hash would, but several at a time */
+void lyra2re2_hash_batch(const char* const* inputs, char* const* outputs, size_t count);
+void lyra2re3_hash_batch(const char* const* inputs, char* const* outputs, size_t count);
+
+/** Select the fastest Lyra2 sponge and CubeHash implementations for this CPU and return their name */
+const char* Lyra2AutoDetect(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,155 @@
+// Copyright (c) 2021 The Vertcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// AVX2 versions of the reduced-round duplexing operations in Sponge.c. The
+// 16-word sponge state is held as four rows of four words, so one Blake2b G
+// application covers a whole column (or diagonal) step, and it stays in
+// registers for all columns of a row.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include "Lyra2.h"
+#include "Sponge.h"
+
+namespace {
+
+inline __m256i Rotr32(__m256i x) { return _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)); }
+
+inline __m256i Rotr24(__m256i x)
+{
+    const __m256i mask = _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+                                          3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+    return _mm256_shuffle_epi8(x, mask);
+}
+
+inline __m256i Rotr16(__m256i x)
+{
+    const __m256i mask = _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+                                          2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+    return _mm256_shuffle_epi8(x, mask);
+}
+
+inline __m256i Rotr63(__m256i x) { return _mm256_or_si256(_mm256_srli_epi64(x, 63), _mm256_add_epi64(x, x)); }
+
+inline void Blake2bG(__m256i& a, __m256i& b, __m256i& c, __m256i& d)
+{
+    a = _mm256_add_epi64(a, b);
+    d = Rotr32(_mm256_xor_si256(d, a));
+    c = _mm256_add_epi64(c, d);
+    b = Rotr24(_mm256_xor_si256(b, c));
+    a = _mm256_add_epi64(a, b);
+    d = Rotr16(_mm256_xor_si256(d, a));
+    c = _mm256_add_epi64(c, d);
+    b = Rotr63(_mm256_xor_si256(b, c));
+}
+
+/** One round of Blake2b's compression function (ROUND_LYRA) */
+inline void Round(__m256i& a, __m256i& b, __m256i& c, __m256i& d)
+{
+    Blake2bG(a, b, c, d);
+    // Move the diagonals into columns
+    b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(0, 3, 2, 1));
+    c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2));
+    d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(2, 1, 0, 3));
+    Blake2bG(a, b, c, d);
+    b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(2, 1, 0, 3));
+    c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2));
+    d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(0, 3, 2, 1));
+}
+
+inline __m256i Load(const uint64_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+inline void Store(uint64_t* p, __m256i x) { _mm256_storeu_si256((__m256i*)p, x); }
+
+/** M[rowInOut][col] ^= rotW(rand): word i receives rand[i - 1], word 0 receives rand[11] */
+inline void XorRotW(uint64_t* p, __m256i a, __m256i b, __m256i c)
+{
+    const __m256i ra = _mm256_permute4x64_epi64(a, _MM_SHUFFLE(2, 1, 0, 3));
+    const __m256i rb = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(2, 1, 0, 3));
+    const __m256i rc = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(2, 1, 0, 3));
+    Store(p, _mm256_xor_si256(Load(p), _mm256_blend_epi32(ra, rc, 0x03)));
+    Store(p + 4, _mm256_xor_si256(Load(p + 4), _mm256_blend_epi32(rb, ra, 0x03)));
+    Store(p + 8, _mm256_xor_si256(Load(p + 8), _mm256_blend_epi32(rc, rb, 0x03)));
+}
+
+} // namespace
+
+extern "C" void reducedDuplexRow1_avx2(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols)
+{
+    __m256i a = Load(state), b = Load(state + 4), c = Load(state + 8), d = Load(state + 12);
+    uint64_t* ptrWordIn = rowIn;
+    uint64_t* ptrWordOut = rowOut + (nCols - 1) * BLOCK_LEN_INT64;
+    for (uint64_t i = 0; i < nCols; i++) {
+        const __m256i in0 = Load(ptrWordIn), in1 = Load(ptrWordIn + 4), in2 = Load(ptrWordIn + 8);
+        a = _mm256_xor_si256(a, in0);
+        b = _mm256_xor_si256(b, in1);
+        c = _mm256_xor_si256(c, in2);
+        Round(a, b, c, d);
+        Store(ptrWordOut, _mm256_xor_si256(in0, a));
+        Store(ptrWordOut + 4, _mm256_xor_si256(in1, b));
+        Store(ptrWordOut + 8, _mm256_xor_si256(in2, c));
+        ptrWordIn += BLOCK_LEN_INT64;
+        ptrWordOut -= BLOCK_LEN_INT64;
+    }
+    Store(state, a);
+    Store(state + 4, b);
+    Store(state + 8, c);
+    Store(state + 12, d);
+}
+
+extern "C" void reducedDuplexRowSetup_avx2(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols)
+{
+    __m256i a = Load(state), b = Load(state + 4), c = Load(state + 8), d = Load(state + 12);
+    uint64_t* ptrWordIn = rowIn;
+    uint64_t* ptrWordInOut = rowInOut;
+    uint64_t* ptrWordOut = rowOut + (nCols - 1) * BLOCK_LEN_INT64;
+    for (uint64_t i = 0; i < nCols; i++) {
+        const __m256i in0 = Load(ptrWordIn), in1 = Load(ptrWordIn + 4), in2 = Load(ptrWordIn + 8);
+        a = _mm256_xor_si256(a, _mm256_add_epi64(in0, Load(ptrWordInOut)));
+        b = _mm256_xor_si256(b, _mm256_add_epi64(in1, Load(ptrWordInOut + 4)));
+        c = _mm256_xor_si256(c, _mm256_add_epi64(in2, Load(ptrWordInOut + 8)));
+        Round(a, b, c, d);
+        Store(ptrWordOut, _mm256_xor_si256(in0, a));
+        Store(ptrWordOut + 4, _mm256_xor_si256(in1, b));
+        Store(ptrWordOut + 8, _mm256_xor_si256(in2, c));
+        XorRotW(ptrWordInOut, a, b, c);
+        ptrWordInOut += BLOCK_LEN_INT64;
+        ptrWordIn += BLOCK_LEN_INT64;
+        ptrWordOut -= BLOCK_LEN_INT64;
+    }
+    Store(state, a);
+    Store(state + 4, b);
+    Store(state + 8, c);
+    Store(state + 12, d);
+}
+
+extern "C" void reducedDuplexRow_avx2(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols)
+{
+    __m256i a = Load(state), b = Load(state + 4), c = Load(state + 8), d = Load(state + 12);
+    uint64_t* ptrWordIn = rowIn;
+    uint64_t* ptrWordInOut = rowInOut;
+    uint64_t* ptrWordOut = rowOut;
+    for (uint64_t i = 0; i < nCols; i++) {
+        a = _mm256_xor_si256(a, _mm256_add_epi64(Load(ptrWordIn), Load(ptrWordInOut)));
+        b = _mm256_xor_si256(b, _mm256_add_epi64(Load(ptrWordIn + 4), Load(ptrWordInOut + 4)));
+        c = _mm256_xor_si256(c, _mm256_add_epi64(Load(ptrWordIn + 8), Load(ptrWordInOut + 8)));
+        Round(a, b, c, d);
+        // rowOut may be the same row as rowInOut, so update it completely first, as Sponge.c does
+        Store(ptrWordOut, _mm256_xor_si256(Load(ptrWordOut), a));
+        Store(ptrWordOut + 4, _mm256_xor_si256(Load(ptrWordOut + 4), b));
+        Store(ptrWordOut + 8, _mm256_xor_si256(Load(ptrWordOut + 8), c));
+        XorRotW(ptrWordInOut, a, b, c);
+        ptrWordOut += BLOCK_LEN_INT64;
+        ptrWordInOut += BLOCK_LEN_INT64;
+        ptrWordIn += BLOCK_LEN_INT64;
+    }
+    Store(state, a);
+    Store(state + 4, b);
+    Store(state + 8, c);
+    Store(state + 12, d);
+}
+
+#endif // ENABLE_AVX2
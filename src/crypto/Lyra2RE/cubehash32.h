@@ -0,0 +1,25 @@
+#ifndef CUBEHASH32_H
+#define CUBEHASH32_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//CubeHash16/32-256 of 32-byte messages, the only size the Lyra2RE chains hash.
+//These point to the implementation selected by Lyra2AutoDetect(), the generic one by default.
+extern void (*cubehash256_32)(const void *in, void *out);
+extern void (*cubehash256_32_x4)(const void *const in[4], void *const out[4]);
+
+//sph_cubehash256 based versions (Lyra2RE.c)
+void cubehash256_32_generic(const void *in, void *out);
+void cubehash256_32_x4_generic(const void *const in[4], void *const out[4]);
+
+//AVX2 versions: the state stays in registers and messages are hashed in lock step (cubehash_avx2.cpp)
+void cubehash256_32_avx2(const void *in, void *out);
+void cubehash256_32_x4_avx2(const void *const in[4], void *const out[4]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
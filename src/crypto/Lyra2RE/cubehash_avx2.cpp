@@ -0,0 +1,112 @@
+// Copyright (c) 2021 The Vertcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// AVX2 CubeHash16/32-256 of 32-byte messages, the only input size the
+// Lyra2RE chains use. The 32-word state is held in four registers: x0-x7,
+// x8-x15, x16-x23 and x24-x31. A round is a chain of dependent steps, so
+// several messages are hashed in lock step to keep the vector units busy.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include "cubehash32.h"
+
+namespace {
+
+const uint32_t IV256[32] = {
+    0xEA2BD4B4, 0xCCD6F29F, 0x63117E71, 0x35481EAE, 0x22512D5B, 0xE5D94E63, 0x7E624131, 0xF4CC12BE,
+    0xC2D0B696, 0x42AF2070, 0xD0720C35, 0x3361DA8C, 0x28CCECA4, 0x8EF8AD83, 0x4680AC00, 0x40E5FBAB,
+    0xD89041C3, 0x6107FBD5, 0x6C859D41, 0xF0B26679, 0x09392549, 0x5FA25603, 0x65C892FD, 0x93CB6285,
+    0x2AF2B5AE, 0x9E4B4E60, 0x774ABFDD, 0x85254725, 0x15815AEB, 0x4AB6AAD6, 0x9CDAF8AF, 0xD6032C0A,
+};
+
+template <int bits>
+inline __m256i Rotl(__m256i x) { return _mm256_or_si256(_mm256_slli_epi32(x, bits), _mm256_srli_epi32(x, 32 - bits)); }
+
+struct State {
+    __m256i a, b, c, d;
+};
+
+/** Two CubeHash rounds on each of the LANES states */
+template <int LANES>
+inline void TwoRounds(State (&s)[LANES])
+{
+    for (int r = 0; r < 2; r++) {
+        for (int i = 0; i < LANES; i++) {
+            s[i].c = _mm256_add_epi32(s[i].c, s[i].a);
+            s[i].d = _mm256_add_epi32(s[i].d, s[i].b);
+            // Rotate, then swap x_00klm with x_01klm
+            const __m256i a = Rotl<7>(s[i].b);
+            const __m256i b = Rotl<7>(s[i].a);
+            s[i].a = _mm256_xor_si256(a, s[i].c);
+            s[i].b = _mm256_xor_si256(b, s[i].d);
+            // Swap x_1jk0m with x_1jk1m
+            s[i].c = _mm256_shuffle_epi32(s[i].c, _MM_SHUFFLE(1, 0, 3, 2));
+            s[i].d = _mm256_shuffle_epi32(s[i].d, _MM_SHUFFLE(1, 0, 3, 2));
+            s[i].c = _mm256_add_epi32(s[i].c, s[i].a);
+            s[i].d = _mm256_add_epi32(s[i].d, s[i].b);
+            // Rotate, then swap x_0j0lm with x_0j1lm
+            s[i].a = _mm256_permute4x64_epi64(Rotl<11>(s[i].a), _MM_SHUFFLE(1, 0, 3, 2));
+            s[i].b = _mm256_permute4x64_epi64(Rotl<11>(s[i].b), _MM_SHUFFLE(1, 0, 3, 2));
+            s[i].a = _mm256_xor_si256(s[i].a, s[i].c);
+            s[i].b = _mm256_xor_si256(s[i].b, s[i].d);
+            // Swap x_1jkl0 with x_1jkl1
+            s[i].c = _mm256_shuffle_epi32(s[i].c, _MM_SHUFFLE(2, 3, 0, 1));
+            s[i].d = _mm256_shuffle_epi32(s[i].d, _MM_SHUFFLE(2, 3, 0, 1));
+        }
+    }
+}
+
+template <int LANES>
+inline void SixteenRounds(State (&s)[LANES])
+{
+    for (int r = 0; r < 16; r += 2) TwoRounds(s);
+}
+
+template <int LANES>
+void CubeHash256_32(const void* const in[LANES], void* const out[LANES])
+{
+    const __m256i iv_a = _mm256_loadu_si256((const __m256i*)IV256);
+    const __m256i iv_b = _mm256_loadu_si256((const __m256i*)(IV256 + 8));
+    const __m256i iv_c = _mm256_loadu_si256((const __m256i*)(IV256 + 16));
+    const __m256i iv_d = _mm256_loadu_si256((const __m256i*)(IV256 + 24));
+    State s[LANES];
+    for (int i = 0; i < LANES; i++) {
+        // The message is exactly one block (x86 is little endian, like CubeHash)
+        s[i].a = _mm256_xor_si256(iv_a, _mm256_loadu_si256((const __m256i*)in[i]));
+        s[i].b = iv_b;
+        s[i].c = iv_c;
+        s[i].d = iv_d;
+    }
+    SixteenRounds(s);
+    // Padding block: a single 0x80 byte
+    const __m256i pad = _mm256_setr_epi32(0x80, 0, 0, 0, 0, 0, 0, 0);
+    for (int i = 0; i < LANES; i++) s[i].a = _mm256_xor_si256(s[i].a, pad);
+    SixteenRounds(s);
+    // Finalization: x31 ^= 1, then ten times sixteen rounds
+    const __m256i fin = _mm256_setr_epi32(0, 0, 0, 0, 0, 0, 0, 1);
+    for (int i = 0; i < LANES; i++) s[i].d = _mm256_xor_si256(s[i].d, fin);
+    for (int r = 0; r < 10; r++) SixteenRounds(s);
+    for (int i = 0; i < LANES; i++) _mm256_storeu_si256((__m256i*)out[i], s[i].a);
+}
+
+} // namespace
+
+extern "C" void cubehash256_32_avx2(const void* in, void* out)
+{
+    const void* const ins[1] = {in};
+    void* const outs[1] = {out};
+    CubeHash256_32<1>(ins, outs);
+}
+
+extern "C" void cubehash256_32_x4_avx2(const void* const in[4], void* const out[4])
+{
+    // Two messages at a time keep all state in registers; four would spill
+    CubeHash256_32<2>(in, out);
+    CubeHash256_32<2>(in + 2, out + 2);
+}
+
+#endif // ENABLE_AVX2
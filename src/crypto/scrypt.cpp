@@ -36,6 +36,46 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include <compat/cpuid.h>
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+namespace scrypt_avx2
+{
+void ROMix_8way(uint32_t (&X)[32][8], uint32_t* V, uint32_t N);
+}
+#endif
+
+namespace
+{
+/** Scratchpads are kept per thread and reused, instead of putting N * 128
+ *  bytes (256 KB for Nfactor 10) on the stack for every hash. */
+struct alignas(64) ScratchpadLine {
+    uint32_t words[16];
+};
+
+uint32_t* GetScratchpad(size_t words)
+{
+    static thread_local std::vector<ScratchpadLine> scratchpad;
+    const size_t lines = (words + 15) / 16;
+    if (scratchpad.size() < lines) scratchpad.resize(lines);
+    return scratchpad[0].words;
+}
+
+bool g_scrypt_8way = false;
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+/** Check whether the OS has enabled AVX registers. */
+bool AVXEnabled()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 6) == 6;
+}
+#endif
+} // namespace
 
 
 /*static inline uint32_t scrypt_be32dec(const void *pp)
@@ -245,7 +285,8 @@ void scrypt_detect_sse2(unsigned int cpuid_edx)
 
 void scrypt_N_1_1_256(const char *input, char *output, unsigned char Nfactor)
 {
-	char scratchpad[((1 << (Nfactor + 1)) * 128 ) + 63];
+	// The scratchpad is already aligned, so no extra bytes are needed
+	char *scratchpad = (char *)GetScratchpad((1 << (Nfactor + 1)) * 32);
 #if defined(USE_SSE2)
         // Detection would work, but in cases where we KNOW it always has SSE2,
         // it is faster to use directly than to use a function pointer or conditional.
@@ -261,3 +302,78 @@ void scrypt_N_1_1_256(const char *input, char *output, unsigned char Nfactor)
         scrypt_N_1_1_256_sp_generic(input, output, scratchpad, Nfactor);
 #endif
 }
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+/** Hash up to eight headers at once; unused lanes repeat the last header. */
+static void scrypt_N_1_1_256_8way(const char *const *inputs, char *const *outputs, size_t count, unsigned char Nfactor)
+{
+	uint8_t B[8][128];
+	uint32_t X[32][8];
+	const uint32_t N = 1 << (Nfactor + 1);
+	int lane, k;
+
+	for (lane = 0; lane < 8; lane++) {
+		if ((size_t)lane < count)
+			PBKDF2_SHA256((const uint8_t *)inputs[lane], 80, (const uint8_t *)inputs[lane], 80, 1, B[lane], 128);
+		else
+			memcpy(B[lane], B[count - 1], 128);
+		for (k = 0; k < 32; k++)
+			X[k][lane] = scrypt_le32dec(&B[lane][4 * k]);
+	}
+
+	scrypt_avx2::ROMix_8way(X, GetScratchpad((size_t)N * 32 * 8), N);
+
+	for (lane = 0; (size_t)lane < count; lane++) {
+		for (k = 0; k < 32; k++)
+			scrypt_le32enc(&B[lane][4 * k], X[k][lane]);
+		PBKDF2_SHA256((const uint8_t *)inputs[lane], 80, B[lane], 128, 1, (uint8_t *)outputs[lane], 32);
+	}
+}
+#endif
+
+void scrypt_N_1_1_256_batch(const char *const *inputs, char *const *outputs, size_t count, unsigned char Nfactor)
+{
+	size_t i = 0;
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+	if (g_scrypt_8way) {
+		// Eight lanes take less time than two single hashes
+		while (count - i >= SCRYPT_8WAY_MIN_LANES) {
+			const size_t lanes = std::min<size_t>(count - i, 8);
+			scrypt_N_1_1_256_8way(inputs + i, outputs + i, lanes, Nfactor);
+			i += lanes;
+		}
+	}
+#endif
+	for (; i < count; i++)
+		scrypt_N_1_1_256(inputs[i], outputs[i], Nfactor);
+}
+
+std::string ScryptAutoDetect()
+{
+	std::string ret = "standard";
+#if defined(USE_ASM) && defined(HAVE_GETCPUID)
+	bool have_xsave = false;
+	bool have_avx = false;
+	bool have_avx2 = false;
+	bool enabled_avx = false;
+
+	(void)AVXEnabled;
+	(void)have_avx2;
+
+	uint32_t eax, ebx, ecx, edx;
+	GetCPUID(1, 0, eax, ebx, ecx, edx);
+	have_xsave = (ecx >> 27) & 1;
+	have_avx = (ecx >> 28) & 1;
+	if (have_xsave && have_avx) {
+		enabled_avx = AVXEnabled();
+		GetCPUID(7, 0, eax, ebx, ecx, edx);
+		have_avx2 = (ebx >> 5) & 1;
+	}
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+	g_scrypt_8way = have_avx2 && have_avx && enabled_avx;
+	if (g_scrypt_8way) ret = "avx2(8way)";
+#endif
+#endif
+	return ret;
+}
@@ -2,12 +2,22 @@
 #define SCRYPT_H
 #include <stdlib.h>
 #include <stdint.h>
+#include <string>
 
 static const int SCRYPT_SCRATCHPAD_SIZE = 131072 + 63;
 
 void scrypt_N_1_1_256(const char *input, char *output, unsigned char Nfactor);
 void scrypt_N_1_1_256_sp_generic(const char *input, char *output, char *scratchpad, unsigned char Nfactor);
 
+/** Hash count headers, as count calls to scrypt_N_1_1_256 would. With AVX2,
+ *  groups of at least SCRYPT_8WAY_MIN_LANES headers are hashed eight at a time. */
+void scrypt_N_1_1_256_batch(const char *const *inputs, char *const *outputs, size_t count, unsigned char Nfactor);
+static const size_t SCRYPT_8WAY_MIN_LANES = 2;
+
+/** Autodetect the best available scrypt implementation for batches.
+ *  Returns the name of the implementation. */
+std::string ScryptAutoDetect();
+
 #if defined(USE_SSE2)
 extern void scrypt_detect_sse2(unsigned int cpuid_edx);
 void scrypt_N_1_1_256_sp_sse2(const char *input, char *output, char *scratchpad, unsigned char Nfactor);
@@ -0,0 +1,83 @@
+// Copyright (c) 2021 The Vertcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Eight-way scrypt ROMix (r = 1) using AVX2. Each register holds the same
+// word of eight independent hashes, so Salsa20/8 needs no shuffles at all.
+// The scratchpad interleaves the lanes the same way, and the data-dependent
+// reads of the second loop gather every lane's entry with one instruction.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace scrypt_avx2 {
+namespace {
+
+template <int bits>
+inline __m256i Rotl(__m256i x) { return _mm256_or_si256(_mm256_slli_epi32(x, bits), _mm256_srli_epi32(x, 32 - bits)); }
+
+inline __m256i Add(__m256i x, __m256i y) { return _mm256_add_epi32(x, y); }
+
+/** The Salsa20 quarter round on rows/columns a, b, c, d */
+inline void QuarterRound(__m256i& a, __m256i& b, __m256i& c, __m256i& d)
+{
+    b = _mm256_xor_si256(b, Rotl<7>(Add(a, d)));
+    c = _mm256_xor_si256(c, Rotl<9>(Add(b, a)));
+    d = _mm256_xor_si256(d, Rotl<13>(Add(c, b)));
+    a = _mm256_xor_si256(a, Rotl<18>(Add(d, c)));
+}
+
+/** xor_salsa8() in crypto/scrypt.cpp, on eight lanes */
+inline void XorSalsa8(__m256i B[16], const __m256i Bx[16])
+{
+    __m256i x[16];
+    for (int i = 0; i < 16; i++) x[i] = B[i] = _mm256_xor_si256(B[i], Bx[i]);
+    for (int i = 0; i < 8; i += 2) {
+        // Operate on columns
+        QuarterRound(x[0], x[4], x[8], x[12]);
+        QuarterRound(x[5], x[9], x[13], x[1]);
+        QuarterRound(x[10], x[14], x[2], x[6]);
+        QuarterRound(x[15], x[3], x[7], x[11]);
+        // Operate on rows
+        QuarterRound(x[0], x[1], x[2], x[3]);
+        QuarterRound(x[5], x[6], x[7], x[4]);
+        QuarterRound(x[10], x[11], x[8], x[9]);
+        QuarterRound(x[15], x[12], x[13], x[14]);
+    }
+    for (int i = 0; i < 16; i++) B[i] = Add(B[i], x[i]);
+}
+
+} // namespace
+
+void ROMix_8way(uint32_t (&X)[32][8], uint32_t* V, uint32_t N)
+{
+    __m256i x[32];
+    __m256i* v = (__m256i*)V;
+    for (int k = 0; k < 32; k++) x[k] = _mm256_loadu_si256((const __m256i*)X[k]);
+
+    for (uint32_t i = 0; i < N; i++) {
+        for (int k = 0; k < 32; k++) _mm256_store_si256(v + i * 32 + k, x[k]);
+        XorSalsa8(x, x + 16);
+        XorSalsa8(x + 16, x);
+    }
+
+    const __m256i mask = _mm256_set1_epi32(N - 1);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    for (uint32_t i = 0; i < N; i++) {
+        // Word k of entry j of lane l is at V[(j * 32 + k) * 8 + l]
+        const __m256i index = Add(_mm256_slli_epi32(_mm256_and_si256(x[16], mask), 8), lanes);
+        for (int k = 0; k < 32; k++) {
+            x[k] = _mm256_xor_si256(x[k], _mm256_i32gather_epi32((const int*)(V + k * 8), index, 4));
+        }
+        XorSalsa8(x, x + 16);
+        XorSalsa8(x + 16, x);
+    }
+
+    for (int k = 0; k < 32; k++) _mm256_storeu_si256((__m256i*)X[k], x[k]);
+}
+
+} // namespace scrypt_avx2
+
+#endif // ENABLE_AVX2
@@ -12,12 +12,45 @@
 #include <algorithm>
 #include <array> // For std::begin and std::end.
 
+#include <assert.h>
 #include <stdint.h>
+#include <string.h>
+
+#include <compat/cpuid.h>
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+namespace sha3_avx2
+{
+void KeccakF_4way(uint64_t (&st)[25][4]);
+}
+#endif
 
 // Internal implementation code.
 namespace
 {
 uint64_t Rotl(uint64_t x, int n) { return (x << n) | (x >> (64 - n)); }
+
+void KeccakF_4way_generic(uint64_t (&st)[25][4])
+{
+    for (int n = 0; n < 4; ++n) {
+        uint64_t lane[25];
+        for (int i = 0; i < 25; ++i) lane[i] = st[i][n];
+        KeccakF(lane);
+        for (int i = 0; i < 25; ++i) st[i][n] = lane[i];
+    }
+}
+
+void (*KeccakF_4way_impl)(uint64_t (&)[25][4]) = KeccakF_4way_generic;
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+/** Check whether the OS has enabled AVX registers. */
+bool AVXEnabled()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 6) == 6;
+}
+#endif
 } // namespace
 
 void KeccakF(uint64_t (&st)[25])
@@ -108,6 +141,87 @@ void KeccakF(uint64_t (&st)[25])
     }
 }
 
+void KeccakF_4way(uint64_t (&st)[25][4])
+{
+    KeccakF_4way_impl(st);
+}
+
+void SHA3_4way(const unsigned char* const in[4], size_t inlen, unsigned char* const out[4], size_t mdlen)
+{
+    const size_t rate = 200 - 2 * mdlen;
+    assert(mdlen <= rate);
+
+    uint64_t st[25][4] = {};
+    unsigned char block[4][200];
+    size_t pos = 0;
+    bool last = false;
+    while (!last) {
+        // Absorb one block per message, padding the final one
+        const size_t len = std::min(inlen - pos, rate);
+        last = len < rate;
+        for (int n = 0; n < 4; ++n) {
+            memcpy(block[n], in[n] + pos, len);
+            if (last) {
+                memset(block[n] + len, 0, rate - len);
+                block[n][len] ^= 0x06;
+                block[n][rate - 1] ^= 0x80;
+            }
+            for (size_t i = 0; i < rate / 8; ++i) {
+                st[i][n] ^= ReadLE64(block[n] + 8 * i);
+            }
+        }
+        KeccakF_4way(st);
+        pos += len;
+    }
+
+    for (int n = 0; n < 4; ++n) {
+        for (size_t i = 0; i < mdlen / 8; ++i) {
+            WriteLE64(out[n] + 8 * i, st[i][n]);
+        }
+    }
+}
+
+std::string SHA3AutoDetect()
+{
+    std::string ret = "standard(4way)";
+#if defined(USE_ASM) && defined(HAVE_GETCPUID)
+    bool have_xsave = false;
+    bool have_avx = false;
+    bool have_avx2 = false;
+    bool enabled_avx = false;
+
+    (void)AVXEnabled;
+    (void)have_avx2;
+
+    uint32_t eax, ebx, ecx, edx;
+    GetCPUID(1, 0, eax, ebx, ecx, edx);
+    have_xsave = (ecx >> 27) & 1;
+    have_avx = (ecx >> 28) & 1;
+    if (have_xsave && have_avx) {
+        enabled_avx = AVXEnabled();
+        GetCPUID(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = (ebx >> 5) & 1;
+    }
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx2 && have_avx && enabled_avx) {
+        KeccakF_4way_impl = sha3_avx2::KeccakF_4way;
+        ret = "avx2(4way)";
+    }
+#endif
+#endif
+
+    // Check the selected implementation against the generic one
+    uint64_t st[25][4], expected[25][4];
+    for (int i = 0; i < 25; ++i) {
+        for (int n = 0; n < 4; ++n) st[i][n] = expected[i][n] = 0x0123456789abcdefULL * (i * 4 + n + 1);
+    }
+    KeccakF_4way_generic(expected);
+    KeccakF_4way(st);
+    assert(memcmp(st, expected, sizeof(st)) == 0);
+    return ret;
+}
+
 SHA3_256& SHA3_256::Write(Span<const unsigned char> data)
 {
     if (m_bufsize && m_bufsize + data.size() >= sizeof(m_buffer)) {
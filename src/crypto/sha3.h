@@ -9,10 +9,22 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string>
 
 //! The Keccak-f[1600] transform.
 void KeccakF(uint64_t (&st)[25]);
 
+//! Four independent Keccak-f[1600] transforms. st[i][n] is word i of the n-th state.
+void KeccakF_4way(uint64_t (&st)[25][4]);
+
+/** Compute the SHA3 digests (FIPS 202, mdlen-byte output) of four messages of
+ *  inlen bytes each, as four calls to sha3() from tiny_sha3 would. */
+void SHA3_4way(const unsigned char* const in[4], size_t inlen, unsigned char* const out[4], size_t mdlen);
+
+/** Autodetect the best available KeccakF_4way implementation.
+ *  Returns the name of the implementation. */
+std::string SHA3AutoDetect();
+
 class SHA3_256
 {
 private:
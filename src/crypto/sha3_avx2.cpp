@@ -0,0 +1,123 @@
+// Copyright (c) 2021 The Vertcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace sha3_avx2 {
+namespace {
+
+__m256i inline K(uint64_t x) { return _mm256_set1_epi64x(x); }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+__m256i inline Xor(__m256i x, __m256i y, __m256i z, __m256i w, __m256i v) { return Xor(Xor(Xor(x, y), Xor(z, w)), v); }
+/** ~x & y */
+__m256i inline AndNot(__m256i x, __m256i y) { return _mm256_andnot_si256(x, y); }
+__m256i inline Rotl(__m256i x, int n) { return _mm256_or_si256(_mm256_slli_epi64(x, n), _mm256_srli_epi64(x, 64 - n)); }
+
+}
+
+/** Keccak-f[1600] on four states at once, one per 64-bit lane of each register.
+ *  Mirrors KeccakF() in crypto/sha3.cpp step for step. */
+void KeccakF_4way(uint64_t (&state)[25][4])
+{
+    static constexpr uint64_t RNDC[24] = {
+        0x0000000000000001, 0x0000000000008082, 0x800000000000808a, 0x8000000080008000,
+        0x000000000000808b, 0x0000000080000001, 0x8000000080008081, 0x8000000000008009,
+        0x000000000000008a, 0x0000000000000088, 0x0000000080008009, 0x000000008000000a,
+        0x000000008000808b, 0x800000000000008b, 0x8000000000008089, 0x8000000000008003,
+        0x8000000000008002, 0x8000000000000080, 0x000000000000800a, 0x800000008000000a,
+        0x8000000080008081, 0x8000000000008080, 0x0000000080000001, 0x8000000080008008
+    };
+    static constexpr int ROUNDS = 24;
+
+    __m256i st[25];
+    for (int i = 0; i < 25; ++i) {
+        st[i] = _mm256_loadu_si256((const __m256i*)state[i]);
+    }
+
+    for (int round = 0; round < ROUNDS; ++round) {
+        __m256i bc0, bc1, bc2, bc3, bc4, t;
+
+        // Theta
+        bc0 = Xor(st[0], st[5], st[10], st[15], st[20]);
+        bc1 = Xor(st[1], st[6], st[11], st[16], st[21]);
+        bc2 = Xor(st[2], st[7], st[12], st[17], st[22]);
+        bc3 = Xor(st[3], st[8], st[13], st[18], st[23]);
+        bc4 = Xor(st[4], st[9], st[14], st[19], st[24]);
+        t = Xor(bc4, Rotl(bc1, 1)); st[0] = Xor(st[0], t); st[5] = Xor(st[5], t); st[10] = Xor(st[10], t); st[15] = Xor(st[15], t); st[20] = Xor(st[20], t);
+        t = Xor(bc0, Rotl(bc2, 1)); st[1] = Xor(st[1], t); st[6] = Xor(st[6], t); st[11] = Xor(st[11], t); st[16] = Xor(st[16], t); st[21] = Xor(st[21], t);
+        t = Xor(bc1, Rotl(bc3, 1)); st[2] = Xor(st[2], t); st[7] = Xor(st[7], t); st[12] = Xor(st[12], t); st[17] = Xor(st[17], t); st[22] = Xor(st[22], t);
+        t = Xor(bc2, Rotl(bc4, 1)); st[3] = Xor(st[3], t); st[8] = Xor(st[8], t); st[13] = Xor(st[13], t); st[18] = Xor(st[18], t); st[23] = Xor(st[23], t);
+        t = Xor(bc3, Rotl(bc0, 1)); st[4] = Xor(st[4], t); st[9] = Xor(st[9], t); st[14] = Xor(st[14], t); st[19] = Xor(st[19], t); st[24] = Xor(st[24], t);
+
+        // Rho Pi
+        t = st[1];
+        bc0 = st[10]; st[10] = Rotl(t, 1); t = bc0;
+        bc0 = st[7]; st[7] = Rotl(t, 3); t = bc0;
+        bc0 = st[11]; st[11] = Rotl(t, 6); t = bc0;
+        bc0 = st[17]; st[17] = Rotl(t, 10); t = bc0;
+        bc0 = st[18]; st[18] = Rotl(t, 15); t = bc0;
+        bc0 = st[3]; st[3] = Rotl(t, 21); t = bc0;
+        bc0 = st[5]; st[5] = Rotl(t, 28); t = bc0;
+        bc0 = st[16]; st[16] = Rotl(t, 36); t = bc0;
+        bc0 = st[8]; st[8] = Rotl(t, 45); t = bc0;
+        bc0 = st[21]; st[21] = Rotl(t, 55); t = bc0;
+        bc0 = st[24]; st[24] = Rotl(t, 2); t = bc0;
+        bc0 = st[4]; st[4] = Rotl(t, 14); t = bc0;
+        bc0 = st[15]; st[15] = Rotl(t, 27); t = bc0;
+        bc0 = st[23]; st[23] = Rotl(t, 41); t = bc0;
+        bc0 = st[19]; st[19] = Rotl(t, 56); t = bc0;
+        bc0 = st[13]; st[13] = Rotl(t, 8); t = bc0;
+        bc0 = st[12]; st[12] = Rotl(t, 25); t = bc0;
+        bc0 = st[2]; st[2] = Rotl(t, 43); t = bc0;
+        bc0 = st[20]; st[20] = Rotl(t, 62); t = bc0;
+        bc0 = st[14]; st[14] = Rotl(t, 18); t = bc0;
+        bc0 = st[22]; st[22] = Rotl(t, 39); t = bc0;
+        bc0 = st[9]; st[9] = Rotl(t, 61); t = bc0;
+        bc0 = st[6]; st[6] = Rotl(t, 20); t = bc0;
+        st[1] = Rotl(t, 44);
+
+        // Chi Iota
+        bc0 = st[0]; bc1 = st[1]; bc2 = st[2]; bc3 = st[3]; bc4 = st[4];
+        st[0] = Xor(Xor(bc0, AndNot(bc1, bc2)), K(RNDC[round]));
+        st[1] = Xor(bc1, AndNot(bc2, bc3));
+        st[2] = Xor(bc2, AndNot(bc3, bc4));
+        st[3] = Xor(bc3, AndNot(bc4, bc0));
+        st[4] = Xor(bc4, AndNot(bc0, bc1));
+        bc0 = st[5]; bc1 = st[6]; bc2 = st[7]; bc3 = st[8]; bc4 = st[9];
+        st[5] = Xor(bc0, AndNot(bc1, bc2));
+        st[6] = Xor(bc1, AndNot(bc2, bc3));
+        st[7] = Xor(bc2, AndNot(bc3, bc4));
+        st[8] = Xor(bc3, AndNot(bc4, bc0));
+        st[9] = Xor(bc4, AndNot(bc0, bc1));
+        bc0 = st[10]; bc1 = st[11]; bc2 = st[12]; bc3 = st[13]; bc4 = st[14];
+        st[10] = Xor(bc0, AndNot(bc1, bc2));
+        st[11] = Xor(bc1, AndNot(bc2, bc3));
+        st[12] = Xor(bc2, AndNot(bc3, bc4));
+        st[13] = Xor(bc3, AndNot(bc4, bc0));
+        st[14] = Xor(bc4, AndNot(bc0, bc1));
+        bc0 = st[15]; bc1 = st[16]; bc2 = st[17]; bc3 = st[18]; bc4 = st[19];
+        st[15] = Xor(bc0, AndNot(bc1, bc2));
+        st[16] = Xor(bc1, AndNot(bc2, bc3));
+        st[17] = Xor(bc2, AndNot(bc3, bc4));
+        st[18] = Xor(bc3, AndNot(bc4, bc0));
+        st[19] = Xor(bc4, AndNot(bc0, bc1));
+        bc0 = st[20]; bc1 = st[21]; bc2 = st[22]; bc3 = st[23]; bc4 = st[24];
+        st[20] = Xor(bc0, AndNot(bc1, bc2));
+        st[21] = Xor(bc1, AndNot(bc2, bc3));
+        st[22] = Xor(bc2, AndNot(bc3, bc4));
+        st[23] = Xor(bc3, AndNot(bc4, bc0));
+        st[24] = Xor(bc4, AndNot(bc0, bc1));
+    }
+
+    for (int i = 0; i < 25; ++i) {
+        _mm256_storeu_si256((__m256i*)state[i], st[i]);
+    }
+}
+
+}
+
+#endif
@@ -2,10 +2,40 @@
 #include "clientversion.h"
 #include <random.h>
 #include <hash.h>
+#include <crypto/sha3.h>
+#include <fstream>
 #include <iostream>
 #include <ctime>
 #include <iomanip>
 #include <sstream>
+#include <algorithm>
+#include <atomic>
+
+#ifndef WIN32
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+// NUMA placement uses the raw syscalls, so that it needs no libnuma
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_getcpu)
+#define HAVE_NUMA_SYSCALLS 1
+#ifndef MPOL_BIND
+#define MPOL_BIND 2
+#endif
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3
+#endif
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE (1 << 1)
+#endif
+#endif
 
 #define HEADER_SIZE 80
 #define HASH_OUT_SIZE 32
@@ -19,26 +49,135 @@
 unsigned char *Verthash::datFile;
 size_t Verthash::datFileSize;
 bool Verthash::datFileInRam;
+size_t Verthash::datFileMapLength;
+std::vector<unsigned char*> Verthash::datFileReplicas;
+
+/** Datafile handle used by -verthash-diskonly, shared by all hashing threads */
+static Mutex cs_datFileHandle;
+#ifdef WIN32
+static FILE* datFileHandle GUARDED_BY(cs_datFileHandle) = nullptr;
+#else
+static std::atomic<int> datFileFd{-1};
+#endif
+
 const uint256 verthashDatFileHash = uint256S("0x48aa21d7afededb63976d48a8ff8ec29d5b02563af4a1110b056cd43e83155a5");
 inline uint32_t fnv1a(const uint32_t a, const uint32_t b) {
     return (a ^ b) * 0x1000193;
 }
 
-bool Verthash::VerifyDatFile()
+/** Seed index i is word i % 128 of p0, rotated left once for every full pass over p0 */
+inline uint32_t seekIndex(const uint32_t* p0_index, const size_t i) {
+    const uint32_t word = p0_index[i % (N_SUBSET/sizeof(uint32_t))];
+    const uint32_t rot = i / (N_SUBSET/sizeof(uint32_t));
+    return (word << rot) | (word >> ((32 - rot) & 31));
+}
+
+inline void prefetchSlot(const uint32_t* slot) {
+#if defined(__GNUC__)
+    // A 16-byte aligned slot may straddle two cache lines
+    __builtin_prefetch(slot, 0, 0);
+    __builtin_prefetch((const unsigned char*)slot + HASH_OUT_SIZE - 1, 0, 0);
+#endif
+}
+
+/** SHA3 stage of Verthash: p1 is the running hash, p0 the seed for the datafile lookups */
+static void hashSeeds(const char* input, unsigned char* p1, unsigned char* p0) {
+    sha3(input, HEADER_SIZE, &p1[0], HASH_OUT_SIZE);
+
+    // The i-th part of p0 hashes the header with its first byte incremented i+1 times
+    unsigned char input_header[N_ITER][HEADER_SIZE];
+    for(size_t i = 0; i < N_ITER; i++) {
+        memcpy(&input_header[i][0], input, HEADER_SIZE);
+        input_header[i][0] += i + 1;
+    }
+    for(size_t i = 0; i < N_ITER; i += 4) {
+        const unsigned char* in[4] = {input_header[i], input_header[i+1], input_header[i+2], input_header[i+3]};
+        unsigned char* out[4] = {p0+i*P0_SIZE, p0+(i+1)*P0_SIZE, p0+(i+2)*P0_SIZE, p0+(i+3)*P0_SIZE};
+        SHA3_4way(in, HEADER_SIZE, out, P0_SIZE);
+    }
+}
+
+/** Identifies the datafile on disk, so that a successful verification can be
+ *  remembered across restarts. Any change to the file changes its stamp. The
+ *  stamp is kept in the datadir even for a -verthashfile, so it records the
+ *  file's path and device: pointing the node at another file, or mounting
+ *  another filesystem where the file was, does not reuse the verification. */
+struct DatFileStamp
+{
+    std::string path;
+    uint64_t size{0};
+    int64_t mtime{0};
+    uint64_t device{0};
+    uint64_t inode{0};
+    uint256 hash;
+
+    SERIALIZE_METHODS(DatFileStamp, obj) { READWRITE(obj.path, obj.size, obj.mtime, obj.device, obj.inode, obj.hash); }
+
+    bool operator==(const DatFileStamp& other) const
+    {
+        return path == other.path && size == other.size && mtime == other.mtime &&
+               device == other.device && inode == other.inode && hash == other.hash;
+    }
+};
+
+static DatFileStamp GetDatFileStamp(const std::filesystem::path& dataFile)
+{
+    DatFileStamp stamp;
+    stamp.path = fs::PathToString(dataFile);
+    stamp.size = std::filesystem::file_size(dataFile);
+    stamp.mtime = std::filesystem::last_write_time(dataFile).time_since_epoch().count();
+#ifndef WIN32
+    struct stat st;
+    if(stat(dataFile.c_str(), &st) == 0) {
+        stamp.device = st.st_dev;
+        stamp.inode = st.st_ino;
+    }
+#endif
+    stamp.hash = verthashDatFileHash;
+    return stamp;
+}
+
+fs::path Verthash::GetDatFilePath()
 {
+    const fs::path path{gArgs.GetPathArg("-verthashfile")};
+    return fsbridge::AbsPathJoin(gArgs.GetDataDirNet(), path.empty() ? fs::PathFromString(DEFAULT_VERTHASH_FILE) : path);
+}
+
+bool Verthash::VerifyDatFile(bool fForce)
+{
+    const std::filesystem::path dataFile{GetDatFilePath()};
+    if(!std::filesystem::exists(dataFile)) {
+        throw std::runtime_error("Verthash datafile not found");
+    }
+
+    const std::filesystem::path stampFile{gArgs.GetDataDirNet() / "verthash.dat.verified"};
+    const DatFileStamp stamp = GetDatFileStamp(dataFile);
+    if(!fForce) {
+        CAutoFile file(fsbridge::fopen(stampFile, "rb"), SER_DISK, CLIENT_VERSION);
+        if(!file.IsNull()) {
+            DatFileStamp verified;
+            try {
+                file >> verified;
+                if(verified == stamp) {
+                    LogPrintf("Verthash Datafile unchanged since last verification, skipping hash check\n");
+                    return true;
+                }
+            } catch (const std::exception&) {
+                // Unreadable stamp, verify the datafile below
+            }
+        }
+    }
+
     CSHA256 ctx;
     if(!datFileInRam) {
-        std::filesystem::path dataFile{gArgs.GetDataDirNet() / "verthash.dat"};
-        if(!std::filesystem::exists(dataFile)) {
-            throw std::runtime_error("Verthash datafile not found");
-        }
         FILE* datfile = fsbridge::fopen(dataFile.c_str(),"rb");
-        fseek(datfile, 0, SEEK_SET);
-        const int bufSize = 32768;
-        unsigned char *buffer = (unsigned char *)malloc(bufSize);
+        if(datfile == nullptr) {
+            throw std::runtime_error("Verthash datafile could not be opened");
+        }
+        std::vector<unsigned char> buffer(1 << 20);
         size_t bytes_read;
-        while((bytes_read = fread(buffer, 1, 32768, datfile))) {
-            ctx.Write(buffer, bytes_read);
+        while((bytes_read = fread(buffer.data(), 1, buffer.size(), datfile))) {
+            ctx.Write(buffer.data(), bytes_read);
         }
         fclose(datfile);
     } else {
@@ -48,23 +187,190 @@ bool Verthash::VerifyDatFile()
     uint256 hash;
     ctx.Finalize((unsigned char*)&hash);
     if(hash == verthashDatFileHash) {
+        CAutoFile file(fsbridge::fopen(stampFile, "wb"), SER_DISK, CLIENT_VERSION);
+        if(!file.IsNull()) {
+            file << stamp;
+        }
         return true;
     }
-    LogPrintf("Verthash Datafile's hash is invalid - got %s expected %s", hash.GetHex(), verthashDatFileHash.GetHex());
+    LogPrintf("Verthash Datafile's hash is invalid - got %s expected %s\n", hash.GetHex(), verthashDatFileHash.GetHex());
+    fs::remove(stampFile);
     return false;
 }
 
-void Verthash::LoadInRam() {
-    std::filesystem::path dataFile{gArgs.GetDataDirNet() / "verthash.dat"};
+void Verthash::OpenFile() {
+    OpenFileIfNeeded(true);
+}
+
+void Verthash::OpenFileIfNeeded(bool fReopen) {
+#ifndef WIN32
+    if(!fReopen && datFileFd.load() != -1) {
+        return;
+    }
+#endif
+    LOCK(cs_datFileHandle);
+#ifdef WIN32
+    if(!fReopen && datFileHandle != nullptr) {
+        return;
+    }
+#else
+    if(!fReopen && datFileFd.load() != -1) {
+        return;
+    }
+#endif
+
+    const std::filesystem::path dataFile{GetDatFilePath()};
+    if(!std::filesystem::exists(dataFile)) {
+        throw std::runtime_error("Verthash datafile not found");
+    }
+#ifdef WIN32
+    if(datFileHandle != nullptr) {
+        fclose(datFileHandle);
+    }
+    datFileHandle = fsbridge::fopen(dataFile.c_str(),"rb");
+    if(datFileHandle == nullptr) {
+        throw std::runtime_error("Verthash datafile could not be opened");
+    }
+    fseek(datFileHandle, 0, SEEK_END);
+    datFileSize = ftell(datFileHandle);
+#else
+    const int fd = open(dataFile.c_str(), O_RDONLY);
+    struct stat st;
+    if(fd == -1 || fstat(fd, &st) != 0) {
+        if(fd != -1) close(fd);
+        throw std::runtime_error("Verthash datafile could not be opened");
+    }
+#ifdef POSIX_FADV_RANDOM
+    // Hash() reads 32 bytes at random offsets, so readahead is wasted I/O
+    posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+#endif
+    datFileSize = st.st_size;
+    const int oldFd = datFileFd.exchange(fd);
+    if(oldFd != -1) {
+        close(oldFd);
+    }
+#endif
+}
+
+void Verthash::ReadSlot(uint64_t offset, unsigned char* slot) {
+#ifdef WIN32
+    LOCK(cs_datFileHandle);
+    fseek(datFileHandle, offset, SEEK_SET);
+    const size_t read_len = fread(slot, 1, HASH_OUT_SIZE, datFileHandle);
+    assert(read_len == HASH_OUT_SIZE);
+#else
+    const int fd = datFileFd.load();
+    size_t done = 0;
+    while(done < HASH_OUT_SIZE) {
+        const ssize_t read_len = pread(fd, slot + done, HASH_OUT_SIZE - done, offset + done);
+        if(read_len < 0 && errno == EINTR) {
+            continue;
+        }
+        if(read_len <= 0) {
+            throw std::runtime_error("Verthash datafile could not be read");
+        }
+        done += read_len;
+    }
+#endif
+}
+
+void Verthash::Unload() {
+    {
+        LOCK(cs_datFileHandle);
+#ifdef WIN32
+        if(datFileHandle != nullptr) {
+            fclose(datFileHandle);
+            datFileHandle = nullptr;
+        }
+#else
+        const int oldFd = datFileFd.exchange(-1);
+        if(oldFd != -1) {
+            close(oldFd);
+        }
+#endif
+    }
+    if(!datFileInRam) {
+        return;
+    }
+#ifndef WIN32
+    for(unsigned char* replica : datFileReplicas) {
+        if(replica != nullptr && replica != datFile) {
+            munmap(replica, datFileMapLength);
+        }
+    }
+    datFileReplicas.clear();
+    if(datFileMapLength) {
+        munmap(datFile, datFileMapLength);
+    } else
+#endif
+    {
+        free(datFile);
+    }
+    datFile = nullptr;
+    datFileMapLength = 0;
+    datFileInRam = false;
+}
+
+#ifndef WIN32
+// Some systems (at least OS X) do not define MAP_ANONYMOUS yet and define
+// MAP_ANON which is deprecated
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/** Allocate len bytes backed by huge pages. Explicit (hugetlbfs) pages are tried
+ *  first, then an anonymous mapping marked for transparent huge pages. Returns
+ *  nullptr if neither is possible. */
+static unsigned char* AllocateHugePages(size_t len, size_t& mapLength)
+{
+#ifdef MAP_HUGETLB
+    const size_t hugeLen = (len + (1 << 21) - 1) & ~((size_t(1) << 21) - 1);
+    void* addr = mmap(nullptr, hugeLen, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+    if(addr != MAP_FAILED) {
+        mapLength = hugeLen;
+        return (unsigned char*)addr;
+    }
+#endif
+#ifdef MADV_HUGEPAGE
+    void* thp = mmap(nullptr, len, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if(thp != MAP_FAILED) {
+        madvise(thp, len, MADV_HUGEPAGE);
+        mapLength = len;
+        return (unsigned char*)thp;
+    }
+#endif
+    return nullptr;
+}
+#endif
+
+void Verthash::LoadInRam(bool fHugePages) {
+    Unload();
+
+    const std::filesystem::path dataFile{GetDatFilePath()};
     if(!std::filesystem::exists(dataFile)) {
         throw std::runtime_error("Verthash datafile not found");
     }
     FILE* datfile = fsbridge::fopen(dataFile.c_str(),"rb");
+    if(datfile == nullptr) {
+        throw std::runtime_error("Verthash datafile could not be opened");
+    }
     fseek(datfile, 0, SEEK_END);
     datFileSize = ftell(datfile);
 
     fseek(datfile, 0, SEEK_SET);
-    datFile = (unsigned char *)malloc(datFileSize);
+    datFile = nullptr;
+#ifndef WIN32
+    if(fHugePages) {
+        datFile = AllocateHugePages(datFileSize, datFileMapLength);
+        if(datFile == nullptr) {
+            LogPrintf("Verthash: huge pages unavailable, using regular pages for the datafile\n");
+        }
+    }
+#endif
+    if(datFile == nullptr) {
+        datFile = (unsigned char *)malloc(datFileSize);
+        datFileMapLength = 0;
+    }
 
     const size_t bytes_read = fread(datFile, 1, datFileSize, datfile);
     if(bytes_read != datFileSize) {
@@ -75,22 +381,193 @@ void Verthash::LoadInRam() {
     datFileInRam = true;
 }
 
-void Verthash::Hash(const char* input, char* output)
+void Verthash::MapFile(bool fHugePages, bool fPopulate) {
+#ifdef WIN32
+    LoadInRam(fHugePages);
+#else
+    Unload();
+
+    const std::filesystem::path dataFile{GetDatFilePath()};
+    if(!std::filesystem::exists(dataFile)) {
+        throw std::runtime_error("Verthash datafile not found");
+    }
+    const int fd = open(dataFile.c_str(), O_RDONLY);
+    struct stat st;
+    if(fd == -1 || fstat(fd, &st) != 0 || st.st_size <= 0) {
+        if(fd != -1) close(fd);
+        throw std::runtime_error("Verthash datafile could not be opened for mapping");
+    }
+    datFileSize = st.st_size;
+
+    // Validation reads the datafile at random, so optionally fault in every
+    // page now rather than stalling the first blocks on disk reads. Startup
+    // usually skips hashing the file, so this is the only full read of it.
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    if(fPopulate) {
+        flags |= MAP_POPULATE;
+    }
+#endif
+    void* addr = mmap(nullptr, datFileSize, PROT_READ, flags, fd, 0);
+    close(fd);
+    if(addr == MAP_FAILED) {
+        throw std::runtime_error("Verthash datafile could not be mapped");
+    }
+
+    // Hash() reads 32 bytes at random offsets, so readahead is wasted I/O
+    madvise(addr, datFileSize, MADV_RANDOM);
+#ifdef MADV_HUGEPAGE
+    if(fHugePages) {
+        madvise(addr, datFileSize, MADV_HUGEPAGE);
+    }
+#endif
+
+    datFile = (unsigned char*)addr;
+    datFileMapLength = datFileSize;
+    datFileInRam = true;
+#endif
+}
+
+/** Parse a sysfs list of CPUs or nodes such as "0-3,8,10-11" */
+static std::vector<int> ParseSysfsList(const std::string& list)
 {
-    unsigned char input_header[HEADER_SIZE];
+    std::vector<int> result;
+    std::stringstream stream(list);
+    std::string range;
+    while(std::getline(stream, range, ',')) {
+        const size_t dash = range.find('-');
+        try {
+            const int first = std::stoi(range.substr(0, dash));
+            const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for(int i = first; i <= last; i++) {
+                result.push_back(i);
+            }
+        } catch (const std::exception&) {
+            return {};
+        }
+    }
+    return result;
+}
 
-    memcpy(&input_header[0], input, HEADER_SIZE);
+std::map<int, std::vector<int>> Verthash::GetNumaNodes()
+{
+    std::map<int, std::vector<int>> nodes;
+#ifdef __linux__
+    const auto read_line = [](const std::string& path) {
+        std::string line;
+        std::ifstream file(path);
+        std::getline(file, line);
+        return line;
+    };
+    for(int node : ParseSysfsList(read_line("/sys/devices/system/node/online"))) {
+        nodes[node] = ParseSysfsList(read_line(strprintf("/sys/devices/system/node/node%d/cpulist", node)));
+    }
+#endif
+    return nodes;
+}
 
-    unsigned char p1[HASH_OUT_SIZE];
-    sha3(&input_header[0], HEADER_SIZE, &p1[0], HASH_OUT_SIZE);
+std::optional<Verthash::NumaPolicy> Verthash::ParseNumaPolicy(const std::string& name)
+{
+    if(name == "none") return NumaPolicy::NONE;
+    if(name == "interleave") return NumaPolicy::INTERLEAVE;
+    if(name == "replicate") return NumaPolicy::REPLICATE;
+    return std::nullopt;
+}
 
-    unsigned char p0[N_SUBSET];
+size_t Verthash::PlaceOnNumaNodes(NumaPolicy policy)
+{
+    if(policy == NumaPolicy::NONE || !datFileInRam) {
+        return 1;
+    }
+#ifdef HAVE_NUMA_SYSCALLS
+    const std::map<int, std::vector<int>> nodes = GetNumaNodes();
+    if(nodes.size() < 2) {
+        return 1;
+    }
+    const int maxNode = nodes.rbegin()->first;
+    const size_t bits = 8 * sizeof(unsigned long);
+    const auto nodeMask = [&](std::optional<int> only) {
+        std::vector<unsigned long> mask(maxNode / bits + 1);
+        for(const auto& node : nodes) {
+            if(!only || node.first == *only) {
+                mask[node.first / bits] |= 1UL << (node.first % bits);
+            }
+        }
+        return mask;
+    };
+    const uintptr_t page = sysconf(_SC_PAGESIZE);
 
-    for(size_t i = 0; i < N_ITER; i++) {
-    	input_header[0] += 1;
-    	sha3(&input_header[0], HEADER_SIZE, p0+i*P0_SIZE, P0_SIZE);
+    if(policy == NumaPolicy::INTERLEAVE) {
+        // mbind() takes whole pages; a heap copy may start and end mid-page
+        const uintptr_t begin = ((uintptr_t)datFile + page - 1) & ~(page - 1);
+        const uintptr_t end = ((uintptr_t)datFile + datFileSize) & ~(page - 1);
+        const std::vector<unsigned long> mask = nodeMask(std::nullopt);
+        if(end <= begin || syscall(SYS_mbind, begin, end - begin, MPOL_INTERLEAVE, mask.data(), maxNode + 2, MPOL_MF_MOVE) != 0) {
+            LogPrintf("Verthash: could not interleave the datafile over %u NUMA nodes (%s)\n", nodes.size(), strerror(errno));
+            return 1;
+        }
+        return nodes.size();
     }
 
+    // Each copy is bound to its node before it is written, so that all of
+    // its pages are allocated there
+    const size_t length = (datFileSize + page - 1) & ~(page - 1);
+    std::vector<unsigned char*> replicas(maxNode + 1, nullptr);
+    for(const auto& node : nodes) {
+        void* addr = mmap(nullptr, length, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        const std::vector<unsigned long> mask = nodeMask(node.first);
+        if(addr != MAP_FAILED && syscall(SYS_mbind, addr, length, MPOL_BIND, mask.data(), maxNode + 2, 0) != 0) {
+            const int error = errno;
+            munmap(addr, length);
+            addr = MAP_FAILED;
+            errno = error;
+        }
+        if(addr == MAP_FAILED) {
+            LogPrintf("Verthash: could not replicate the datafile on NUMA node %d (%s)\n", node.first, strerror(errno));
+            for(unsigned char* replica : replicas) {
+                if(replica != nullptr) munmap(replica, length);
+            }
+            return 1;
+        }
+        memcpy(addr, datFile, datFileSize);
+        mprotect(addr, length, PROT_READ);
+        replicas[node.first] = (unsigned char*)addr;
+    }
+
+    // The copies replace the original one
+    if(datFileMapLength) {
+        munmap(datFile, datFileMapLength);
+    } else {
+        free(datFile);
+    }
+    datFile = replicas[nodes.begin()->first];
+    datFileMapLength = length;
+    datFileReplicas = std::move(replicas);
+    return nodes.size();
+#else
+    return 1;
+#endif
+}
+
+const unsigned char* Verthash::LocalDatFile()
+{
+#ifdef HAVE_NUMA_SYSCALLS
+    if(!datFileReplicas.empty()) {
+        unsigned int cpu, node;
+        if(syscall(SYS_getcpu, &cpu, &node, nullptr) == 0 && node < datFileReplicas.size() && datFileReplicas[node] != nullptr) {
+            return datFileReplicas[node];
+        }
+    }
+#endif
+    return datFile;
+}
+
+void Verthash::Hash(const char* input, char* output)
+{
+    unsigned char p1[HASH_OUT_SIZE];
+    unsigned char p0[N_SUBSET];
+    hashSeeds(input, p1, p0);
+
     uint32_t* p0_index = (uint32_t*)p0;
     uint32_t seek_indexes[N_INDEXES];
 
@@ -101,39 +578,28 @@ void Verthash::Hash(const char* input, char* output)
 	    }
     }
 
-    size_t datfile_sz = datFileSize;
-    FILE* VerthashDatFile;
-
     if(!datFileInRam) {
-        std::filesystem::path dataFile{gArgs.GetDataDirNet() / "verthash.dat"};
-        if(!std::filesystem::exists(dataFile)) {
-            throw std::runtime_error("Verthash datafile not found");
-        }
-        VerthashDatFile = fsbridge::fopen(dataFile.c_str(),"rb");
-        fseek(VerthashDatFile, 0, SEEK_END);
-        datfile_sz = ftell(VerthashDatFile);
+        OpenFileIfNeeded(false);
     }
 
     uint32_t* p1_32 = (uint32_t*)p1;
     uint32_t value_accumulator = 0x811c9dc5;
-    const uint32_t mdiv = ((datfile_sz - HASH_OUT_SIZE)/BYTE_ALIGNMENT) + 1;
+    const uint32_t mdiv = ((datFileSize - HASH_OUT_SIZE)/BYTE_ALIGNMENT) + 1;
 
     if(!datFileInRam) {
+        uint32_t slot[HASH_OUT_SIZE/sizeof(uint32_t)];
         for(size_t i = 0; i < N_INDEXES; i++) {
-            const long offset = (fnv1a(seek_indexes[i], value_accumulator) % mdiv) * BYTE_ALIGNMENT;
-            fseek(VerthashDatFile, offset, SEEK_SET);
+            const uint64_t offset = (uint64_t)(fnv1a(seek_indexes[i], value_accumulator) % mdiv) * BYTE_ALIGNMENT;
+            ReadSlot(offset, (unsigned char*)slot);
             for(size_t i2 = 0; i2 < HASH_OUT_SIZE/sizeof(uint32_t); i2++) {
-                uint32_t value = 0;
-                size_t read_len = fread(&value, sizeof(uint32_t), 1, VerthashDatFile);
-                assert(read_len == 1);
+                const uint32_t value = slot[i2];
                 uint32_t* p1_ptr = p1_32 + i2;
                 *p1_ptr = fnv1a(*p1_ptr, value);
-
                 value_accumulator = fnv1a(value_accumulator, value);
             }
         }
     } else {
-        uint32_t* blob_bytes_32 = (uint32_t*)datFile;
+        const uint32_t* blob_bytes_32 = (const uint32_t*)LocalDatFile();
         for(size_t i = 0; i < N_INDEXES; i++) {
             const uint32_t offset = (fnv1a(seek_indexes[i], value_accumulator) % mdiv) * BYTE_ALIGNMENT/sizeof(uint32_t);
             for(size_t i2 = 0; i2 < HASH_OUT_SIZE/sizeof(uint32_t); i2++) {
@@ -146,7 +612,58 @@ void Verthash::Hash(const char* input, char* output)
     }
 
     memcpy(output, &p1[0], HASH_OUT_SIZE);
+}
+
+void Verthash::HashBatch(Span<const char* const> inputs, Span<uint256> outputs)
+{
+    assert(inputs.size() == outputs.size());
+
     if(!datFileInRam) {
-        fclose(VerthashDatFile);
+        // Every lookup is a blocking read, there is no latency to overlap
+        for(size_t i = 0; i < inputs.size(); i++) {
+            Hash(inputs[i], (char*)outputs[i].begin());
+        }
+        return;
+    }
+
+    const uint32_t* blob_bytes_32 = (const uint32_t*)LocalDatFile();
+    const uint32_t mdiv = ((datFileSize - HASH_OUT_SIZE)/BYTE_ALIGNMENT) + 1;
+
+    for(size_t start = 0; start < inputs.size(); start += BATCH_LANES) {
+        const size_t lanes = std::min(BATCH_LANES, inputs.size() - start);
+
+        uint32_t p1[BATCH_LANES][HASH_OUT_SIZE/sizeof(uint32_t)];
+        uint32_t p0[BATCH_LANES][N_SUBSET/sizeof(uint32_t)];
+        uint32_t value_accumulator[BATCH_LANES];
+        uint32_t offset[BATCH_LANES];
+
+        for(size_t lane = 0; lane < lanes; lane++) {
+            hashSeeds(inputs[start + lane], (unsigned char*)p1[lane], (unsigned char*)p0[lane]);
+            value_accumulator[lane] = 0x811c9dc5;
+            offset[lane] = (fnv1a(seekIndex(p0[lane], 0), value_accumulator[lane]) % mdiv) * BYTE_ALIGNMENT/sizeof(uint32_t);
+            prefetchSlot(blob_bytes_32 + offset[lane]);
+        }
+
+        // Each lookup depends on the previous one of the same header, so
+        // rotate between headers: the next slot of a header is prefetched
+        // while the other lanes are being processed.
+        for(size_t i = 0; i < N_INDEXES; i++) {
+            for(size_t lane = 0; lane < lanes; lane++) {
+                const uint32_t* slot = blob_bytes_32 + offset[lane];
+                for(size_t i2 = 0; i2 < HASH_OUT_SIZE/sizeof(uint32_t); i2++) {
+                    const uint32_t value = slot[i2];
+                    p1[lane][i2] = fnv1a(p1[lane][i2], value);
+                    value_accumulator[lane] = fnv1a(value_accumulator[lane], value);
+                }
+                if(i + 1 < N_INDEXES) {
+                    offset[lane] = (fnv1a(seekIndex(p0[lane], i + 1), value_accumulator[lane]) % mdiv) * BYTE_ALIGNMENT/sizeof(uint32_t);
+                    prefetchSlot(blob_bytes_32 + offset[lane]);
+                }
+            }
+        }
+
+        for(size_t lane = 0; lane < lanes; lane++) {
+            memcpy(outputs[start + lane].begin(), p1[lane], HASH_OUT_SIZE);
+        }
     }
 }
@@ -7,7 +7,11 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <map>
+#include <optional>
 #include <string>
+#include <vector>
+#include <span.h>
 #include <uint256.h>
 #include <util/system.h>
 #include <streams.h>
@@ -19,16 +23,76 @@
 
 /** Default for -blockmaxweight, which controls the range of block weights the mining code will create **/
 
+/** Default for -verthash-mmap */
+static const bool DEFAULT_VERTHASH_MMAP = false;
+/** Default for -verthash-reverify */
+static const bool DEFAULT_VERTHASH_REVERIFY = false;
+/** Default for -verthash-populate */
+static const bool DEFAULT_VERTHASH_POPULATE = false;
+/** Default for -verthash-hugepages */
+static const bool DEFAULT_VERTHASH_HUGEPAGES = false;
+/** Default for -verthash-numa */
+static const char* const DEFAULT_VERTHASH_NUMA = "none";
+/** Default for -verthashfile, relative to the network's datadir */
+static const char* const DEFAULT_VERTHASH_FILE = "verthash.dat";
+
 class Verthash
 {
 public:
     static void Hash(const char* input, char* output);
-    static bool VerifyDatFile();
-    static void LoadInRam();
+    /** Hash several 80-byte headers, giving the same results as Hash(). With the
+     *  datafile in memory the lookups of up to BATCH_LANES headers are advanced
+     *  in lockstep and prefetched, so their cache misses overlap. */
+    static void HashBatch(Span<const char* const> inputs, Span<uint256> outputs);
+    static constexpr size_t BATCH_LANES = 8;
+    /** Check the datafile's SHA256 against the expected hash. Once a file has
+     *  passed, its size, mtime and inode are remembered next to it and the
+     *  hash is skipped on later calls until the file changes, unless fForce. */
+    static bool VerifyDatFile(bool fForce = false);
+    /** Copy the datafile onto the heap, optionally backed by huge pages */
+    static void LoadInRam(bool fHugePages = false);
+    /** Map the datafile read-only, sharing its pages with the OS page cache.
+     *  With fPopulate every page is read in before returning instead of on
+     *  first use. Falls back to LoadInRam() on platforms without mmap. */
+    static void MapFile(bool fHugePages = false, bool fPopulate = false);
+    /** (Re)open the datafile for -verthash-diskonly. The handle is kept for
+     *  the lifetime of the process and shared by all hashing threads. */
+    static void OpenFile();
+    /** Release the in-memory datafile and the disk handle. The next Hash()
+     *  reopens the datafile from disk. */
+    static void Unload();
+    /** The datafile: -verthashfile, resolved against the datadir, or
+     *  verthash.dat in the datadir. Pointing several nodes at one file on
+     *  tmpfs or hugetlbfs with -verthash-mmap lets them share its pages. */
+    static fs::path GetDatFilePath();
+
+    /** Placement of the in-memory datafile on NUMA systems */
+    enum class NumaPolicy { NONE, INTERLEAVE, REPLICATE };
+    /** Parse a -verthash-numa value: none, interleave or replicate */
+    static std::optional<NumaPolicy> ParseNumaPolicy(const std::string& name);
+    /** Spread the pages of the in-memory datafile over all NUMA nodes
+     *  (INTERLEAVE), or give every node its own copy (REPLICATE) that
+     *  Hash() and HashBatch() read on the node of the CPU they run on.
+     *  Returns the number of nodes the datafile is placed on, 1 on single
+     *  node systems or where the kernel refuses the memory policy. */
+    static size_t PlaceOnNumaNodes(NumaPolicy policy);
+    /** The online NUMA nodes and their CPUs; empty where unknown */
+    static std::map<int, std::vector<int>> GetNumaNodes();
 private:
+    static void OpenFileIfNeeded(bool fReopen);
+    static void ReadSlot(uint64_t offset, unsigned char* slot);
+    /** The copy of the in-memory datafile on the calling thread's node */
+    static const unsigned char* LocalDatFile();
+
+
     static unsigned char *datFile;
     static size_t datFileSize;
     static bool datFileInRam;
+    /** Length of the mapping backing datFile, or 0 if it was malloc'ed */
+    static size_t datFileMapLength;
+    /** Per node copies made by PlaceOnNumaNodes(REPLICATE), indexed by node.
+     *  datFile is one of them. Empty if the datafile is not replicated. */
+    static std::vector<unsigned char*> datFileReplicas;
 };
 
 #endif // VERTCOIN_CRYPTO_VERTHASH_H
\ No newline at end of file
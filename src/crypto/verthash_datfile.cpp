@@ -1,4 +1,6 @@
 #include <crypto/verthash_datfile.h>
+#include <crypto/verthash.h>
+#include <crypto/sha3.h>
 #include "clientversion.h"
 #include <random.h>
 #include <iostream>
@@ -10,19 +12,35 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 #define NODE_SIZE 32
 
+/** Loops over fewer nodes than this are not worth spreading over threads */
+static const int64_t MIN_PARALLEL_NODES = 4096;
+
 struct Graph
 {
-    FILE *db;
+    uint8_t *db;
     int64_t log2;
     int64_t pow2;
     uint8_t *pk;
     int64_t index;
+    int nThreads;
+    const std::function<void(int)> *progress;
+    int lastProgress;
 };
 
-int64_t Log2(int64_t x)
+static int64_t Log2(int64_t x)
 {
     int64_t r = 0;
     for (; x > 1; x >>= 1)
@@ -33,51 +51,22 @@ int64_t Log2(int64_t x)
     return r;
 }
 
-int64_t bfsToPost(struct Graph *g, const int64_t node)
+static int64_t bfsToPost(const struct Graph *g, const int64_t node)
 {
     return node & ~g->pow2;
 }
 
-int64_t numXi(int64_t index)
+static int64_t numXi(int64_t index)
 {
     return (1 << ((uint64_t)index)) * (index + 1) * index;
 }
 
-void WriteId(struct Graph *g, uint8_t *Node, const int64_t id)
-{
-    fseek(g->db, id * NODE_SIZE, SEEK_SET);
-    fwrite(Node, 1, NODE_SIZE, g->db);
-}
-
-void WriteNode(struct Graph *g, uint8_t *Node, const int64_t id)
-{
-    const int64_t idx = bfsToPost(g, id);
-    WriteId(g, Node, idx);
-}
-
-void NewNode(struct Graph *g, const int64_t id, uint8_t *hash)
+static uint8_t *GetNode(const struct Graph *g, const int64_t id)
 {
-    WriteNode(g, hash, id);
+    return g->db + bfsToPost(g, id) * NODE_SIZE;
 }
 
-uint8_t *GetId(struct Graph *g, const int64_t id)
-{
-    fseek(g->db, id * NODE_SIZE, SEEK_SET);
-    uint8_t *node = (uint8_t *)malloc(NODE_SIZE);
-    const size_t bytes_read = fread(node, 1, NODE_SIZE, g->db);
-    if(bytes_read != NODE_SIZE) {
-        return NULL;
-    }
-    return node;
-}
-
-uint8_t *GetNode(struct Graph *g, const int64_t id)
-{
-    const int64_t idx = bfsToPost(g, id);
-    return GetId(g, idx);
-}
-
-uint32_t WriteVarInt(uint8_t *buffer, int64_t val)
+static uint32_t WriteVarInt(uint8_t *buffer, int64_t val)
 {
     memset(buffer, 0, NODE_SIZE);
     uint64_t uval = ((uint64_t)(val)) << 1;
@@ -96,7 +85,98 @@ uint32_t WriteVarInt(uint8_t *buffer, int64_t val)
     return i;
 }
 
-void ButterflyGraph(struct Graph *g, int64_t index, int64_t *count)
+/** Computes nodes four at a time with SHA3_4way. Node id is
+ *  SHA3(pk || varint(id) || parents...), and all nodes added to one batch
+ *  must have the same number of parents. */
+class NodeBatch
+{
+public:
+    explicit NodeBatch(struct Graph *g) : g(g) {}
+
+    void Add(const int64_t id, const uint8_t *parent0, const uint8_t *parent1)
+    {
+        uint8_t *hashInput = inputs[size];
+        inputSize = NODE_SIZE * 2;
+        memcpy(hashInput, g->pk, NODE_SIZE);
+        WriteVarInt(hashInput + NODE_SIZE, id);
+        if (parent0 != nullptr)
+        {
+            memcpy(hashInput + inputSize, parent0, NODE_SIZE);
+            inputSize += NODE_SIZE;
+        }
+        if (parent1 != nullptr)
+        {
+            memcpy(hashInput + inputSize, parent1, NODE_SIZE);
+            inputSize += NODE_SIZE;
+        }
+        outputs[size] = GetNode(g, id);
+        if (++size == 4)
+            Flush();
+    }
+
+    void Flush()
+    {
+        if (size == 4)
+        {
+            const unsigned char *in[4] = {inputs[0], inputs[1], inputs[2], inputs[3]};
+            SHA3_4way(in, inputSize, outputs, NODE_SIZE);
+        }
+        else
+        {
+            for (int i = 0; i < size; i++)
+                sha3(inputs[i], inputSize, outputs[i], NODE_SIZE);
+        }
+        size = 0;
+    }
+
+private:
+    struct Graph *g;
+    uint8_t inputs[4][NODE_SIZE * 4];
+    uint8_t *outputs[4];
+    size_t inputSize{0};
+    int size{0};
+};
+
+/** Run fn(i) for every i in [0, n). Iterations only read nodes of earlier
+ *  levels, so a level can be split across threads. */
+static void ParallelFor(struct Graph *g, int64_t n, const std::function<void(int64_t, NodeBatch&)>& fn)
+{
+    const auto run = [g, &fn](int64_t begin, int64_t end) {
+        NodeBatch batch(g);
+        for (int64_t i = begin; i < end; i++)
+            fn(i, batch);
+        batch.Flush();
+    };
+
+    if (g->nThreads <= 1 || n < MIN_PARALLEL_NODES)
+    {
+        run(0, n);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    const int64_t chunk = (n + g->nThreads - 1) / g->nThreads;
+    for (int64_t begin = 0; begin < n; begin += chunk)
+    {
+        threads.emplace_back(run, begin, std::min(n, begin + chunk));
+    }
+    for (auto& thread : threads)
+        thread.join();
+}
+
+static void ReportProgress(struct Graph *g, int64_t count)
+{
+    if (g->progress == nullptr || !*g->progress)
+        return;
+    const int percent = (int)((count - g->pow2) * 100 / numXi(g->index));
+    if (percent != g->lastProgress)
+    {
+        g->lastProgress = percent;
+        (*g->progress)(percent);
+    }
+}
+
+static void ButterflyGraph(struct Graph *g, int64_t index, int64_t *count)
 {
     if (index == 0)
     {
@@ -106,18 +186,19 @@ void ButterflyGraph(struct Graph *g, int64_t index, int64_t *count)
     int64_t numLevel = 2 * index;
     int64_t perLevel = (int64_t)(1 << (uint64_t)index);
     int64_t begin = *count - perLevel;
-    int64_t level, i;
+    int64_t level;
 
     for (level = 1; level < numLevel; level++)
     {
-        for (i = 0; i < perLevel; i++)
+        int64_t shift = index - level;
+        if (level > numLevel / 2)
         {
+            shift = level - numLevel / 2;
+        }
+
+        const int64_t levelStart = *count;
+        ParallelFor(g, perLevel, [&](int64_t i, NodeBatch& batch) {
             int64_t prev;
-            int64_t shift = index - level;
-            if (level > numLevel / 2)
-            {
-                shift = level - numLevel / 2;
-            }
             if (((i >> (uint64_t)shift) & 1) == 0)
             {
                 prev = i + (1 << (uint64_t)shift);
@@ -127,66 +208,30 @@ void ButterflyGraph(struct Graph *g, int64_t index, int64_t *count)
                 prev = i - (1 << (uint64_t)shift);
             }
 
-            uint8_t *parent0 = GetNode(g, begin + (level - 1) * perLevel + prev);
-            uint8_t *parent1 = GetNode(g, *count - perLevel);
-            uint8_t *buf = (uint8_t *)malloc(NODE_SIZE);
-            WriteVarInt(buf, *count);
-            uint8_t *hashInput = (uint8_t *)malloc(NODE_SIZE * 4);
-            memcpy(hashInput, g->pk, NODE_SIZE);
-            memcpy(hashInput + NODE_SIZE, buf, NODE_SIZE);
-            memcpy(hashInput + (NODE_SIZE * 2), parent0, NODE_SIZE);
-            memcpy(hashInput + (NODE_SIZE * 3), parent1, NODE_SIZE);
-
-            uint8_t *hashOutput = (uint8_t *)malloc(NODE_SIZE);
-            sha3(hashInput, NODE_SIZE * 4, hashOutput, NODE_SIZE);
-
-            NewNode(g, *count, hashOutput);
-            (*count)++;
-
-            free(hashOutput);
-            free(hashInput);
-            free(parent0);
-            free(parent1);
-            free(buf);
-        }
+            const int64_t nodeId = levelStart + i;
+            batch.Add(nodeId, GetNode(g, begin + (level - 1) * perLevel + prev), GetNode(g, nodeId - perLevel));
+        });
+        *count += perLevel;
+        ReportProgress(g, *count);
     }
 }
 
-void XiGraphIter(struct Graph *g, int64_t index)
+static void XiGraphIter(struct Graph *g, int64_t index)
 {
     int64_t count = g->pow2;
 
-    int8_t stackSize = 5;
-    int64_t *stack = (int64_t *)malloc(sizeof(int64_t) * stackSize);
-    for (int i = 0; i < 5; i++)
-        stack[i] = index;
-
-    int8_t graphStackSize = 5;
-    int32_t *graphStack = (int32_t *)malloc(sizeof(int32_t) * graphStackSize);
-    for (int i = 0; i < 5; i++)
-        graphStack[i] = graphStackSize - i - 1;
+    // Pending subgraphs, processed from the back
+    std::vector<int64_t> stack(5, index);
+    std::vector<int32_t> graphStack{4, 3, 2, 1, 0};
 
-    int64_t i = 0;
     int64_t graph = 0;
     int64_t pow2index = 1 << ((uint64_t)index);
 
-    for (i = 0; i < pow2index; i++)
-    {
-        uint8_t *buf = (uint8_t *)malloc(NODE_SIZE);
-        WriteVarInt(buf, count);
-        uint8_t *hashInput = (uint8_t *)malloc(NODE_SIZE * 2);
-        memcpy(hashInput, g->pk, NODE_SIZE);
-        memcpy(hashInput + NODE_SIZE, buf, NODE_SIZE);
-        uint8_t *hashOutput = (uint8_t *)malloc(NODE_SIZE);
-
-        sha3(hashInput, NODE_SIZE * 2, hashOutput, NODE_SIZE);
-        NewNode(g, count, hashOutput);
-        count++;
-
-        free(hashOutput);
-        free(hashInput);
-        free(buf);
-    }
+    ParallelFor(g, pow2index, [&](int64_t i, NodeBatch& batch) {
+        batch.Add(count + i, nullptr, nullptr);
+    });
+    count += pow2index;
+    ReportProgress(g, count);
 
     if (index == 1)
     {
@@ -194,204 +239,44 @@ void XiGraphIter(struct Graph *g, int64_t index)
         return;
     }
 
-    while (stackSize != 0 && graphStackSize != 0)
+    while (!stack.empty() && !graphStack.empty())
     {
-
-        index = stack[stackSize - 1];
-        graph = graphStack[graphStackSize - 1];
-
-        stackSize--;
-        if (stackSize > 0)
-        {
-            int64_t *tempStack = (int64_t *)malloc(sizeof(int64_t) * (stackSize));
-            memcpy(tempStack, stack, sizeof(int64_t) * (stackSize));
-            free(stack);
-            stack = tempStack;
-        }
-
-        graphStackSize--;
-        if (graphStackSize > 0)
-        {
-            int32_t *tempGraphStack = (int32_t *)malloc(sizeof(int32_t) * (graphStackSize));
-            memcpy(tempGraphStack, graphStack, sizeof(int32_t) * (graphStackSize));
-            free(graphStack);
-            graphStack = tempGraphStack;
-        }
-
-        int8_t indicesSize = 5;
-        int64_t *indices = (int64_t *)malloc(sizeof(int64_t) * indicesSize);
-        for (int i = 0; i < indicesSize; i++)
-            indices[i] = index - 1;
-
-        int8_t graphsSize = 5;
-        int32_t *graphs = (int32_t *)malloc(sizeof(int32_t) * graphsSize);
-        for (int i = 0; i < graphsSize; i++)
-            graphs[i] = graphsSize - i - 1;
+        index = stack.back();
+        graph = graphStack.back();
+        stack.pop_back();
+        graphStack.pop_back();
 
         int64_t pow2indexInner = 1 << ((uint64_t)index);
         int64_t pow2indexInner_1 = 1 << ((uint64_t)index - 1);
 
         if (graph == 0)
         {
-            uint64_t sources = count - pow2indexInner;
-            for (i = 0; i < pow2indexInner_1; i++)
-            {
-                uint8_t *parent0 = GetNode(g, sources + i);
-                uint8_t *parent1 = GetNode(g, sources + i + pow2indexInner_1);
-
-                uint8_t *buf = (uint8_t *)malloc(NODE_SIZE);
-                WriteVarInt(buf, count);
-
-                uint8_t *hashInput = (uint8_t *)malloc(NODE_SIZE * 4);
-                memcpy(hashInput, g->pk, NODE_SIZE);
-                memcpy(hashInput + NODE_SIZE, buf, NODE_SIZE);
-                memcpy(hashInput + (NODE_SIZE * 2), parent0, NODE_SIZE);
-                memcpy(hashInput + (NODE_SIZE * 3), parent1, NODE_SIZE);
-
-                uint8_t *hashOutput = (uint8_t *)malloc(NODE_SIZE);
-                sha3(hashInput, NODE_SIZE * 4, hashOutput, NODE_SIZE);
-
-                NewNode(g, count, hashOutput);
-                count++;
-
-                free(hashOutput);
-                free(hashInput);
-                free(parent0);
-                free(parent1);
-                free(buf);
-            }
-        }
-        else if (graph == 1)
-        {
-            uint64_t firstXi = count;
-            for (i = 0; i < pow2indexInner_1; i++)
-            {
-                uint64_t nodeId = firstXi + i;
-                uint8_t *parent = GetNode(g, firstXi - pow2indexInner_1 + i);
-
-                uint8_t *buf = (uint8_t *)malloc(NODE_SIZE);
-                WriteVarInt(buf, nodeId);
-
-                uint8_t *hashInput = (uint8_t *)malloc(NODE_SIZE * 3);
-                memcpy(hashInput, g->pk, NODE_SIZE);
-                memcpy(hashInput + NODE_SIZE, buf, NODE_SIZE);
-                memcpy(hashInput + (NODE_SIZE * 2), parent, NODE_SIZE);
-
-                uint8_t *hashOutput = (uint8_t *)malloc(NODE_SIZE);
-                sha3(hashInput, NODE_SIZE * 3, hashOutput, NODE_SIZE);
-
-                NewNode(g, count, hashOutput);
-                count++;
-
-                free(hashOutput);
-                free(hashInput);
-                free(parent);
-                free(buf);
-            }
-        }
-        else if (graph == 2)
-        {
-            uint64_t secondXi = count;
-            for (i = 0; i < pow2indexInner_1; i++)
-            {
-                uint64_t nodeId = secondXi + i;
-                uint8_t *parent = GetNode(g, secondXi - pow2indexInner_1 + i);
-
-                uint8_t *buf = (uint8_t *)malloc(NODE_SIZE);
-                WriteVarInt(buf, nodeId);
-
-                uint8_t *hashInput = (uint8_t *)malloc(NODE_SIZE * 3);
-                memcpy(hashInput, g->pk, NODE_SIZE);
-                memcpy(hashInput + NODE_SIZE, buf, NODE_SIZE);
-                memcpy(hashInput + (NODE_SIZE * 2), parent, NODE_SIZE);
-
-                uint8_t *hashOutput = (uint8_t *)malloc(NODE_SIZE);
-                sha3(hashInput, NODE_SIZE * 3, hashOutput, NODE_SIZE);
-
-                NewNode(g, count, hashOutput);
-                count++;
-
-                free(hashOutput);
-                free(hashInput);
-                free(parent);
-                free(buf);
-            }
+            const int64_t sources = count - pow2indexInner;
+            ParallelFor(g, pow2indexInner_1, [&](int64_t i, NodeBatch& batch) {
+                batch.Add(count + i, GetNode(g, sources + i), GetNode(g, sources + i + pow2indexInner_1));
+            });
+            count += pow2indexInner_1;
         }
-        else if (graph == 3)
+        else if (graph == 1 || graph == 2 || graph == 3)
         {
-            uint64_t secondButter = count;
-            for (i = 0; i < pow2indexInner_1; i++)
-            {
-                uint64_t nodeId = secondButter + i;
-                uint8_t *parent = GetNode(g, secondButter - pow2indexInner_1 + i);
-
-                uint8_t *buf = (uint8_t *)malloc(NODE_SIZE);
-                WriteVarInt(buf, nodeId);
-
-                uint8_t *hashInput = (uint8_t *)malloc(NODE_SIZE * 3);
-                memcpy(hashInput, g->pk, NODE_SIZE);
-                memcpy(hashInput + NODE_SIZE, buf, NODE_SIZE);
-                memcpy(hashInput + (NODE_SIZE * 2), parent, NODE_SIZE);
-
-                uint8_t *hashOutput = (uint8_t *)malloc(NODE_SIZE);
-                sha3(hashInput, NODE_SIZE * 3, hashOutput, NODE_SIZE);
-
-                NewNode(g, count, hashOutput);
-                count++;
-
-                free(hashOutput);
-                free(hashInput);
-                free(parent);
-                free(buf);
-            }
+            const int64_t first = count;
+            ParallelFor(g, pow2indexInner_1, [&](int64_t i, NodeBatch& batch) {
+                batch.Add(first + i, GetNode(g, first - pow2indexInner_1 + i), nullptr);
+            });
+            count += pow2indexInner_1;
         }
         else
         {
-            uint64_t sinks = count;
-            uint64_t sources = sinks + pow2indexInner - numXi(index);
-            for (i = 0; i < pow2indexInner_1; i++)
-            {
-                uint64_t nodeId0 = sinks + i;
-                uint64_t nodeId1 = sinks + i + pow2indexInner_1;
-                uint8_t *parent0 = GetNode(g, sinks - pow2indexInner_1 + i);
-                uint8_t *parent1_0 = GetNode(g, sources + i);
-                uint8_t *parent1_1 = GetNode(g, sources + i + pow2indexInner_1);
-
-                uint8_t *buf = (uint8_t *)malloc(NODE_SIZE);
-                WriteVarInt(buf, nodeId0);
-
-                uint8_t *hashInput = (uint8_t *)malloc(NODE_SIZE * 4);
-                memcpy(hashInput, g->pk, NODE_SIZE);
-                memcpy(hashInput + NODE_SIZE, buf, NODE_SIZE);
-                memcpy(hashInput + (NODE_SIZE * 2), parent0, NODE_SIZE);
-                memcpy(hashInput + (NODE_SIZE * 3), parent1_0, NODE_SIZE);
-
-                uint8_t *hashOutput0 = (uint8_t *)malloc(NODE_SIZE);
-                sha3(hashInput, NODE_SIZE * 4, hashOutput0, NODE_SIZE);
-
-                WriteVarInt(buf, nodeId1);
-
-                memcpy(hashInput, g->pk, NODE_SIZE);
-                memcpy(hashInput + NODE_SIZE, buf, NODE_SIZE);
-                memcpy(hashInput + (NODE_SIZE * 2), parent0, NODE_SIZE);
-                memcpy(hashInput + (NODE_SIZE * 3), parent1_1, NODE_SIZE);
-
-                uint8_t *hashOutput1 = (uint8_t *)malloc(NODE_SIZE);
-                sha3(hashInput, NODE_SIZE * 4, hashOutput1, NODE_SIZE);
-
-                NewNode(g, nodeId0, hashOutput0);
-                NewNode(g, nodeId1, hashOutput1);
-                count += 2;
-
-                free(parent0);
-                free(parent1_0);
-                free(parent1_1);
-                free(buf);
-                free(hashInput);
-                free(hashOutput0);
-                free(hashOutput1);
-            }
+            const int64_t sinks = count;
+            const int64_t sources = sinks + pow2indexInner - numXi(index);
+            ParallelFor(g, pow2indexInner_1, [&](int64_t i, NodeBatch& batch) {
+                const uint8_t *parent0 = GetNode(g, sinks - pow2indexInner_1 + i);
+                batch.Add(sinks + i, parent0, GetNode(g, sources + i));
+                batch.Add(sinks + i + pow2indexInner_1, parent0, GetNode(g, sources + i + pow2indexInner_1));
+            });
+            count += pow2indexInner;
         }
+        ReportProgress(g, count);
 
         if ((graph == 0 || graph == 3) ||
             ((graph == 1 || graph == 2) && index == 2))
@@ -400,71 +285,98 @@ void XiGraphIter(struct Graph *g, int64_t index)
         }
         else if (graph == 1 || graph == 2)
         {
-
-            int64_t *tempStack = (int64_t *)malloc(sizeof(int64_t) * (stackSize + indicesSize));
-            memcpy(tempStack, stack, stackSize * sizeof(int64_t));
-            memcpy(tempStack + stackSize, indices, indicesSize * sizeof(int64_t));
-            stackSize += indicesSize;
-            free(stack);
-            stack = tempStack;
-
-            int32_t *tempGraphStack = (int32_t *)malloc(sizeof(int32_t) * (graphStackSize + graphsSize));
-            memcpy(tempGraphStack, graphStack, graphStackSize * sizeof(int32_t));
-            memcpy(tempGraphStack + graphStackSize, graphs, graphsSize * sizeof(int32_t));
-            graphStackSize += graphsSize;
-            free(graphStack);
-            graphStack = tempGraphStack;
+            stack.insert(stack.end(), 5, index - 1);
+            graphStack.insert(graphStack.end(), {4, 3, 2, 1, 0});
         }
-
-        free(indices);
-        free(graphs);
     }
-
-    free(stack);
-    free(graphStack);
 }
 
-struct Graph *NewGraph(int64_t index, const std::filesystem::path& targetFile, uint8_t *pk)
-{
-    uint8_t exists = 0;
-    FILE *db;
-    if ((db = fsbridge::fopen(targetFile, "r")) != NULL)
-    {
-        fclose(db);
-        exists = 1;
+RecursiveMutex VerthashDatFile::cs_Datfile;
+
+bool VerthashDatFile::DeleteMiningDataFile() {
+    bool fDeleted = true;
+    const std::filesystem::path files[]{Verthash::GetDatFilePath(), gArgs.GetDataDirNet() / "verthash.dat.verified"};
+    for (const std::filesystem::path& file : files) {
+        std::error_code ec;
+        std::filesystem::remove(file, ec);
+        if (ec) {
+            LogPrintf("Unable to delete %s: %s\n", file.string(), ec.message());
+            fDeleted = false;
+        }
     }
+    return fDeleted;
+}
 
-    db = fsbridge::fopen(targetFile, "wb+");
-    int64_t size = numXi(index);
-    int64_t log2 = Log2(size) + 1;
-    int64_t pow2 = 1 << ((uint64_t)log2);
+void VerthashDatFile::GenerateDataFile(const std::filesystem::path& targetFile, int64_t index, int nThreads, const std::function<void(int)>& progress) {
+    const char *hashInput = "Verthash Proof-of-Space Datafile";
+    uint8_t pk[NODE_SIZE];
+    sha3(hashInput, 32, pk, NODE_SIZE);
+
+    const int64_t size = numXi(index);
+    const int64_t log2 = Log2(size) + 1;
+    const size_t fileSize = size * NODE_SIZE;
+
+    // Build into a temporary file so an interrupted run never leaves a
+    // truncated datafile behind. Its name is unique, as nodes sharing a
+    // -verthashfile may start generating it at the same time.
+    std::filesystem::path tmpFile{targetFile};
+    tmpFile += strprintf(".%08x.tmp", GetRand(std::numeric_limits<uint32_t>::max()));
+
+    struct Graph g;
+    g.log2 = log2;
+    g.pow2 = 1 << ((uint64_t)log2);
+    g.pk = pk;
+    g.index = index;
+    g.nThreads = std::max(nThreads, 1);
+    g.progress = &progress;
+    g.lastProgress = -1;
+
+#ifndef WIN32
+    // Map the output file so the kernel can write back and evict the graph
+    // as it grows instead of it having to fit into RAM at once
+    const int fd = open(tmpFile.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1 || ftruncate(fd, fileSize) != 0) {
+        if (fd != -1) close(fd);
+        throw std::runtime_error("Verthash datafile could not be created");
+    }
+    void *addr = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Verthash datafile could not be mapped");
+    }
+    g.db = (uint8_t *)addr;
 
-    struct Graph *g = (struct Graph *)malloc(sizeof(struct Graph));
-    g->db = db;
-    g->log2 = log2;
-    g->pow2 = pow2;
-    g->pk = pk;
-    g->index = index;
+    XiGraphIter(&g, index);
 
-    if (exists == 0)
-    {
-        XiGraphIter(g, index);
+    const bool written = msync(addr, fileSize, MS_SYNC) == 0;
+    munmap(addr, fileSize);
+    close(fd);
+    if (!written) {
+        throw std::runtime_error("Verthash datafile could not be written");
     }
+#else
+    std::vector<uint8_t> db(fileSize);
+    g.db = db.data();
 
-    fclose(db);
-    return g;
-}
+    XiGraphIter(&g, index);
 
-RecursiveMutex VerthashDatFile::cs_Datfile;
+    FILE *file = fsbridge::fopen(tmpFile, "wb");
+    if (file == nullptr) {
+        throw std::runtime_error("Verthash datafile could not be created");
+    }
+    const bool written = fwrite(db.data(), 1, db.size(), file) == db.size();
+    fclose(file);
+    if (!written) {
+        throw std::runtime_error("Verthash datafile could not be written");
+    }
+#endif
 
-void VerthashDatFile::DeleteMiningDataFile() {
-    const std::filesystem::path targetFile{gArgs.GetDataDirNet() / "verthash.dat"};
-    if(std::filesystem::exists(targetFile)) {
-        std::filesystem::remove(targetFile);
+    if (!RenameOver(tmpFile, targetFile)) {
+        throw std::runtime_error("Verthash datafile could not be moved into place");
     }
 }
 
-void VerthashDatFile::CreateMiningDataFile() {
+void VerthashDatFile::CreateMiningDataFile(const std::function<void(int)>& progress) {
     TRY_LOCK(cs_Datfile, lockDatfile);
     if (!lockDatfile)
     {
@@ -472,16 +384,11 @@ void VerthashDatFile::CreateMiningDataFile() {
         return;
     }
 
-    const std::filesystem::path targetFile{gArgs.GetDataDirNet() / "verthash.dat"};
+    const std::filesystem::path targetFile{Verthash::GetDatFilePath()};
     if(!std::filesystem::exists(targetFile)) {
         LogPrintf("Starting Proof-of-Space datafile generation at %s.\n", targetFile.string());
 
-        const char *hashInput = "Verthash Proof-of-Space Datafile";
-        uint8_t *pk = (uint8_t *)malloc(NODE_SIZE);
-        sha3(hashInput, 32, pk, NODE_SIZE);
-
-        int64_t index = 17;
-        NewGraph(index, targetFile, pk);
+        GenerateDataFile(targetFile, 17, GetNumCores(), progress);
 
         LogPrintf("Finished Proof-of-Space datafile generation.\n");
     }
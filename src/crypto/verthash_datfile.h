@@ -17,11 +17,20 @@
 #include <fs.h>
 #include <crypto/tiny_sha3/sha3.h>
 
+#include <functional>
+
 class VerthashDatFile
 {
 public:
-    static void CreateMiningDataFile();
-    static void DeleteMiningDataFile();
+    /** Generate the datafile at Verthash::GetDatFilePath() unless it already exists. progress
+     *  is called with the percentage done as generation advances. */
+    static void CreateMiningDataFile(const std::function<void(int)>& progress = nullptr);
+    /** Delete the datafile and its verification stamp, so that the datafile is
+     *  generated again. Returns false if either could not be deleted. */
+    static bool DeleteMiningDataFile();
+    /** Build the datafile for a graph of the given index (17 for Verthash) at
+     *  targetFile, computing each graph level on nThreads threads. */
+    static void GenerateDataFile(const std::filesystem::path& targetFile, int64_t index, int nThreads, const std::function<void(int)>& progress = nullptr);
 private:
     static RecursiveMutex cs_Datfile;
 };
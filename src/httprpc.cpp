@@ -199,7 +199,30 @@ static bool HTTPReq_JSONRPC(const std::any& context, HTTPRequest* req)
                 req->WriteReply(HTTP_FORBIDDEN);
                 return false;
             }
+            // Handlers waiting for events, like getblocktemplate long polls,
+            // can reply later without holding on to this worker thread
+            std::shared_ptr<HTTPRequest> deferred;
+            jreq.defer = [&]() -> RPCDeferredReply {
+                deferred = req->Defer();
+                return [deferred, id = jreq.id](std::function<UniValue()> work) {
+                    const auto run = [deferred, id, work] {
+                        try {
+                            const UniValue result{work()};
+                            deferred->WriteHeader("Content-Type", "application/json");
+                            deferred->WriteReply(HTTP_OK, JSONRPCReply(result, NullUniValue, id));
+                        } catch (const UniValue& objError) {
+                            JSONErrorReply(deferred.get(), objError, id);
+                        } catch (const std::exception& e) {
+                            JSONErrorReply(deferred.get(), JSONRPCError(RPC_MISC_ERROR, e.what()), id);
+                        }
+                    };
+                    // Never run the handler on the notifying thread, which
+                    // is the scheduler's or the validation interface's
+                    if (!QueueHTTPWork(run)) deferred->WriteReply(HTTP_SERVICE_UNAVAILABLE);
+                };
+            };
             UniValue result = tableRPC.execute(jreq);
+            if (deferred) return true;
 
             // Send reply
             strReply = JSONRPCReply(result, NullUniValue, jreq.id);
@@ -61,6 +61,20 @@ private:
     HTTPRequestHandler func;
 };
 
+/** Work item running a function, see QueueHTTPWork() */
+class HTTPFunctionItem final : public HTTPClosure
+{
+public:
+    explicit HTTPFunctionItem(std::function<void()> _fn) : fn(std::move(_fn)) {}
+    void operator()() override
+    {
+        fn();
+    }
+
+private:
+    std::function<void()> fn;
+};
+
 /** Simple work queue for distributing work over multiple threads.
  * Work items are simply callable objects.
  */
@@ -84,11 +98,11 @@ public:
     ~WorkQueue()
     {
     }
-    /** Enqueue a work item */
-    bool Enqueue(WorkItem* item)
+    /** Enqueue a work item, up to the maximum depth unless unbounded */
+    bool Enqueue(WorkItem* item, bool unbounded = false)
     {
         LOCK(cs);
-        if (!running || queue.size() >= maxDepth) {
+        if (!running || (!unbounded && queue.size() >= maxDepth)) {
             return false;
         }
         queue.emplace_back(std::unique_ptr<WorkItem>(item));
@@ -482,6 +496,15 @@ struct event_base* EventBase()
     return eventBase;
 }
 
+bool QueueHTTPWork(std::function<void()> fn)
+{
+    if (!g_work_queue) return false;
+    std::unique_ptr<HTTPFunctionItem> item(new HTTPFunctionItem(std::move(fn)));
+    if (!g_work_queue->Enqueue(item.get(), /*unbounded=*/true)) return false;
+    item.release(); /* queue took ownership */
+    return true;
+}
+
 static void httpevent_callback_fn(evutil_socket_t, short, void* data)
 {
     // Static handler: simply call inner handler
@@ -595,6 +618,15 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     req = nullptr; // transferred back to main thread
 }
 
+std::unique_ptr<HTTPRequest> HTTPRequest::Defer()
+{
+    assert(!replySent && req);
+    std::unique_ptr<HTTPRequest> deferred(new HTTPRequest(req));
+    replySent = true;
+    req = nullptr; // transferred to the new object
+    return deferred;
+}
+
 CService HTTPRequest::GetPeer() const
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
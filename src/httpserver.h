@@ -7,6 +7,7 @@
 
 #include <string>
 #include <functional>
+#include <memory>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
@@ -50,6 +51,13 @@ void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
  */
 struct event_base* EventBase();
 
+/** Run fn on an HTTP worker thread, for handlers finishing a request they
+ * took over with HTTPRequest::Defer(). Each such request was admitted to the
+ * work queue once already, so -rpcworkqueue does not limit them again. Returns
+ * false if the work queue is interrupted.
+ */
+bool QueueHTTPWork(std::function<void()> fn);
+
 /** In-flight HTTP request.
  * Thin C++ wrapper around evhttp_request.
  */
@@ -113,6 +121,12 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Take over the request to reply to it after the handler returned,
+     * from any thread. This object is left as if the reply was sent.
+     */
+    std::unique_ptr<HTTPRequest> Defer();
 };
 
 /** Event handler closure.
@@ -30,6 +30,7 @@
 #include <interfaces/chain.h>
 #include <interfaces/init.h>
 #include <interfaces/node.h>
+#include <key_io.h>
 #include <mapport.h>
 #include <net.h>
 #include <net_permissions.h>
@@ -45,8 +46,10 @@
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <policy/settings.h>
+#include <pow.h>
 #include <protocol.h>
 #include <rpc/blockchain.h>
+#include <rpc/mining.h>
 #include <rpc/register.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
@@ -54,6 +57,7 @@
 #include <script/sigcache.h>
 #include <script/standard.h>
 #include <shutdown.h>
+#include <stratum.h>
 #include <sync.h>
 #include <timedata.h>
 #include <torcontrol.h>
@@ -100,11 +104,13 @@
 #include <zmq/zmqrpc.h>
 #endif
 
+using node::BlockTemplateCache;
 using node::CacheSizes;
 using node::CalculateCacheSizes;
 using node::ChainstateLoadVerifyError;
 using node::ChainstateLoadingError;
 using node::CleanupBlockRevFiles;
+using node::DEFAULT_LONGPOLL_FEE_DELTA;
 using node::DEFAULT_PRINTPRIORITY;
 using node::DEFAULT_STOPAFTERBLOCKIMPORT;
 using node::LoadChainstate;
@@ -187,8 +193,10 @@ void Interrupt(NodeContext& node)
     InterruptHTTPServer();
     InterruptHTTPRPC();
     InterruptRPC();
+    if (node.block_template_cache) node.block_template_cache->InterruptWaits();
     InterruptREST();
     InterruptTorControl();
+    InterruptStratum();
     InterruptMapPort();
     if (node.connman)
         node.connman->Interrupt();
@@ -228,9 +236,11 @@ void Shutdown(NodeContext& node)
     // Because these depend on each-other, we make sure that neither can be
     // using the other before destroying them.
     if (node.peerman) UnregisterValidationInterface(node.peerman.get());
+    if (node.block_template_cache) UnregisterValidationInterface(node.block_template_cache.get());
     if (node.connman) node.connman->Stop();
 
     StopTorControl();
+    StopStratum();
 
     // After everything has been shut down, but before things get flushed, stop the
     // CScheduler/checkqueue, scheduler and load block thread.
@@ -241,6 +251,7 @@ void Shutdown(NodeContext& node)
     // After the threads that potentially access these pointers have been stopped,
     // destruct and reset all to nullptr.
     node.peerman.reset();
+    node.block_template_cache.reset();
     node.connman.reset();
     node.banman.reset();
     node.addrman.reset();
@@ -504,8 +515,15 @@ void SetupServerArgs(ArgsManager& argsman)
         "-whitebind. Can be specified multiple times." , ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
 
 
+    argsman.AddArg("-verthashfile=<file>", strprintf("Use this Verthash datafile, created there if missing. Relative paths are prefixed by a net-specific datadir location. Nodes given the same file on tmpfs or hugetlbfs share one copy of it in memory; implies -verthash-mmap (default: %s)", DEFAULT_VERTHASH_FILE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-verthash-diskonly", "Don't load Verthash's datafile into RAM. Will slow down validation significantly, but might be needed on low-memory systems.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-verthash-mmap", strprintf("Memory-map Verthash's datafile read-only instead of copying it into RAM. Starts faster and shares pages with the OS file cache (default: %u)", DEFAULT_VERTHASH_MMAP), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-verthash-numa=<policy>", strprintf("Place Verthash's in-memory datafile on multi-socket systems: 'interleave' spreads it over all NUMA nodes, 'replicate' gives every node its own copy so hashes read local memory, at the cost of a copy per node (default: %s)", DEFAULT_VERTHASH_NUMA), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-verthash-reverify", strprintf("Hash Verthash's datafile on startup even if it has not changed since it was last verified (default: %u)", DEFAULT_VERTHASH_REVERIFY), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-verthash-populate", strprintf("With -verthash-mmap, read the whole datafile into the page cache on startup instead of on first use, so early validation does not wait on disk (default: %u)", DEFAULT_VERTHASH_POPULATE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-verthash-hugepages", strprintf("Back Verthash's datafile with huge pages where the OS supports it, reducing TLB misses during validation (default: %u)", DEFAULT_VERTHASH_HUGEPAGES), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 
+    argsman.AddArg("-full-checkpoint-pow", strprintf("Check the proof of work of headers and blocks that lead to a checkpoint (last at height %d) instead of relying on the checkpoint to commit to it (default: %u)", defaultChainParams->Checkpoints().GetHeight(), DEFAULT_FULL_CHECKPOINT_POW), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-full-startup-verify", "Check the complete chain of work on startup from the Genesis block", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 
     g_wallet_init_interface.AddWalletOptions(argsman);
@@ -551,6 +569,7 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-capturemessages", "Capture all P2P messages to disk", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-mocktime=<n>", "Replace actual time with " + UNIX_EPOCH_TIME + " (default: 0)", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-maxsigcachesize=<n>", strprintf("Limit sum of signature cache and script execution cache sizes to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    argsman.AddArg("-maxpowcachesize=<n>", strprintf("Limit the cache of headers with valid proof of work to <n> MiB, 0 to disable it (default: %u)", DEFAULT_MAX_POW_CACHE_SIZE), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-maxtipage=<n>", strprintf("Maximum tip age in seconds to consider node in initial block download (default: %u)", DEFAULT_MAX_TIP_AGE), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-printpriority", strprintf("Log transaction fee rate in " + CURRENCY_UNIT + "/kvB when mining blocks (default: %u)", DEFAULT_PRINTPRIORITY), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-uacomment=<cmt>", "Append comment to the user agent string", ArgsManager::ALLOW_ANY, OptionsCategory::DEBUG_TEST);
@@ -571,6 +590,13 @@ void SetupServerArgs(ArgsManager& argsman)
 
     argsman.AddArg("-blockmaxweight=<n>", strprintf("Set maximum BIP141 block weight (default: %d)", DEFAULT_BLOCK_MAX_WEIGHT), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
     argsman.AddArg("-blockmintxfee=<amt>", strprintf("Set lowest fee rate (in %s/kvB) for transactions to be included in block creation. (default: %s)", CURRENCY_UNIT, FormatMoney(DEFAULT_BLOCK_MIN_TX_FEE)), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
+    argsman.AddArg("-longpollfeedelta=<amt>", strprintf("Answer getblocktemplate long polls once the fees of the block template grew by at least <amt> (in %s), 0 to only answer on new blocks and after a minute of mempool changes (default: %s)", CURRENCY_UNIT, FormatMoney(DEFAULT_LONGPOLL_FEE_DELTA)), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
+    argsman.AddArg("-genproclimit=<n>", strprintf("Set the number of threads generatetoaddress, generatetodescriptor and generateblock search nonces on, <= 0 for one per core (default: %d)", DEFAULT_GENERATE_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
+    argsman.AddArg("-stratum", strprintf("Accept Stratum v1 connections from miners and pools, handing out work built from this node's block templates (default: %u)", DEFAULT_STRATUM), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
+    argsman.AddArg("-stratumaddress=<addr>", "Address paid by the coinbase of blocks mined through -stratum", ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
+    argsman.AddArg("-stratumbind=<addr>[:port]", strprintf("Bind to given address to listen for Stratum connections. Any miner that can connect may mine, so do not expose it to untrusted networks. Port is optional and overrides -stratumport. Use [host]:port notation for IPv6. This option can be specified multiple times (default: %s)", DEFAULT_STRATUM_BIND), ArgsManager::ALLOW_ANY | ArgsManager::NETWORK_ONLY, OptionsCategory::BLOCK_CREATION);
+    argsman.AddArg("-stratumport=<port>", strprintf("Listen for Stratum connections on <port> (default: %u)", DEFAULT_STRATUM_PORT), ArgsManager::ALLOW_ANY | ArgsManager::NETWORK_ONLY, OptionsCategory::BLOCK_CREATION);
+    argsman.AddArg("-stratumdifficulty=<n>", strprintf("Difficulty of the shares Stratum miners submit, on the scale of getdifficulty (default: %s)", DEFAULT_STRATUM_DIFFICULTY), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
     argsman.AddArg("-blockversion=<n>", "Override block version to test forking scenarios", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::BLOCK_CREATION);
 
     argsman.AddArg("-rest", strprintf("Accept public REST requests (default: %u)", DEFAULT_REST_ENABLE), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
@@ -718,6 +744,12 @@ void InitParameterInteraction(ArgsManager& args)
         if (args.SoftSetBoolArg("-whitelistrelay", true))
             LogPrintf("%s: parameter interaction: -whitelistforcerelay=1 -> setting -whitelistrelay=1\n", __func__);
     }
+
+    // A datafile shared with other nodes is only shared if it is mapped rather than copied
+    if (!args.GetPathArg("-verthashfile").empty()) {
+        if (args.SoftSetBoolArg("-verthash-mmap", true))
+            LogPrintf("%s: parameter interaction: -verthashfile set -> setting -verthash-mmap=1\n", __func__);
+    }
 }
 
 /**
@@ -913,6 +945,9 @@ bool AppInitParameterInteraction(const ArgsManager& args)
 
     fCheckBlockIndex = args.GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = args.GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
+    fFullCheckpointPoW = args.GetBoolArg("-full-checkpoint-pow", DEFAULT_FULL_CHECKPOINT_POW);
+    if (fCheckpointsEnabled && !fFullCheckpointPoW)
+        LogPrintf("Skipping proof of work checks of headers and blocks that lead to a checkpoint (last at height %d).\n", chainparams.Checkpoints().GetHeight());
 
     hashAssumeValid = uint256S(args.GetArg("-assumevalid", chainparams.GetConsensus().defaultAssumeValid.GetHex()));
     if (!hashAssumeValid.IsNull())
@@ -934,6 +969,10 @@ bool AppInitParameterInteraction(const ArgsManager& args)
         LogPrintf("Warning: nMinimumChainWork set below default value of %s\n", chainparams.GetConsensus().nMinimumChainWork.GetHex());
     }
 
+    if (!Verthash::ParseNumaPolicy(args.GetArg("-verthash-numa", DEFAULT_VERTHASH_NUMA))) {
+        return InitError(strprintf(_("Unknown -verthash-numa value %s."), args.GetArg("-verthash-numa", "")));
+    }
+
     // mempool limits
     int64_t nMempoolSizeMax = args.GetIntArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     int64_t nMempoolSizeMin = args.GetIntArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT) * 1000 * 40;
@@ -998,6 +1037,12 @@ bool AppInitParameterInteraction(const ArgsManager& args)
         }
     }
 
+    if (args.IsArgSet("-longpollfeedelta")) {
+        if (!ParseMoney(args.GetArg("-longpollfeedelta", ""))) {
+            return InitError(AmountErrMsg("longpollfeedelta", args.GetArg("-longpollfeedelta", "")));
+        }
+    }
+
     // Feerate used to define dust.  Shouldn't be changed lightly as old
     // implementations may inadvertently create non-standard transactions
     if (args.IsArgSet("-dustrelayfee")) {
@@ -1038,6 +1083,16 @@ bool AppInitParameterInteraction(const ArgsManager& args)
         return InitError(_("No proxy server specified. Use -proxy=<ip> or -proxy=<ip:port>."));
     }
 
+    if (args.GetBoolArg("-stratum", DEFAULT_STRATUM)) {
+        if (!IsValidDestination(DecodeDestination(args.GetArg("-stratumaddress", "")))) {
+            return InitError(strprintf(_("-stratum requires a valid -stratumaddress, not '%s'."), args.GetArg("-stratumaddress", "")));
+        }
+        int64_t stratum_difficulty;
+        if (!ParseFixedPoint(args.GetArg("-stratumdifficulty", DEFAULT_STRATUM_DIFFICULTY), 8, &stratum_difficulty) || stratum_difficulty <= 0) {
+            return InitError(strprintf(_("Invalid -stratumdifficulty value %s."), args.GetArg("-stratumdifficulty", "")));
+        }
+    }
+
 #if defined(USE_SYSCALL_SANDBOX)
     if (args.IsArgSet("-sandbox") && !args.IsArgNegated("-sandbox")) {
         const std::string sandbox_arg{args.GetArg("-sandbox", "")};
@@ -1152,6 +1207,7 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
 
     InitSignatureCache();
     InitScriptExecutionCache();
+    InitPoWCache();
 
     int script_threads = args.GetIntArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
     if (script_threads <= 0) {
@@ -1290,6 +1346,10 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
                                      chainman, *node.mempool, ignores_incoming_txs);
     RegisterValidationInterface(node.peerman.get());
 
+    assert(!node.block_template_cache);
+    node.block_template_cache = std::make_unique<BlockTemplateCache>(chainman, *node.mempool, chainparams);
+    RegisterValidationInterface(node.block_template_cache.get());
+
     // sanitize comments per BIP-0014, format user agent and check total size
     std::vector<std::string> uacomments;
     for (const std::string& cmt : args.GetArgs("-uacomment")) {
@@ -1399,21 +1459,43 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
 
     // ********************************************************* Step 6b: generate verthash file and verify if it's valid
 
+    LogPrintf("Using Verthash datafile %s\n", fs::PathToString(Verthash::GetDatFilePath()));
     int cycle = 0;
     while(cycle <= 1) {
         uiInterface.InitMessage(_("Creating Verthash Datafile - may take several minutes").translated);
-        VerthashDatFile::CreateMiningDataFile();
+        VerthashDatFile::CreateMiningDataFile([](int percent) {
+            uiInterface.InitMessage(strprintf("%s (%d%%)", _("Creating Verthash Datafile - may take several minutes").translated, percent));
+        });
 
         bool fVerthashDiskOnly = gArgs.GetBoolArg("-verthash-diskonly", false);
         if(!fVerthashDiskOnly) {
-            uiInterface.InitMessage(_("Loading Verthash Datafile into RAM").translated);
-            Verthash::LoadInRam();
+            const bool fVerthashHugePages = gArgs.GetBoolArg("-verthash-hugepages", DEFAULT_VERTHASH_HUGEPAGES);
+            if(gArgs.GetBoolArg("-verthash-mmap", DEFAULT_VERTHASH_MMAP)) {
+                uiInterface.InitMessage(_("Mapping Verthash Datafile").translated);
+                Verthash::MapFile(fVerthashHugePages, gArgs.GetBoolArg("-verthash-populate", DEFAULT_VERTHASH_POPULATE));
+            } else {
+                uiInterface.InitMessage(_("Loading Verthash Datafile into RAM").translated);
+                Verthash::LoadInRam(fVerthashHugePages);
+            }
+            const Verthash::NumaPolicy numa_policy{*Verthash::ParseNumaPolicy(gArgs.GetArg("-verthash-numa", DEFAULT_VERTHASH_NUMA))};
+            if(numa_policy != Verthash::NumaPolicy::NONE) {
+                LogPrintf("Verthash datafile placed on %u NUMA node(s)\n", Verthash::PlaceOnNumaNodes(numa_policy));
+            }
+        } else {
+            Verthash::OpenFile();
         }
 
         uiInterface.InitMessage(_("Verifying Verthash Datafile").translated);
-        if(!Verthash::VerifyDatFile()) {
+        if(!Verthash::VerifyDatFile(gArgs.GetBoolArg("-verthash-reverify", DEFAULT_VERTHASH_REVERIFY))) {
             if(cycle == 0) {
-                VerthashDatFile::DeleteMiningDataFile();
+                // A file the user pointed at may be shared with other nodes,
+                // so it is not theirs to replace
+                if (!args.GetPathArg("-verthashfile").empty()) {
+                    return InitError(strprintf(_("Verthash datafile %s given with -verthashfile is invalid. Delete it to have it generated again."), fs::PathToString(Verthash::GetDatFilePath())));
+                }
+                if (!VerthashDatFile::DeleteMiningDataFile()) {
+                    return InitError(strprintf(_("Unable to delete invalid Verthash datafile %s"), fs::PathToString(Verthash::GetDatFilePath())));
+                }
             } else {
                 return InitError(_("Generated Verthash datafile mismatch"));
             }
@@ -1513,23 +1595,29 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
             }
         } else {
             std::optional<ChainstateLoadVerifyError> maybe_verify_error;
-            try {
-                uiInterface.InitMessage(_("Verifying blocks…").translated);
-                auto check_blocks = args.GetIntArg("-checkblocks", DEFAULT_CHECKBLOCKS);
-                if (fHavePruned && check_blocks > MIN_BLOCKS_TO_KEEP) {
-                    LogPrintf("Prune: pruned datadir may not have more than %d blocks; only checking available blocks\n",
-                              MIN_BLOCKS_TO_KEEP);
+            // Outside LoadChainstate(), which holds cs_main throughout
+            if (args.GetBoolArg("-full-startup-verify", false) &&
+                !chainman.m_blockman.CheckBlockIndexPoW(chainparams.GetConsensus())) {
+                maybe_verify_error = ChainstateLoadVerifyError::ERROR_CORRUPTED_BLOCK_DB;
+            } else {
+                try {
+                    uiInterface.InitMessage(_("Verifying blocks…").translated);
+                    auto check_blocks = args.GetIntArg("-checkblocks", DEFAULT_CHECKBLOCKS);
+                    if (fHavePruned && check_blocks > MIN_BLOCKS_TO_KEEP) {
+                        LogPrintf("Prune: pruned datadir may not have more than %d blocks; only checking available blocks\n",
+                                  MIN_BLOCKS_TO_KEEP);
+                    }
+                    maybe_verify_error = VerifyLoadedChainstate(chainman,
+                                                                fReset,
+                                                                fReindexChainState,
+                                                                chainparams.GetConsensus(),
+                                                                check_blocks,
+                                                                args.GetIntArg("-checklevel", DEFAULT_CHECKLEVEL),
+                                                                /*get_unix_time_seconds=*/static_cast<int64_t(*)()>(GetTime));
+                } catch (const std::exception& e) {
+                    LogPrintf("%s\n", e.what());
+                    maybe_verify_error = ChainstateLoadVerifyError::ERROR_GENERIC_FAILURE;
                 }
-                maybe_verify_error = VerifyLoadedChainstate(chainman,
-                                                            fReset,
-                                                            fReindexChainState,
-                                                            chainparams.GetConsensus(),
-                                                            check_blocks,
-                                                            args.GetIntArg("-checklevel", DEFAULT_CHECKLEVEL),
-                                                            /*get_unix_time_seconds=*/static_cast<int64_t(*)()>(GetTime));
-            } catch (const std::exception& e) {
-                LogPrintf("%s\n", e.what());
-                maybe_verify_error = ChainstateLoadVerifyError::ERROR_GENERIC_FAILURE;
             }
             if (maybe_verify_error.has_value()) {
                 switch (maybe_verify_error.value()) {
@@ -1841,6 +1929,10 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
         return false;
     }
 
+    if (args.GetBoolArg("-stratum", DEFAULT_STRATUM) && !StartStratum(node)) {
+        return InitError(_("Unable to start Stratum server. See debug log for details."));
+    }
+
     // ********************************************************* Step 13: finished
 
     // At this point, the RPC is "started", but still in warmup, which means it
@@ -1865,6 +1957,11 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
         banman->DumpBanlist();
     }, DUMP_BANS_INTERVAL);
 
+    BlockTemplateCache* block_template_cache = node.block_template_cache.get();
+    node.scheduler->scheduleEvery([block_template_cache]{
+        block_template_cache->CheckWaits();
+    }, std::chrono::seconds{1});
+
     if (node.peerman) node.peerman->StartScheduledTasks(*node.scheduler);
 
 #if HAVE_SYSTEM
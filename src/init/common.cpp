@@ -8,7 +8,10 @@
 
 #include <clientversion.h>
 #include <compat/sanity.h>
+#include <crypto/Lyra2RE/Lyra2RE.h>
+#include <crypto/scrypt.h>
 #include <crypto/sha256.h>
+#include <crypto/sha3.h>
 #include <key.h>
 #include <logging.h>
 #include <node/ui_interface.h>
@@ -27,6 +30,12 @@ void SetGlobals()
 {
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    std::string sha3_algo = SHA3AutoDetect();
+    LogPrintf("Using the '%s' SHA3 implementation\n", sha3_algo);
+    std::string lyra2_algo = Lyra2AutoDetect();
+    LogPrintf("Using the '%s' Lyra2 implementation\n", lyra2_algo);
+    std::string scrypt_algo = ScryptAutoDetect();
+    LogPrintf("Using the '%s' scrypt implementation\n", scrypt_algo);
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -65,6 +65,7 @@ namespace BCLog {
 #endif
         UTIL        = (1 << 25),
         BLOCKSTORE  = (1 << 26),
+        STRATUM     = (1 << 27),
         ALL         = ~(uint32_t)0,
     };
 
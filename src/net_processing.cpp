@@ -1102,6 +1102,11 @@ void PeerManagerImpl::FindNextBlocksToDownload(NodeId nodeid, unsigned int count
                 // We consider the chain that this peer is on invalid.
                 return;
             }
+            if (pindex->nStatus & BLOCK_POW_PENDING) {
+                // Nothing proves the work of this chain until a checkpoint it
+                // leads to arrives.
+                return;
+            }
             if (!State(nodeid)->fHaveWitness && DeploymentActiveAt(*pindex, consensusParams, Consensus::DEPLOYMENT_SEGWIT)) {
                 // We wouldn't download this block or its descendants from this peer.
                 return;
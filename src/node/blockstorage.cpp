@@ -11,6 +11,7 @@
 #include <flatfile.h>
 #include <fs.h>
 #include <hash.h>
+#include <node/ui_interface.h>
 #include <pow.h>
 #include <reverse_iterator.h>
 #include <shutdown.h>
@@ -19,8 +20,12 @@
 #include <undo.h>
 #include <util/syscall_sandbox.h>
 #include <util/system.h>
+#include <util/translation.h>
 #include <validation.h>
 
+#include <algorithm>
+#include <thread>
+
 namespace node {
 std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
@@ -39,7 +44,7 @@ CBlockIndex* BlockManager::LookupBlockIndex(const uint256& hash) const
     return it == m_block_index.end() ? nullptr : it->second;
 }
 
-CBlockIndex* BlockManager::AddToBlockIndex(const CBlockHeader& block)
+CBlockIndex* BlockManager::AddToBlockIndex(const CBlockHeader& block, bool pow_pending)
 {
     AssertLockHeld(cs_main);
 
@@ -67,14 +72,32 @@ CBlockIndex* BlockManager::AddToBlockIndex(const CBlockHeader& block)
     pindexNew->nTimeMax = (pindexNew->pprev ? std::max(pindexNew->pprev->nTimeMax, pindexNew->nTime) : pindexNew->nTime);
     pindexNew->nChainWork = (pindexNew->pprev ? pindexNew->pprev->nChainWork : 0) + GetBlockProof(*pindexNew);
     pindexNew->RaiseValidity(BLOCK_VALID_TREE);
-    if (pindexBestHeader == nullptr || pindexBestHeader->nChainWork < pindexNew->nChainWork)
+    if (pow_pending) {
+        pindexNew->nStatus |= BLOCK_POW_PENDING;
+        ++m_pow_pending_headers;
+    } else if (pindexBestHeader == nullptr || pindexBestHeader->nChainWork < pindexNew->nChainWork) {
         pindexBestHeader = pindexNew;
+    }
 
     m_dirty_blockindex.insert(pindexNew);
 
     return pindexNew;
 }
 
+void BlockManager::ClearPoWPending(CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+    if (pindex == nullptr || !(pindex->nStatus & BLOCK_POW_PENDING)) return;
+    if (pindexBestHeader == nullptr || pindexBestHeader->nChainWork < pindex->nChainWork) {
+        pindexBestHeader = pindex;
+    }
+    for (; pindex && (pindex->nStatus & BLOCK_POW_PENDING); pindex = pindex->pprev) {
+        pindex->nStatus &= ~BLOCK_POW_PENDING;
+        m_dirty_blockindex.insert(pindex);
+        --m_pow_pending_headers;
+    }
+}
+
 void BlockManager::PruneOneBlockFile(const int fileNumber)
 {
     AssertLockHeld(cs_main);
@@ -316,8 +339,11 @@ bool BlockManager::LoadBlockIndex(
         if (pindex->pprev) {
             pindex->BuildSkip();
         }
-        if (pindex->IsValid(BLOCK_VALID_TREE) && (pindexBestHeader == nullptr || CBlockIndexWorkComparator()(pindexBestHeader, pindex)))
+        if (pindex->nStatus & BLOCK_POW_PENDING) {
+            ++m_pow_pending_headers;
+        } else if (pindex->IsValid(BLOCK_VALID_TREE) && (pindexBestHeader == nullptr || CBlockIndexWorkComparator()(pindexBestHeader, pindex))) {
             pindexBestHeader = pindex;
+        }
     }
 
     return true;
@@ -337,6 +363,7 @@ void BlockManager::Unload()
     m_last_blockfile = 0;
     m_dirty_blockindex.clear();
     m_dirty_fileinfo.clear();
+    m_pow_pending_headers = 0;
 }
 
 bool BlockManager::WriteBlockIndexDB()
@@ -413,6 +440,114 @@ bool BlockManager::LoadBlockIndexDB(ChainstateManager& chainman)
     return true;
 }
 
+/** Number of block index entries one PoW verification worker takes at a time */
+static constexpr size_t POW_VERIFY_CHUNK_SIZE{1024};
+
+/**
+ * Check the proof of work of every entry in vIndex on a pool of worker threads.
+ *
+ * Entries are handed out in chunks in order, and a failure is reported for the
+ * earliest failing entry so the result does not depend on thread timing.
+ */
+static bool VerifyBlockIndexPoW(const std::vector<const CBlockIndex*>& vIndex, const Consensus::Params& consensusParams)
+{
+    const size_t total = vIndex.size();
+    const size_t num_chunks = (total + POW_VERIFY_CHUNK_SIZE - 1) / POW_VERIFY_CHUNK_SIZE;
+    const int num_threads = std::max(1, std::min<int>(GetNumCores(), num_chunks));
+    LogPrintf("Checking PoW for %u blocks using %d threads\n", total, num_threads);
+
+    std::atomic<size_t> next_chunk{0};
+    std::atomic<size_t> first_failure{total};
+    std::atomic<size_t> checked{0};
+    std::atomic<bool> interrupted{false};
+    Mutex cs_progress;
+    int last_percent = -1;
+
+    const auto worker = [&]() {
+        std::vector<CBlockHeader> headers;
+        std::vector<int> heights;
+        std::vector<uint256> hashes;
+        while (!interrupted) {
+            const size_t chunk = next_chunk++;
+            const size_t begin = chunk * POW_VERIFY_CHUNK_SIZE;
+            // Entries after an already found failure cannot change the result
+            if (begin >= std::min(total, first_failure.load())) break;
+            if (ShutdownRequested()) {
+                interrupted = true;
+                break;
+            }
+            const size_t end = std::min(total, begin + POW_VERIFY_CHUNK_SIZE);
+
+            headers.clear();
+            heights.clear();
+            for (size_t i = begin; i < end; ++i) {
+                headers.push_back(vIndex[i]->GetBlockHeader());
+                heights.push_back(vIndex[i]->nHeight);
+            }
+            hashes.resize(headers.size());
+            GetPoWHashes(headers, heights, hashes);
+
+            for (size_t i = begin; i < end; ++i) {
+                if (!CheckProofOfWork(hashes[i - begin], vIndex[i]->nBits, consensusParams)) {
+                    size_t prev = first_failure.load();
+                    while (i < prev && !first_failure.compare_exchange_weak(prev, i)) {}
+                    break;
+                }
+            }
+
+            const size_t done = checked += end - begin;
+            const int percent = done * 100 / total;
+            LOCK(cs_progress);
+            if (percent > last_percent) {
+                last_percent = percent;
+                if (percent % 5 == 0) LogPrintf("Checked PoW for %u of %u blocks (%d%%)\n", done, total, percent);
+                uiInterface.ShowProgress(_("Verifying block headers…").translated, percent, false);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    uiInterface.ShowProgress("", 100, false);
+
+    if (interrupted) return false;
+    if (first_failure < total) {
+        return error("%s: CheckProofOfWork failed: %s\n", __func__, vIndex[first_failure]->ToString());
+    }
+    return true;
+}
+
+bool BlockManager::CheckBlockIndexPoW(const Consensus::Params& consensus_params)
+{
+    std::vector<const CBlockIndex*> vIndex;
+    {
+        LOCK(cs_main);
+        vIndex.reserve(m_block_index.size());
+        for (const auto& [hash, pindex] : m_block_index) {
+            // Headers pending a checkpoint were accepted without their
+            // proof of work and are checked by it instead
+            if (!(pindex->nStatus & BLOCK_POW_PENDING)) vIndex.push_back(pindex);
+        }
+    }
+    if (vIndex.empty()) return true;
+
+    // By height, so that the lowest bad entry is the one reported
+    std::sort(vIndex.begin(), vIndex.end(), [](const CBlockIndex* a, const CBlockIndex* b) {
+        return a->nHeight != b->nHeight ? a->nHeight < b->nHeight : a->GetBlockHash() < b->GetBlockHash();
+    });
+
+    // Only the headers of the entries are read from here on, and those never
+    // change once loaded, so the (expensive) PoW hashes need not hold up
+    // anything waiting for cs_main.
+    return VerifyBlockIndexPoW(vIndex, consensus_params);
+}
+
 CBlockIndex* BlockManager::GetLastCheckpoint(const CCheckpointData& data)
 {
     const MapCheckpoints& checkpoints = data.mapCheckpoints;
@@ -742,7 +877,7 @@ bool BlockManager::WriteUndoDataForBlock(const CBlockUndo& blockundo, BlockValid
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const int nHeight, const Consensus::Params& consensusParams)
+static bool ReadBlockFromFile(CBlock& block, const FlatFilePos& pos)
 {
     block.SetNull();
 
@@ -759,8 +894,17 @@ bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const int nHeight,
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
     }
 
+    return true;
+}
+
+bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const int nHeight, const Consensus::Params& consensusParams)
+{
+    if (!ReadBlockFromFile(block, pos)) {
+        return false;
+    }
+
     // Check the header
-    if (!CheckProofOfWork(block.GetPoWHash(nHeight), block.nBits, consensusParams)) {
+    if (!CheckBlockProofOfWork(block, nHeight, consensusParams)) {
         return error("ReadBlockFromDisk: Errors in block header at %s, %d", pos.ToString(), nHeight);
     }
 
@@ -774,10 +918,29 @@ bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const int nHeight,
 
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
-    const FlatFilePos block_pos{WITH_LOCK(cs_main, return pindex->GetBlockPos())};
+    FlatFilePos block_pos;
+    bool header_valid;
+    {
+        LOCK(cs_main);
+        block_pos = pindex->GetBlockPos();
+        header_valid = pindex->IsValid(BLOCK_VALID_TREE);
+    }
 
-    if (!ReadBlockFromDisk(block, block_pos, pindex->nHeight, consensusParams)) {
-        return false;
+    if (!header_valid) {
+        if (!ReadBlockFromDisk(block, block_pos, pindex->nHeight, consensusParams)) {
+            return false;
+        }
+    } else {
+        // The header's proof of work was checked when it entered the block
+        // index, and the hash comparison below ties the block read from disk
+        // to that header, so there is no need to compute the (expensive) PoW
+        // hash again.
+        if (!ReadBlockFromFile(block, block_pos)) {
+            return false;
+        }
+        if (consensusParams.signet_blocks && !CheckSignetBlockSolution(block, consensusParams)) {
+            return error("ReadBlockFromDisk: Errors in block solution at %s", block_pos.ToString());
+        }
     }
     if (block.GetHash() != pindex->GetBlockHash()) {
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
@@ -122,6 +122,9 @@ public:
 
     std::unique_ptr<CBlockTreeDB> m_block_tree_db GUARDED_BY(::cs_main);
 
+    /** Number of block index entries with BLOCK_POW_PENDING set */
+    size_t m_pow_pending_headers GUARDED_BY(::cs_main){0};
+
     bool WriteBlockIndexDB() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
     bool LoadBlockIndexDB(ChainstateManager& chainman) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
@@ -134,10 +137,23 @@ public:
         const Consensus::Params& consensus_params,
         ChainstateManager& chainman) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    /**
+     * Check the proof of work of every loaded block index entry, for
+     * -full-startup-verify. The entries are collected under cs_main, but
+     * hashed on a pool of worker threads without it, so this must only run
+     * while nothing else can unload the block index.
+     */
+    bool CheckBlockIndexPoW(const Consensus::Params& consensus_params) LOCKS_EXCLUDED(::cs_main);
+
     /** Clear all data members. */
     void Unload() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
-    CBlockIndex* AddToBlockIndex(const CBlockHeader& block) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    /** Add a header to the block index. With pow_pending it is marked
+     *  BLOCK_POW_PENDING and does not become pindexBestHeader. */
+    CBlockIndex* AddToBlockIndex(const CBlockHeader& block, bool pow_pending = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    /** Clear BLOCK_POW_PENDING from pindex and its ancestors, once a checkpoint
+     *  commits to their proof of work */
+    void ClearPoWPending(CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     /** Create a new block index entry for a given block hash */
     CBlockIndex* InsertBlockIndex(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
@@ -182,7 +198,9 @@ fs::path GetBlockPosFilename(const FlatFilePos& pos);
 void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune);
 
 /** Functions for disk access for blocks */
+/** Read a block and fully check its proof of work. Use for untrusted positions, such as -loadblock imports. */
 bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const int nHeight, const Consensus::Params& consensusParams);
+/** Read the block of a block index entry. The proof of work is not rechecked if the header is already BLOCK_VALID_TREE. */
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start);
 
@@ -27,6 +27,8 @@ class WalletLoader;
 } // namespace interfaces
 
 namespace node {
+class BlockTemplateCache;
+
 //! NodeContext struct containing references to chain state and connection
 //! state.
 //!
@@ -47,6 +49,7 @@ struct NodeContext {
     std::unique_ptr<PeerManager> peerman;
     std::unique_ptr<ChainstateManager> chainman;
     std::unique_ptr<BanMan> banman;
+    std::unique_ptr<BlockTemplateCache> block_template_cache;
     ArgsManager* args{nullptr}; // Currently a raw pointer because the memory is not managed by this struct
     std::unique_ptr<interfaces::Chain> chain;
     //! List of all chain clients (wallet processes or other client) connected to node.
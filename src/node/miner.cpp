@@ -24,6 +24,7 @@
 #include <validation.h>
 
 #include <algorithm>
+#include <limits>
 #include <utility>
 
 namespace node {
@@ -56,6 +57,18 @@ void RegenerateCommitments(CBlock& block, ChainstateManager& chainman)
     block.hashMerkleRoot = BlockMerkleRoot(block);
 }
 
+static CTransactionRef CreateCoinbase(const CScript& script_pub_key, int height, CAmount value)
+{
+    CMutableTransaction coinbaseTx;
+    coinbaseTx.vin.resize(1);
+    coinbaseTx.vin[0].prevout.SetNull();
+    coinbaseTx.vout.resize(1);
+    coinbaseTx.vout[0].scriptPubKey = script_pub_key;
+    coinbaseTx.vout[0].nValue = value;
+    coinbaseTx.vin[0].scriptSig = CScript() << height << OP_0;
+    return MakeTransactionRef(std::move(coinbaseTx));
+}
+
 BlockAssembler::Options::Options()
 {
     blockMinFeeRate = CFeeRate(DEFAULT_BLOCK_MIN_TX_FEE);
@@ -158,14 +171,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     m_last_block_weight = nBlockWeight;
 
     // Create coinbase transaction.
-    CMutableTransaction coinbaseTx;
-    coinbaseTx.vin.resize(1);
-    coinbaseTx.vin[0].prevout.SetNull();
-    coinbaseTx.vout.resize(1);
-    coinbaseTx.vout[0].scriptPubKey = scriptPubKeyIn;
-    coinbaseTx.vout[0].nValue = nFees + GetBlockSubsidy(nHeight, chainparams.GetConsensus());
-    coinbaseTx.vin[0].scriptSig = CScript() << nHeight << OP_0;
-    pblock->vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
+    pblock->vtx[0] = CreateCoinbase(scriptPubKeyIn, nHeight, nFees + GetBlockSubsidy(nHeight, chainparams.GetConsensus()));
     pblocktemplate->vchCoinbaseCommitment = GenerateCoinbaseCommitment(*pblock, pindexPrev, chainparams.GetConsensus());
     pblocktemplate->vTxFees[0] = -nFees;
 
@@ -465,4 +471,222 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
     pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
     pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
 }
+
+static CAmount LongPollFeeDelta()
+{
+    if (gArgs.IsArgSet("-longpollfeedelta")) {
+        return ParseMoney(gArgs.GetArg("-longpollfeedelta", "")).value_or(DEFAULT_LONGPOLL_FEE_DELTA);
+    }
+    return DEFAULT_LONGPOLL_FEE_DELTA;
+}
+
+BlockTemplateCache::BlockTemplateCache(ChainstateManager& chainman, const CTxMemPool& mempool, const CChainParams& params)
+    : m_chainman{chainman}, m_mempool{mempool}, m_params{params}, m_options{DefaultOptions()}, m_longpoll_fee_delta{LongPollFeeDelta()} {}
+
+std::unique_ptr<CBlockTemplate> BlockTemplateCache::GetTemplate(const CScript& script_pub_key, bool fresh)
+{
+    int64_t nTimeStart = GetTimeMicros();
+    LOCK2(cs_main, m_mutex);
+    const CBlockIndex* pindexPrev = m_chainman.ActiveChain().Tip();
+    assert(pindexPrev != nullptr);
+
+    if (fresh || !m_template || m_prev != pindexPrev ||
+        (m_skipped && std::chrono::steady_clock::now() - m_last_build >= TEMPLATE_REBUILD_INTERVAL)) {
+        m_template.reset();
+        std::unique_ptr<CBlockTemplate> block_template{BlockAssembler(m_chainman.ActiveChainstate(), m_mempool, m_params, m_options).CreateNewBlock(script_pub_key)};
+        m_template = std::make_unique<CBlockTemplate>(*block_template);
+        m_prev = pindexPrev;
+        m_height = pindexPrev->nHeight + 1;
+        m_lock_time_cutoff = pindexPrev->GetMedianTimePast();
+        m_include_witness = DeploymentActiveAfter(pindexPrev, m_params.GetConsensus(), Consensus::DEPLOYMENT_SEGWIT);
+        m_skipped = false;
+        m_last_build = std::chrono::steady_clock::now();
+        // Same reservations for the coinbase as BlockAssembler
+        m_weight = 4000;
+        m_sigops_cost = 400;
+        m_fees = 0;
+        m_txids.clear();
+        for (size_t i = 1; i < m_template->block.vtx.size(); ++i) {
+            m_txids.insert(m_template->block.vtx[i]->GetHash());
+            m_weight += GetTransactionWeight(*m_template->block.vtx[i]);
+            m_sigops_cost += m_template->vTxSigOpsCost[i];
+            m_fees += m_template->vTxFees[i];
+        }
+        return block_template;
+    }
+
+    std::unique_ptr<CBlockTemplate> block_template{std::make_unique<CBlockTemplate>(*m_template)};
+    CBlock* const pblock = &block_template->block;
+    pblock->vtx[0] = CreateCoinbase(script_pub_key, m_height, m_fees + GetBlockSubsidy(m_height, m_params.GetConsensus()));
+    block_template->vchCoinbaseCommitment = GenerateCoinbaseCommitment(*pblock, pindexPrev, m_params.GetConsensus());
+    block_template->vTxFees[0] = -m_fees;
+    block_template->vTxSigOpsCost[0] = WITNESS_SCALE_FACTOR * GetLegacySigOpCount(*pblock->vtx[0]);
+    UpdateTime(pblock, m_params.GetConsensus(), pindexPrev);
+    pblock->nNonce = 0;
+
+    BlockAssembler::m_last_block_num_txs = pblock->vtx.size() - 1;
+    BlockAssembler::m_last_block_weight = m_weight;
+    LogPrint(BCLog::BENCH, "BlockTemplateCache: template with %u txs: %.2fms\n", pblock->vtx.size() - 1, 0.001 * (GetTimeMicros() - nTimeStart));
+    return block_template;
+}
+
+bool BlockTemplateCache::WaitForChange(const uint256& prev_hash, unsigned int transactions_updated, std::chrono::steady_clock::time_point deadline, std::function<void()> fn)
+{
+    LOCK(m_mutex);
+    if (m_waits_interrupted) return false;
+    CAmount fees{std::numeric_limits<CAmount>::max()};
+    if (m_longpoll_fee_delta > 0 && m_template && m_prev->GetBlockHash() == prev_hash) {
+        fees = m_fees + m_longpoll_fee_delta;
+    }
+    m_waits.push_back({prev_hash, transactions_updated, deadline, fees, std::move(fn)});
+    return true;
+}
+
+void BlockTemplateCache::CheckWaits()
+{
+    const auto now{std::chrono::steady_clock::now()};
+    const unsigned int transactions_updated{m_mempool.GetTransactionsUpdated()};
+    std::vector<std::function<void()>> ready;
+    {
+        LOCK(m_mutex);
+        ready = TakeWaits([&](const Wait& wait) { return now >= wait.deadline && wait.transactions_updated != transactions_updated; });
+        for (Wait& wait : m_waits) {
+            if (now >= wait.deadline) wait.deadline = now + LONGPOLL_RECHECK_INTERVAL;
+        }
+    }
+    for (const auto& fn : ready) fn();
+}
+
+void BlockTemplateCache::InterruptWaits()
+{
+    std::vector<std::function<void()>> ready;
+    {
+        LOCK(m_mutex);
+        m_waits_interrupted = true;
+        ready = TakeWaits([](const Wait&) { return true; });
+    }
+    for (const auto& fn : ready) fn();
+}
+
+std::vector<std::function<void()>> BlockTemplateCache::TakeWaits(const std::function<bool(const Wait&)>& pred)
+{
+    std::vector<std::function<void()>> taken;
+    for (auto it = m_waits.begin(); it != m_waits.end();) {
+        if (pred(*it)) {
+            taken.push_back(std::move(it->fn));
+            it = m_waits.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return taken;
+}
+
+void BlockTemplateCache::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload)
+{
+    std::vector<std::function<void()>> ready;
+    {
+        LOCK(m_mutex);
+        ready = TakeWaits([&](const Wait& wait) { return wait.prev_hash != pindexNew->GetBlockHash(); });
+    }
+    for (const auto& fn : ready) fn();
+}
+
+void BlockTemplateCache::TransactionAddedToMempool(const CTransactionRef& tx, uint64_t mempool_sequence)
+{
+    std::vector<std::function<void()>> ready;
+    {
+        LOCK(m_mutex);
+        if (!AddToTemplate(tx)) return;
+        const uint256 prev_hash{m_prev->GetBlockHash()};
+        const CAmount fees{m_fees};
+        ready = TakeWaits([&](const Wait& wait) { return wait.prev_hash == prev_hash && fees >= wait.fees; });
+    }
+    for (const auto& fn : ready) fn();
+}
+
+bool BlockTemplateCache::AddToTemplate(const CTransactionRef& tx)
+{
+    if (!m_template || m_txids.count(tx->GetHash())) return false;
+
+    LOCK(m_mempool.cs);
+    // Gone again, or already mined
+    const std::optional<CTxMemPool::txiter> iter{m_mempool.GetIter(tx->GetHash())};
+    if (!iter) return false;
+
+    // The package is the transaction and its ancestors still missing from the template
+    CTxMemPool::setEntries ancestors;
+    uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+    std::string dummy;
+    m_mempool.CalculateMemPoolAncestors(**iter, ancestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
+    ancestors.insert(*iter);
+    std::vector<CTxMemPool::txiter> package;
+    uint64_t package_size{0};
+    CAmount package_fees{0};
+    int64_t package_sigops_cost{0};
+    for (CTxMemPool::txiter it : ancestors) {
+        if (m_txids.count(it->GetTx().GetHash())) continue;
+        if (!IsFinalTx(it->GetTx(), m_height, m_lock_time_cutoff)) return false;
+        if (!m_include_witness && it->GetTx().HasWitness()) return false;
+        package.push_back(it);
+        package_size += it->GetTxSize();
+        package_fees += it->GetModifiedFee();
+        package_sigops_cost += it->GetSigOpCost();
+    }
+
+    if (package_fees < m_options.blockMinFeeRate.GetFee(package_size)) return false;
+    // Same limits as BlockAssembler::TestPackage()
+    const uint64_t max_weight{std::max<size_t>(4000, std::min<size_t>(MAX_BLOCK_WEIGHT - 4000, m_options.nBlockMaxWeight))};
+    if (m_weight + WITNESS_SCALE_FACTOR * package_size >= max_weight ||
+        m_sigops_cost + package_sigops_cost >= MAX_BLOCK_SIGOPS_COST) {
+        m_skipped = true;
+        return false;
+    }
+
+    // Parents before children, as BlockAssembler::SortForBlock()
+    std::sort(package.begin(), package.end(), CompareTxIterByAncestorCount());
+    for (CTxMemPool::txiter it : package) {
+        m_template->block.vtx.emplace_back(it->GetSharedTx());
+        m_template->vTxFees.push_back(it->GetFee());
+        m_template->vTxSigOpsCost.push_back(it->GetSigOpCost());
+        m_txids.insert(it->GetTx().GetHash());
+        m_weight += it->GetTxWeight();
+        m_sigops_cost += it->GetSigOpCost();
+        m_fees += it->GetFee();
+    }
+    return true;
+}
+
+void BlockTemplateCache::TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason, uint64_t mempool_sequence)
+{
+    LOCK(m_mutex);
+    if (!m_template || !m_txids.count(tx->GetHash())) return;
+
+    // Drop the transaction and everything in the template that spends it,
+    // directly or not. Children always come after their parents.
+    std::set<uint256> removed{tx->GetHash()};
+    std::vector<CTransactionRef>& vtx = m_template->block.vtx;
+    size_t kept{1};
+    for (size_t i = 1; i < vtx.size(); ++i) {
+        const CTransaction& block_tx = *vtx[i];
+        const bool spends_removed{std::any_of(block_tx.vin.begin(), block_tx.vin.end(), [&](const CTxIn& txin) {
+            return removed.count(txin.prevout.hash);
+        })};
+        if (removed.count(block_tx.GetHash()) || spends_removed) {
+            removed.insert(block_tx.GetHash());
+            m_txids.erase(block_tx.GetHash());
+            m_weight -= GetTransactionWeight(block_tx);
+            m_sigops_cost -= m_template->vTxSigOpsCost[i];
+            m_fees -= m_template->vTxFees[i];
+            continue;
+        }
+        vtx[kept] = std::move(vtx[i]);
+        m_template->vTxFees[kept] = m_template->vTxFees[i];
+        m_template->vTxSigOpsCost[kept] = m_template->vTxSigOpsCost[i];
+        ++kept;
+    }
+    vtx.resize(kept);
+    m_template->vTxFees.resize(kept);
+    m_template->vTxSigOpsCost.resize(kept);
+}
 } // namespace node
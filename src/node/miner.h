@@ -7,10 +7,16 @@
 #define BITCOIN_NODE_MINER_H
 
 #include <primitives/block.h>
+#include <sync.h>
 #include <txmempool.h>
+#include <validationinterface.h>
 
+#include <chrono>
+#include <functional>
+#include <list>
 #include <memory>
 #include <optional>
+#include <set>
 #include <stdint.h>
 
 #include <boost/multi_index/ordered_index.hpp>
@@ -25,6 +31,12 @@ namespace Consensus { struct Params; };
 
 namespace node {
 static const bool DEFAULT_PRINTPRIORITY = false;
+/** Least time between full rebuilds of a BlockTemplateCache template that turned transactions away */
+static constexpr std::chrono::seconds TEMPLATE_REBUILD_INTERVAL{5};
+/** Growth in template fees that ends a getblocktemplate long poll early, 0 for none */
+static constexpr CAmount DEFAULT_LONGPOLL_FEE_DELTA{0};
+/** How often a long poll past its deadline looks for mempool changes again */
+static constexpr std::chrono::seconds LONGPOLL_RECHECK_INTERVAL{10};
 
 struct CBlockTemplate
 {
@@ -201,6 +213,90 @@ private:
     int UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded, indexed_modified_transaction_set& mapModifiedTx) EXCLUSIVE_LOCKS_REQUIRED(m_mempool.cs);
 };
 
+/**
+ * Keeps the block template for the current tip up to date as transactions
+ * enter and leave the mempool, so handing out work does not re-run package
+ * selection and TestBlockValidity() over the whole mempool every time.
+ *
+ * A transaction entering the mempool is appended together with its
+ * ancestors that are not in the template yet, if that package pays the
+ * minimum fee rate and fits. A transaction leaving the mempool is dropped
+ * with its descendants in the template. Everything appended has passed
+ * mempool validation against the template's tip.
+ *
+ * The template is built from scratch with CreateNewBlock() on a new tip,
+ * on request, and when packages were turned away for lack of room (at most
+ * every TEMPLATE_REBUILD_INTERVAL), as only a full build swaps them in for
+ * lower fee ones.
+ *
+ * It also keeps the getblocktemplate long polls that wait for the template
+ * to change, so that they do not each hold on to a thread.
+ */
+class BlockTemplateCache final : public CValidationInterface
+{
+public:
+    BlockTemplateCache(ChainstateManager& chainman, const CTxMemPool& mempool, const CChainParams& params);
+
+    /** Template with its coinbase paying to script_pub_key. With fresh, it is built from scratch. */
+    std::unique_ptr<CBlockTemplate> GetTemplate(const CScript& script_pub_key, bool fresh = false) LOCKS_EXCLUDED(m_mutex);
+
+    /**
+     * Call fn once the tip is no longer prev_hash, once the fees of the
+     * template grew by -longpollfeedelta, or from deadline on once the mempool
+     * counts other updates than transactions_updated. fn is called from the
+     * thread noticing, without locks held, and must not block. Returns false
+     * without calling fn after InterruptWaits().
+     */
+    bool WaitForChange(const uint256& prev_hash, unsigned int transactions_updated, std::chrono::steady_clock::time_point deadline, std::function<void()> fn) LOCKS_EXCLUDED(m_mutex);
+    /** Check the deadlines of WaitForChange(), to be run every second */
+    void CheckWaits() LOCKS_EXCLUDED(m_mutex);
+    /** Call all waiting functions and refuse to wait from now on, for shutdown */
+    void InterruptWaits() LOCKS_EXCLUDED(m_mutex);
+
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override LOCKS_EXCLUDED(m_mutex);
+    void TransactionAddedToMempool(const CTransactionRef& tx, uint64_t mempool_sequence) override LOCKS_EXCLUDED(m_mutex);
+    void TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason, uint64_t mempool_sequence) override LOCKS_EXCLUDED(m_mutex);
+
+private:
+    struct Wait {
+        uint256 prev_hash;
+        unsigned int transactions_updated;
+        std::chrono::steady_clock::time_point deadline;
+        //! Template fees that end the wait
+        CAmount fees;
+        std::function<void()> fn;
+    };
+
+    /** Append tx and its missing ancestors, returns whether anything was added */
+    bool AddToTemplate(const CTransactionRef& tx) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    /** Remove the waits matching pred and return their functions */
+    std::vector<std::function<void()>> TakeWaits(const std::function<bool(const Wait&)>& pred) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+    ChainstateManager& m_chainman;
+    const CTxMemPool& m_mempool;
+    const CChainParams& m_params;
+    const BlockAssembler::Options m_options;
+    const CAmount m_longpoll_fee_delta;
+
+    Mutex m_mutex;
+    //! Template of the last full build and the transactions appended since.
+    //! Its coinbase is replaced for every caller.
+    std::unique_ptr<CBlockTemplate> m_template GUARDED_BY(m_mutex);
+    const CBlockIndex* m_prev GUARDED_BY(m_mutex){nullptr};
+    std::set<uint256> m_txids GUARDED_BY(m_mutex);
+    uint64_t m_weight GUARDED_BY(m_mutex){0};
+    int64_t m_sigops_cost GUARDED_BY(m_mutex){0};
+    CAmount m_fees GUARDED_BY(m_mutex){0};
+    int m_height GUARDED_BY(m_mutex){0};
+    int64_t m_lock_time_cutoff GUARDED_BY(m_mutex){0};
+    bool m_include_witness GUARDED_BY(m_mutex){false};
+    //! Whether a package was turned away because the template was full
+    bool m_skipped GUARDED_BY(m_mutex){false};
+    std::chrono::steady_clock::time_point m_last_build GUARDED_BY(m_mutex);
+    std::list<Wait> m_waits GUARDED_BY(m_mutex);
+    bool m_waits_interrupted GUARDED_BY(m_mutex){false};
+};
+
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
@@ -2,23 +2,106 @@
 // Copyright (c) 2009-2018 The Bitcoin Core developers
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <vector>
 
 #include <pow.h>
 
 #include <arith_uint256.h>
 #include <chain.h>
 #include <chainparams.h>
+#include <crypto/common.h>
+#include <crypto/sha256.h>
+#include <cuckoocache.h>
 #include <primitives/block.h>
+#include <random.h>
+#include <sync.h>
 #include <uint256.h>
-#include <bignum.h>
+#include <util/hasher.h>
+#include <util/system.h>
 #include <logging.h>
 #include <crypto/verthash.h>
 
+namespace {
+/** EventHorizonDeviation for a mass of up to this many blocks is looked up
+ *  rather than computed; that covers mainnet's and testnet's PastBlocksMax. */
+constexpr uint64_t KGW_TABLE_BLOCKS = 4032;
+
+double EventHorizonDeviation(uint64_t PastBlocksMass)
+{
+    static const std::vector<double> table = [] {
+        std::vector<double> deviation(KGW_TABLE_BLOCKS + 1);
+        for (uint64_t mass = 1; mass <= KGW_TABLE_BLOCKS; mass++) {
+            deviation[mass] = 1 + (0.7084 * std::pow((double(mass)/double(144)), -1.228));
+        }
+        return deviation;
+    }();
+    if (PastBlocksMass <= KGW_TABLE_BLOCKS) return table[PastBlocksMass];
+    return 1 + (0.7084 * std::pow((double(PastBlocksMass)/double(144)), -1.228));
+}
+
+/** The compact form of a target as the bignum implementation encoded it,
+ *  which gave zero a size of one byte */
+unsigned int GetBigNumCompact(const arith_uint256& target)
+{
+    return target == 0 ? 0x01000000 : target.GetCompact();
+}
+
+/** a / d for a small divisor, one 32-bit limb at a time. The limbs are
+ *  divided through a reciprocal of d, as the hardware division of a 64-bit
+ *  number would make up most of the time spent in KGW. */
+arith_uint256 DivideSmall(const arith_uint256& a, uint32_t d)
+{
+    uint256 limbs = ArithToUint256(a);
+#ifdef __SIZEOF_INT128__
+    const uint64_t reciprocal = ~uint64_t{0} / d;
+#endif
+    uint64_t rem = 0;
+    for (int i = 7; i >= 0; i--) {
+        const uint64_t n = (rem << 32) | ReadLE32(limbs.begin() + i * 4);
+#ifdef __SIZEOF_INT128__
+        // The estimate falls short of n / d by at most 2
+        uint64_t q = (uint64_t)(((unsigned __int128)n * reciprocal) >> 64);
+        rem = n - q * d;
+        while (rem >= d) {
+            q++;
+            rem -= d;
+        }
+#else
+        const uint64_t q = n / d;
+        rem = n % d;
+#endif
+        WriteLE32(limbs.begin() + i * 4, q);
+    }
+    return UintToArith256(limbs);
+}
+
+/** floor(a * mul / div), or nullopt if that does not fit in 256 bits */
+std::optional<arith_uint256> MulDiv(const arith_uint256& a, uint64_t mul, uint64_t div)
+{
+    // a * mul / div = q * mul + r * mul / div, where a = q * div + r. As
+    // r < div, the second term never overflows.
+    const arith_uint256 q = a / arith_uint256(div);
+    const arith_uint256 r = a - q * arith_uint256(div);
+    if (mul != 0 && q > ~arith_uint256() / arith_uint256(mul)) return std::nullopt;
+    const arith_uint256 high = q * arith_uint256(mul);
+    const arith_uint256 low = r * arith_uint256(mul) / arith_uint256(div);
+    if (high > ~low) return std::nullopt;
+    return high + low;
+}
+} // namespace
+
 unsigned int GetNextWorkRequired(const CBlockIndex* pindexLast, const CBlockHeader *pblock, const Consensus::Params& params)
 {
-    static CBigNum              bnProofOfWorkLimit(params.powLimit);
-    static CBigNum              bnPreVerthashProofOfWorkLimit(params.preVerthashPowLimit);
+    const arith_uint256         bnProofOfWorkLimit   = UintToArith256(params.powLimit);
     static const int64_t        BlocksTargetSpacing  = 2.5 * 60; // 2.5 minutes
     unsigned int                TimeDaySeconds       = 60 * 60 * 24;
     int64_t                     PastSecondsMin       = TimeDaySeconds * 0.25;
@@ -46,10 +129,10 @@ unsigned int GetNextWorkRequired(const CBlockIndex* pindexLast, const CBlockHead
         }
 
         if(nHeight % 12 != 0) {
-            CBigNum bnNew;
-	        bnNew.SetCompact(pindexLast->nBits);
-	        if (bnNew > bnProofOfWorkLimit) { bnNew = bnProofOfWorkLimit; }
-            return bnNew.GetCompact();
+            arith_uint256 bnNew;
+            bnNew.SetCompact(pindexLast->nBits);
+            if (bnNew > bnProofOfWorkLimit) { bnNew = bnProofOfWorkLimit; }
+            return GetBigNumCompact(bnNew);
         }
     }
     return KimotoGravityWell(pindexLast, pblock, BlocksTargetSpacing, PastBlocksMin, PastBlocksMax, params);
@@ -96,90 +179,237 @@ unsigned int GetNextWorkRequired_Bitcoin(const CBlockIndex* pindexLast, const CB
     return CalculateNextWorkRequired(pindexLast, pindexFirst->GetBlockTime(), params);
 }
 
-unsigned int KimotoGravityWell(const CBlockIndex* pindexLast,
-                               const CBlockHeader *pblock,
-                               uint64_t TargetBlocksSpacingSeconds,
-                               uint64_t PastBlocksMin,
-                               uint64_t PastBlocksMax,
-                               const Consensus::Params& params) {
+namespace {
+/** What KGW reads of a block in its window */
+struct KGWBlock {
+    int64_t nTime;
+    arith_uint256 target;
+    int nHeight;
+    /** Whether the block has no parent, which ends the window like a reset height */
+    bool fFirst;
+
+    explicit KGWBlock(const CBlockIndex* pindex) : nTime(pindex->GetBlockTime()), nHeight(pindex->nHeight), fFirst(pindex->pprev == nullptr)
+    {
+        target.SetCompact(pindex->nBits);
+    }
+};
+
+/** Number of tips KGWWindowCache keeps windows for */
+constexpr size_t KGW_WINDOW_CACHE_TIPS = 4;
+/** Number of blocks a window is extended by when KGW reads past its end */
+constexpr size_t KGW_WINDOW_FILL_BLOCKS = 64;
+
+/**
+ * The windows of up to KGW_TABLE_BLOCKS ancestors (newest first) of the last
+ * few blocks KGW ran on, so that the next header on one of those chains only
+ * adds its parent instead of rewalking thousands of pprev pointers. The
+ * running average starts over from the newest block every time and rounds at
+ * every step, so it cannot be slid along with the window; what is saved is the
+ * pointer chasing and the decoding of compact targets.
+ *
+ * A window holds several tips, so that callers alternating between chains,
+ * like getblocktemplate during header sync or competing forks, do not rebuild
+ * it on every call. It is only filled as deep as KGW reads, which is usually
+ * far less than KGW_TABLE_BLOCKS, as the event horizon ends it.
+ *
+ * Blocks are identified by hash, as CBlockIndex entries can be freed and
+ * their addresses reused (see UnloadBlockIndex). A block that extends none
+ * of the cached ones, e.g. after a reorg, starts a new window in place of
+ * the least recently used one.
+ */
+class KGWWindowCache
+{
+    struct Window {
+        uint256 tip;
+        std::deque<KGWBlock> blocks;
+        //! Whether blocks ends where KGW has to stop: at KGW_TABLE_BLOCKS or
+        //! at the block after the genesis block
+        bool complete{false};
+        uint64_t last_use{0};
+    };
+
+    /** Reads a window, extending it along pprev of the tip when KGW gets to its end */
+    class Iterator
+    {
+        Window* m_window;
+        const CBlockIndex* m_tip;
+        size_t m_pos;
+
+        void Fill() const
+        {
+            if (m_window->complete || m_pos < m_window->blocks.size()) return;
+            const CBlockIndex* pindex = m_window->blocks.empty() ? m_tip : m_tip->GetAncestor(m_window->blocks.back().nHeight - 1);
+            for (size_t i = 0; i < KGW_WINDOW_FILL_BLOCKS && pindex && pindex->nHeight > 0 && m_window->blocks.size() < KGW_TABLE_BLOCKS; ++i, pindex = pindex->pprev) {
+                m_window->blocks.emplace_back(pindex);
+            }
+            m_window->complete = !pindex || pindex->nHeight == 0 || m_window->blocks.size() >= KGW_TABLE_BLOCKS;
+        }
+
+    public:
+        /** The start of window, which is tip */
+        Iterator(Window* window, const CBlockIndex* tip) : m_window(window), m_tip(tip), m_pos(0) { Fill(); }
+        /** The end of window */
+        explicit Iterator(Window* window) : m_window(window), m_tip(nullptr), m_pos(std::numeric_limits<size_t>::max()) {}
+        const KGWBlock& operator*() const { return m_window->blocks[m_pos]; }
+        Iterator& operator++()
+        {
+            ++m_pos;
+            Fill();
+            return *this;
+        }
+        /** Only meant for comparing against end(), which is past every block */
+        bool operator!=(const Iterator& other) const { return m_pos < m_window->blocks.size(); }
+    };
+
+    Mutex m_mutex;
+    std::array<Window, KGW_WINDOW_CACHE_TIPS> m_windows GUARDED_BY(m_mutex);
+    uint64_t m_uses GUARDED_BY(m_mutex){0};
+
+    Window* Find(const uint256& tip) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        for (Window& window : m_windows) {
+            if (window.last_use > 0 && window.tip == tip) return &window;
+        }
+        return nullptr;
+    }
+
+public:
+    template <typename Fn>
+    auto WithWindow(const CBlockIndex* pindexLast, Fn&& fn) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        Window* window = Find(*pindexLast->phashBlock);
+        if (!window) {
+            const Window* parent = pindexLast->pprev && pindexLast->pprev->phashBlock ? Find(*pindexLast->pprev->phashBlock) : nullptr;
+            Window& oldest = *std::min_element(m_windows.begin(), m_windows.end(), [](const Window& a, const Window& b) { return a.last_use < b.last_use; });
+            if (parent) {
+                // Keep the parent's window too, for callers still at the parent
+                if (&oldest != parent) {
+                    oldest.blocks = parent->blocks;
+                    oldest.complete = parent->complete;
+                }
+                oldest.blocks.emplace_front(pindexLast);
+                if (oldest.blocks.size() > KGW_TABLE_BLOCKS) oldest.blocks.pop_back();
+                if (oldest.blocks.size() == KGW_TABLE_BLOCKS) oldest.complete = true;
+            } else {
+                oldest.blocks.clear();
+                oldest.complete = false;
+            }
+            oldest.tip = *pindexLast->phashBlock;
+            window = &oldest;
+        }
+        window->last_use = ++m_uses;
+        return fn(Iterator(window, pindexLast), Iterator(window));
+    }
+};
+
+KGWWindowCache g_kgw_window;
+
+/** Kimoto Gravity Well over the blocks [begin, end), newest first, either the
+ *  cached window or a walk along pprev */
+template <typename Iterator>
+unsigned int KimotoGravityWell(Iterator begin, Iterator end, uint64_t TargetBlocksSpacingSeconds, uint64_t PastBlocksMin, uint64_t PastBlocksMax, const Consensus::Params& params)
+{
     /* current difficulty formula - kimoto gravity well */
-    const CBlockIndex *BlockLastSolved                                = pindexLast;
-    const CBlockIndex *BlockReading                                = pindexLast;
+    const KGWBlock                        BlockLastSolved                                = *begin;
     uint64_t                                PastBlocksMass                                = 0;
     int64_t                                PastRateActualSeconds                = 0;
     int64_t                                PastRateTargetSeconds                = 0;
     double                                PastRateAdjustmentRatio                = double(1);
-    CBigNum                                PastDifficultyAverage;
-    CBigNum                                PastDifficultyAveragePrev;
-    double                                EventHorizonDeviation;
+    arith_uint256                         PastDifficultyAverage;
+    arith_uint256                         PastDifficultyAveragePrev;
     double                                EventHorizonDeviationFast;
     double                                EventHorizonDeviationSlow;
-    static CBigNum                          bnProofOfWorkLimit(params.powLimit);
-    static CBigNum                          bnPreVerthashProofOfWorkLimit(params.preVerthashPowLimit);
-
-    if (BlockLastSolved == NULL || BlockLastSolved->nHeight == 0 || static_cast<uint64_t>(BlockLastSolved->nHeight) < PastBlocksMin) { return UintToArith256(params.powLimit).GetCompact(); }
 
-    for (unsigned int i = 1; BlockReading && BlockReading->nHeight > 0; i++) {
+    unsigned int i = 1;
+    for (Iterator it = begin; it != end; ++it, i++) {
+        const KGWBlock& BlockReading = *it;
         if (PastBlocksMax > 0 && i > PastBlocksMax) { break; }
         PastBlocksMass++;
 
         if (i == 1) {
-            PastDifficultyAverage.SetCompact(BlockReading->nBits);
+            PastDifficultyAverage = BlockReading.target;
         } else {
-            PastDifficultyAverage = ((CBigNum().SetCompact(BlockReading->nBits) - PastDifficultyAveragePrev) / i) + PastDifficultyAveragePrev;
+            // The average moves towards the target by (target - average) / i,
+            // rounded towards zero as the division of a signed bignum did
+            if (BlockReading.target >= PastDifficultyAveragePrev) {
+                PastDifficultyAverage = PastDifficultyAveragePrev + DivideSmall(BlockReading.target - PastDifficultyAveragePrev, i);
+            } else {
+                PastDifficultyAverage = PastDifficultyAveragePrev - DivideSmall(PastDifficultyAveragePrev - BlockReading.target, i);
+            }
         }
         PastDifficultyAveragePrev = PastDifficultyAverage;
 
-        PastRateActualSeconds                        = BlockLastSolved->GetBlockTime() - BlockReading->GetBlockTime();
+        PastRateActualSeconds                        = BlockLastSolved.nTime - BlockReading.nTime;
         PastRateTargetSeconds                        = TargetBlocksSpacingSeconds * PastBlocksMass;
         PastRateAdjustmentRatio                        = double(1);
         if (PastRateActualSeconds < 0) { PastRateActualSeconds = 0; }
         if (PastRateActualSeconds != 0 && PastRateTargetSeconds != 0) {
             PastRateAdjustmentRatio                        = double(PastRateTargetSeconds) / double(PastRateActualSeconds);
         }
-        EventHorizonDeviation                        = 1 + (0.7084 * std::pow((double(PastBlocksMass)/double(144)), -1.228));
-        EventHorizonDeviationFast                = EventHorizonDeviation;
-        EventHorizonDeviationSlow                = 1 / EventHorizonDeviation;
+        EventHorizonDeviationFast                = EventHorizonDeviation(PastBlocksMass);
+        EventHorizonDeviationSlow                = 1 / EventHorizonDeviationFast;
 
         if (PastBlocksMass >= PastBlocksMin) {
-                if ((PastRateAdjustmentRatio <= EventHorizonDeviationSlow) || (PastRateAdjustmentRatio >= EventHorizonDeviationFast)) { assert(BlockReading); break; }
+                if ((PastRateAdjustmentRatio <= EventHorizonDeviationSlow) || (PastRateAdjustmentRatio >= EventHorizonDeviationFast)) { break; }
         }
-        if (BlockReading->pprev == NULL ||
-            (Params().NetworkIDString() == CBaseChainParams::MAIN && (BlockReading->nHeight == 1080000 || BlockReading->nHeight == VERTHASH_FORKBLOCK_MAINNET))) // Don't calculate past fork block on mainnet
+        if (BlockReading.fFirst ||
+            std::find(params.kgwResetHeights.begin(), params.kgwResetHeights.end(), BlockReading.nHeight) != params.kgwResetHeights.end()) // Don't calculate past fork block
         {
-                assert(BlockReading);
                 break;
         }
-        BlockReading = BlockReading->pprev;
     }
 
-    CBigNum bnNew(PastDifficultyAverage);
+    // A target too large for 256 bits is above either limit
+    arith_uint256 bnNew(PastDifficultyAverage);
     if (PastRateActualSeconds != 0 && PastRateTargetSeconds != 0) {
-            bnNew *= PastRateActualSeconds;
-            bnNew /= PastRateTargetSeconds;
+            bnNew = MulDiv(PastDifficultyAverage, PastRateActualSeconds, PastRateTargetSeconds).value_or(~arith_uint256());
     }
 
-    if(Params().NetworkIDString() == CBaseChainParams::MAIN) {
-        if(static_cast<uint64_t>(BlockLastSolved->nHeight)+1 >= VERTHASH_FORKBLOCK_MAINNET) {
-            if (bnNew > bnProofOfWorkLimit) {
-                return bnProofOfWorkLimit.GetCompact();
-            }
-        } else if (bnNew > bnPreVerthashProofOfWorkLimit) {
-            return bnPreVerthashProofOfWorkLimit.GetCompact();
-        }
-    } else if(Params().NetworkIDString() == CBaseChainParams::TESTNET) {
-        if(static_cast<uint64_t>(BlockLastSolved->nHeight)+1 >= VERTHASH_FORKBLOCK_TESTNET) {
-            if (bnNew > bnProofOfWorkLimit) {
-                return bnProofOfWorkLimit.GetCompact();
-            }
-        } else if (bnNew > bnPreVerthashProofOfWorkLimit) {
-            return bnPreVerthashProofOfWorkLimit.GetCompact();
+    const arith_uint256 bnProofOfWorkLimit = UintToArith256(params.powLimit);
+    const arith_uint256 bnPreVerthashProofOfWorkLimit = UintToArith256(params.preVerthashPowLimit);
+    if(params.GetPoWAlgorithm(BlockLastSolved.nHeight + 1) == Consensus::PoWAlgorithm::VERTHASH) {
+        if (bnNew > bnProofOfWorkLimit) {
+            return bnProofOfWorkLimit.GetCompact();
         }
-    } else if (bnNew > bnProofOfWorkLimit) { // REGTEST
-        bnNew = bnProofOfWorkLimit;
-	}
+    } else if (bnNew > bnPreVerthashProofOfWorkLimit) {
+        return bnPreVerthashProofOfWorkLimit.GetCompact();
+    }
 
-    return bnNew.GetCompact();
+    return GetBigNumCompact(bnNew);
+}
+
+/** Reads the window along pprev, for blocks without a hash or windows longer than the cache */
+class KGWWalkIterator
+{
+    const CBlockIndex* m_pindex;
+
+public:
+    explicit KGWWalkIterator(const CBlockIndex* pindex) : m_pindex(pindex && pindex->nHeight > 0 ? pindex : nullptr) {}
+    KGWBlock operator*() const { return KGWBlock(m_pindex); }
+    KGWWalkIterator& operator++()
+    {
+        m_pindex = m_pindex->pprev && m_pindex->pprev->nHeight > 0 ? m_pindex->pprev : nullptr;
+        return *this;
+    }
+    bool operator!=(const KGWWalkIterator& other) const { return m_pindex != other.m_pindex; }
+};
+} // namespace
+
+unsigned int KimotoGravityWell(const CBlockIndex* pindexLast,
+                               const CBlockHeader *pblock,
+                               uint64_t TargetBlocksSpacingSeconds,
+                               uint64_t PastBlocksMin,
+                               uint64_t PastBlocksMax,
+                               const Consensus::Params& params) {
+    if (pindexLast == NULL || pindexLast->nHeight == 0 || static_cast<uint64_t>(pindexLast->nHeight) < PastBlocksMin) { return UintToArith256(params.powLimit).GetCompact(); }
+
+    if (pindexLast->phashBlock && PastBlocksMax > 0 && PastBlocksMax <= KGW_TABLE_BLOCKS) {
+        return g_kgw_window.WithWindow(pindexLast, [&](auto begin, auto end) {
+            return KimotoGravityWell(begin, end, TargetBlocksSpacingSeconds, PastBlocksMin, PastBlocksMax, params);
+        });
+    }
+    return KimotoGravityWell(KGWWalkIterator(pindexLast), KGWWalkIterator(nullptr), TargetBlocksSpacingSeconds, PastBlocksMin, PastBlocksMax, params);
 }
 
 unsigned int CalculateNextWorkRequired(const CBlockIndex* pindexLast, int64_t nFirstBlockTime, const Consensus::Params& params)
@@ -232,3 +462,105 @@ bool CheckProofOfWork(uint256 hash, unsigned int nBits, const Consensus::Params&
 
     return true;
 }
+
+namespace {
+/**
+ * Headers whose proof of work was checked and found valid. Entries are
+ * SHA256(nonce || block hash || height), so peers cannot pick hashes that
+ * collide in the table. Only valid headers are stored: a header with bad
+ * PoW costs its sender a disconnect, not us a second hash.
+ */
+class PoWCache
+{
+    CSHA256 m_salted_hasher;
+    CuckooCache::cache<uint256, SignatureCacheHasher> m_valid;
+    std::shared_mutex m_mutex;
+    std::atomic<size_t> m_max_elements{0};
+    std::atomic<uint64_t> m_hits{0};
+    std::atomic<uint64_t> m_misses{0};
+
+public:
+    PoWCache()
+    {
+        // Fill the first 64-byte chunk like the signature cache does, so the
+        // per-entry hashing starts from a precomputed state
+        const uint256 nonce = GetRandHash();
+        m_salted_hasher.Write(nonce.begin(), 32);
+        m_salted_hasher.Write(nonce.begin(), 32);
+    }
+
+    size_t Setup(size_t bytes)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        const size_t elements = bytes ? m_valid.setup_bytes(bytes) : 0;
+        m_max_elements = elements;
+        return elements;
+    }
+
+    bool Enabled() const { return m_max_elements > 0; }
+
+    uint256 ComputeEntry(const uint256& hash, int nHeight) const
+    {
+        uint256 entry;
+        unsigned char height[4];
+        WriteLE32(height, nHeight);
+        CSHA256 hasher = m_salted_hasher;
+        hasher.Write(hash.begin(), 32).Write(height, sizeof(height)).Finalize(entry.begin());
+        return entry;
+    }
+
+    bool Get(const uint256& entry)
+    {
+        bool found;
+        {
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            found = m_valid.contains(entry, /* erase */ false);
+        }
+        ++(found ? m_hits : m_misses);
+        return found;
+    }
+
+    void Set(const uint256& entry)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_valid.insert(entry);
+    }
+
+    PoWCacheStats Stats() const
+    {
+        PoWCacheStats stats;
+        stats.max_elements = m_max_elements;
+        stats.hits = m_hits;
+        stats.misses = m_misses;
+        return stats;
+    }
+};
+
+PoWCache g_pow_cache;
+} // namespace
+
+void InitPoWCache()
+{
+    const size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetIntArg("-maxpowcachesize", DEFAULT_MAX_POW_CACHE_SIZE)), MAX_MAX_POW_CACHE_SIZE) * ((size_t) 1 << 20);
+    const size_t nElems = g_pow_cache.Setup(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu requested for proof of work cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >>20, nMaxCacheSize>>20, nElems);
+}
+
+bool CheckBlockProofOfWork(const CBlockHeader& block, int nHeight, const Consensus::Params& params, const uint256* pow_hash)
+{
+    if (!g_pow_cache.Enabled()) {
+        return CheckProofOfWork(pow_hash ? *pow_hash : block.GetPoWHash(nHeight), block.nBits, params);
+    }
+
+    const uint256 entry{g_pow_cache.ComputeEntry(block.GetHash(), nHeight)};
+    if (g_pow_cache.Get(entry)) return true;
+    if (!CheckProofOfWork(pow_hash ? *pow_hash : block.GetPoWHash(nHeight), block.nBits, params)) return false;
+    g_pow_cache.Set(entry);
+    return true;
+}
+
+PoWCacheStats GetPoWCacheStats()
+{
+    return g_pow_cache.Stats();
+}
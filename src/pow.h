@@ -8,6 +8,7 @@
 
 #include <consensus/params.h>
 
+#include <stddef.h>
 #include <stdint.h>
 
 class CBlockHeader;
@@ -22,4 +23,30 @@ unsigned int CalculateNextWorkRequired(const CBlockIndex* pindexLast, int64_t nF
 /** Check whether a block hash satisfies the proof-of-work requirement specified by nBits */
 bool CheckProofOfWork(uint256 hash, unsigned int nBits, const Consensus::Params&);
 
+/** Default for -maxpowcachesize, the proof of work cache size in MiB */
+static const unsigned int DEFAULT_MAX_POW_CACHE_SIZE = 4;
+/** Maximum proof of work cache size allowed, in MiB */
+static const int64_t MAX_MAX_POW_CACHE_SIZE = 1024;
+
+/** Size the proof of work cache from -maxpowcachesize. Until this is called,
+ *  and with -maxpowcachesize=0, the cache is not used. */
+void InitPoWCache();
+
+/**
+ * Check the proof of work of a header at nHeight, remembering the headers
+ * that pass so that seeing one again (announced by another peer, submitted
+ * as a full block, read back from disk) does not need its PoW hash again.
+ * pow_hash is the header's PoW hash if the caller computed it already.
+ */
+bool CheckBlockProofOfWork(const CBlockHeader& block, int nHeight, const Consensus::Params&, const uint256* pow_hash = nullptr);
+
+struct PoWCacheStats {
+    //! Number of entries the cache can hold, 0 if it is disabled
+    size_t max_elements{0};
+    uint64_t hits{0};
+    uint64_t misses{0};
+};
+
+PoWCacheStats GetPoWCacheStats();
+
 #endif // BITCOIN_POW_H
@@ -0,0 +1,80 @@
+// Copyright (c) 2021 The Vertcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <powsearch.h>
+
+#include <arith_uint256.h>
+#include <uint256.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <thread>
+#include <vector>
+
+PoWSearchResult SearchNonce(CBlockHeader& header, int nHeight, uint64_t max_tries, int threads, const std::function<bool()>& interrupt)
+{
+    PoWSearchResult result;
+
+    bool neg, over;
+    arith_uint256 target;
+    target.SetCompact(header.nBits, &neg, &over);
+    if (target == 0 || neg || over) return result;
+
+    const auto start_time{std::chrono::steady_clock::now()};
+    const uint64_t first_nonce{header.nNonce};
+    // Offsets from first_nonce that may be hashed
+    const uint64_t limit{std::min<uint64_t>(max_tries, uint64_t{std::numeric_limits<uint32_t>::max()} + 1 - first_nonce)};
+
+    std::atomic<uint64_t> next_offset{0};
+    // Offset of the lowest nonce found so far, limit if none
+    std::atomic<uint64_t> found_offset{limit};
+    std::atomic<uint64_t> hashes{0};
+    std::atomic<bool> interrupted{false};
+
+    const auto worker = [&]() {
+        std::vector<CBlockHeader> batch(POW_SEARCH_BATCH_SIZE, header);
+        const std::vector<int> heights(POW_SEARCH_BATCH_SIZE, nHeight);
+        std::vector<uint256> pow_hashes(POW_SEARCH_BATCH_SIZE);
+        while (!interrupted) {
+            // Batches are handed out in order, so once a nonce is found only
+            // the batches below it are worth finishing
+            const uint64_t offset{next_offset.fetch_add(POW_SEARCH_BATCH_SIZE)};
+            const uint64_t end{found_offset};
+            if (offset >= end) break;
+            const size_t count{(size_t)std::min<uint64_t>(POW_SEARCH_BATCH_SIZE, end - offset)};
+            for (size_t i = 0; i < count; ++i) {
+                batch[i].nNonce = first_nonce + offset + i;
+            }
+            GetPoWHashes(Span{batch}.first(count), Span{heights}.first(count), Span{pow_hashes}.first(count));
+            hashes += count;
+            for (size_t i = 0; i < count; ++i) {
+                if (UintToArith256(pow_hashes[i]) <= target) {
+                    uint64_t lowest{found_offset};
+                    while (offset + i < lowest && !found_offset.compare_exchange_weak(lowest, offset + i)) {}
+                    break;
+                }
+            }
+            if (interrupt && interrupt()) interrupted = true;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    result.hashes = hashes;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    if (found_offset < limit) {
+        result.found = true;
+        header.nNonce = first_nonce + found_offset;
+    }
+    return result;
+}
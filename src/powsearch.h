@@ -0,0 +1,41 @@
+// Copyright (c) 2021 The Vertcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_POWSEARCH_H
+#define BITCOIN_POWSEARCH_H
+
+#include <primitives/block.h>
+
+#include <cstdint>
+#include <functional>
+
+/** Nonces hashed together by a thread of SearchNonce() */
+static constexpr uint32_t POW_SEARCH_BATCH_SIZE = 32;
+
+struct PoWSearchResult {
+    //! Whether a nonce was found. If so, the header's nNonce is set to it.
+    bool found{false};
+    //! Number of nonces hashed
+    uint64_t hashes{0};
+    //! Time spent searching, in seconds
+    double seconds{0};
+
+    double HashRate() const { return seconds > 0 ? hashes / seconds : 0; }
+};
+
+/**
+ * Search for a nonce that gives header a proof of work hash meeting its
+ * nBits. The hash is GetPoWHash(nHeight), the one consensus checks, so the
+ * height selects the algorithm. Nonces from header.nNonce upwards are
+ * handed out to the threads in batches, which are hashed with
+ * GetPoWHashes() so Verthash can overlap their lookups. The lowest
+ * qualifying nonce is returned.
+ *
+ * The search stops after max_tries hashes, at the end of the nonce space,
+ * or once interrupt() returns true. The caller then moves on to the next
+ * extra nonce.
+ */
+PoWSearchResult SearchNonce(CBlockHeader& header, int nHeight, uint64_t max_tries, int threads, const std::function<bool()>& interrupt = nullptr);
+
+#endif // BITCOIN_POWSEARCH_H
@@ -10,7 +10,7 @@
 #include <util/strencodings.h>
 #include <crypto/common.h>
 #include <chainparams.h>
-#include <crypto/verthash.h>
+#include <primitives/powhash.h>
 
 uint256 CBlockHeader::GetHash() const
 {
@@ -19,32 +19,30 @@ uint256 CBlockHeader::GetHash() const
 
 uint256 CBlockHeader::GetPoWHash(const int nHeight) const
 {
-   uint256 thash;
-   char *out = ((char *)(thash.begin()));
+    uint256 thash;
+    PoWHash::Dispatch(Params().GetConsensus().GetPoWAlgorithm(nHeight), [&](auto hasher) {
+        decltype(hasher)::Hash(this->begin(), (char*)thash.begin());
+    });
+    return thash;
+}
+
+void GetPoWHashes(Span<const CBlockHeader> headers, Span<const int> heights, Span<uint256> hashes)
+{
+    assert(headers.size() == heights.size() && headers.size() == hashes.size());
 
-   if((Params().NetworkIDString() == CBaseChainParams::TESTNET && nHeight >= VERTHASH_FORKBLOCK_TESTNET) ||
-       (Params().NetworkIDString() == CBaseChainParams::MAIN && nHeight >= VERTHASH_FORKBLOCK_MAINNET) ||
-       (Params().NetworkIDString() == CBaseChainParams::REGTEST))
-   {
-       Verthash::Hash(this->begin(), out);
-   }
-   else if((Params().NetworkIDString() == CBaseChainParams::TESTNET && nHeight > 158220) || nHeight > 1080000)
-   {
-        lyra2re3_hash(this->begin(), out);
-   }
-   else if(Params().NetworkIDString() == CBaseChainParams::TESTNET || nHeight >= 347000) // New Lyra2re2 Testnet
-   {
-        lyra2re2_hash(this->begin(), out);
-   }
-   else if(nHeight >= 208301)
-   {
-   	    lyra2re_hash(this->begin(), out);
-   }
-   else
-   {
-   	    scrypt_N_1_1_256(this->begin(), out, 10);
-   }
-   return thash;
+    const Consensus::Params& consensus = Params().GetConsensus();
+    // Hash runs of headers with the same algorithm together; batches
+    // usually are consecutive headers, so there are at most a few runs
+    size_t begin = 0;
+    while (begin < headers.size()) {
+        const Consensus::PoWAlgorithm algorithm = consensus.GetPoWAlgorithm(heights[begin]);
+        size_t end = begin + 1;
+        while (end < headers.size() && consensus.GetPoWAlgorithm(heights[end]) == algorithm) end++;
+        PoWHash::Dispatch(algorithm, [&](auto hasher) {
+            PoWHash::HashHeaders<decltype(hasher)>(headers.subspan(begin, end - begin), hashes.subspan(begin, end - begin));
+        });
+        begin = end;
+    }
 }
 
 std::string CBlock::ToString() const
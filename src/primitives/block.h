@@ -8,6 +8,7 @@
 
 #include <primitives/transaction.h>
 #include <serialize.h>
+#include <span.h>
 #include <uint256.h>
 
 #include <crypto/scrypt.h>
@@ -118,6 +119,11 @@ public:
     std::string ToString() const;
 };
 
+/** Compute GetPoWHash() for several headers at once, heights[i] being the height
+ *  of headers[i]. Verthash-era headers are hashed together through
+ *  Verthash::HashBatch() so their datafile lookups overlap. */
+void GetPoWHashes(Span<const CBlockHeader> headers, Span<const int> heights, Span<uint256> hashes);
+
 /** Describes a place in the block chain to another node such that if the
  * other node doesn't have the same branch, it can find a recent common trunk.
  * The further back it is, the further before the fork it may be.
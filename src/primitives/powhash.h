@@ -0,0 +1,136 @@
+// Copyright (c) 2021 The Vertcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef VERTCOIN_PRIMITIVES_POWHASH_H
+#define VERTCOIN_PRIMITIVES_POWHASH_H
+
+#include <consensus/params.h>
+#include <crypto/Lyra2RE/Lyra2RE.h>
+#include <crypto/scrypt.h>
+#include <crypto/verthash.h>
+#include <primitives/block.h>
+#include <span.h>
+#include <uint256.h>
+
+#include <assert.h>
+#include <vector>
+
+/**
+ * Function objects for the proof-of-work algorithms in Consensus::PoWAlgorithm.
+ *
+ * Each hasher hashes one serialized 80-byte header with Hash(). Code hashing
+ * many headers of the same algorithm can take the hasher as a template
+ * parameter (see HashHeaders()) so the choice is made once per batch rather
+ * than once per header.
+ */
+namespace PoWHash {
+
+struct ScryptN {
+    static void Hash(const char* input, char* output) { scrypt_N_1_1_256(input, output, 10); }
+};
+
+struct Lyra2RE {
+    static void Hash(const char* input, char* output) { lyra2re_hash(input, output); }
+};
+
+struct Lyra2REv2 {
+    static void Hash(const char* input, char* output) { lyra2re2_hash(input, output); }
+};
+
+struct Lyra2REv3 {
+    static void Hash(const char* input, char* output) { lyra2re3_hash(input, output); }
+};
+
+struct Verthash {
+    static void Hash(const char* input, char* output) { ::Verthash::Hash(input, output); }
+};
+
+/** Hash headers with one algorithm. */
+template <typename Hasher>
+void HashHeaders(Span<const CBlockHeader> headers, Span<uint256> hashes)
+{
+    assert(headers.size() == hashes.size());
+    for (size_t i = 0; i < headers.size(); i++) {
+        Hasher::Hash(headers[i].begin(), (char*)hashes[i].begin());
+    }
+}
+
+/** Verthash headers are hashed together so their datafile lookups overlap. */
+template <>
+inline void HashHeaders<Verthash>(Span<const CBlockHeader> headers, Span<uint256> hashes)
+{
+    assert(headers.size() == hashes.size());
+    std::vector<const char*> inputs;
+    inputs.reserve(headers.size());
+    for (const CBlockHeader& header : headers) {
+        inputs.push_back(header.begin());
+    }
+    ::Verthash::HashBatch(inputs, hashes);
+}
+
+/** Scrypt-N, Lyra2REv2 and Lyra2REv3 headers are hashed a few at a time, see
+ *  scrypt_N_1_1_256_batch() and lyra2re2_hash_batch() */
+template <typename BatchFn>
+void HashHeadersBatch(BatchFn batch, Span<const CBlockHeader> headers, Span<uint256> hashes)
+{
+    assert(headers.size() == hashes.size());
+    std::vector<const char*> inputs;
+    std::vector<char*> outputs;
+    inputs.reserve(headers.size());
+    outputs.reserve(headers.size());
+    for (size_t i = 0; i < headers.size(); i++) {
+        inputs.push_back(headers[i].begin());
+        outputs.push_back((char*)hashes[i].begin());
+    }
+    batch(inputs.data(), outputs.data(), headers.size());
+}
+
+template <>
+inline void HashHeaders<ScryptN>(Span<const CBlockHeader> headers, Span<uint256> hashes)
+{
+    HashHeadersBatch([](const char* const* inputs, char* const* outputs, size_t count) {
+        scrypt_N_1_1_256_batch(inputs, outputs, count, 10);
+    }, headers, hashes);
+}
+
+template <>
+inline void HashHeaders<Lyra2REv2>(Span<const CBlockHeader> headers, Span<uint256> hashes)
+{
+    HashHeadersBatch(lyra2re2_hash_batch, headers, hashes);
+}
+
+template <>
+inline void HashHeaders<Lyra2REv3>(Span<const CBlockHeader> headers, Span<uint256> hashes)
+{
+    HashHeadersBatch(lyra2re3_hash_batch, headers, hashes);
+}
+
+/** Call fn with a (stateless) instance of the hasher of an algorithm, e.g.
+ *  Dispatch(algo, [&](auto hasher) { HashHeaders<decltype(hasher)>(...); }) */
+template <typename Fn>
+void Dispatch(Consensus::PoWAlgorithm algorithm, Fn&& fn)
+{
+    switch (algorithm) {
+    case Consensus::PoWAlgorithm::SCRYPT_N:
+        fn(ScryptN{});
+        return;
+    case Consensus::PoWAlgorithm::LYRA2RE:
+        fn(Lyra2RE{});
+        return;
+    case Consensus::PoWAlgorithm::LYRA2REV2:
+        fn(Lyra2REv2{});
+        return;
+    case Consensus::PoWAlgorithm::LYRA2REV3:
+        fn(Lyra2REv3{});
+        return;
+    case Consensus::PoWAlgorithm::VERTHASH:
+        fn(Verthash{});
+        return;
+    } // no default case, so the compiler can warn about missing cases
+    assert(false);
+}
+
+} // namespace PoWHash
+
+#endif // VERTCOIN_PRIMITIVES_POWHASH_H
@@ -30,6 +30,7 @@
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <policy/rbf.h>
+#include <pow.h>
 #include <primitives/transaction.h>
 #include <rpc/server.h>
 #include <rpc/server_util.h>
@@ -426,6 +427,34 @@ static RPCHelpMan getdifficulty()
     };
 }
 
+static RPCHelpMan getpowcacheinfo()
+{
+    return RPCHelpMan{"getpowcacheinfo",
+                "\nReturns statistics of the cache of headers with valid proof of work.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "maxentries", "maximum number of headers the cache holds, 0 if it is disabled (-maxpowcachesize=0)"},
+                        {RPCResult::Type::NUM, "hits", "number of proof of work checks answered by the cache"},
+                        {RPCResult::Type::NUM, "misses", "number of proof of work checks that had to hash the header"},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getpowcacheinfo", "")
+            + HelpExampleRpc("getpowcacheinfo", "")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const PoWCacheStats stats{GetPoWCacheStats()};
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("maxentries", (uint64_t)stats.max_elements);
+    ret.pushKV("hits", stats.hits);
+    ret.pushKV("misses", stats.misses);
+    return ret;
+},
+    };
+}
+
 static std::vector<RPCResult> MempoolEntryDescription() { return {
     RPCResult{RPCResult::Type::NUM, "vsize", "virtual transaction size as defined in BIP 141. This is different from actual serialized size for witness transactions as witness data is discounted."},
     RPCResult{RPCResult::Type::NUM, "weight", "transaction weight as defined in BIP 141."},
@@ -2842,6 +2871,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         &getblockheader,                     },
     { "blockchain",         &getchaintips,                       },
     { "blockchain",         &getdifficulty,                      },
+    { "blockchain",         &getpowcacheinfo,                    },
     { "blockchain",         &getdeploymentinfo,                  },
     { "blockchain",         &getmempoolancestors,                },
     { "blockchain",         &getmempooldescendants,              },
@@ -18,6 +18,7 @@
 #include <node/miner.h>
 #include <policy/fees.h>
 #include <pow.h>
+#include <powsearch.h>
 #include <rpc/blockchain.h>
 #include <rpc/mining.h>
 #include <rpc/server.h>
@@ -38,10 +39,12 @@
 #include <validationinterface.h>
 #include <warnings.h>
 
+#include <atomic>
 #include <memory>
 #include <stdint.h>
 
 using node::BlockAssembler;
+using node::BlockTemplateCache;
 using node::CBlockTemplate;
 using node::IncrementExtraNonce;
 using node::NodeContext;
@@ -116,26 +119,30 @@ static RPCHelpMan getnetworkhashps()
     };
 }
 
+/** Hash rate of the last block search by the generate RPCs, 0 before the first */
+static std::atomic<double> g_generate_hashps{0};
+
 static bool GenerateBlock(ChainstateManager& chainman, CBlock& block, uint64_t& max_tries, unsigned int& extra_nonce, uint256& block_hash)
 {
     block_hash.SetNull();
 
+    int nHeight;
     {
         LOCK(cs_main);
         IncrementExtraNonce(&block, chainman.ActiveChain().Tip(), extra_nonce);
+        nHeight = chainman.ActiveChain().Height() + 1;
     }
 
     CChainParams chainparams(Params());
 
-    while (max_tries > 0 && block.nNonce < std::numeric_limits<uint32_t>::max() && !CheckProofOfWork(block.GetHash(), block.nBits, chainparams.GetConsensus()) && !ShutdownRequested()) {
-        ++block.nNonce;
-        --max_tries;
-    }
-    if (max_tries == 0 || ShutdownRequested()) {
-        return false;
-    }
-    if (block.nNonce == std::numeric_limits<uint32_t>::max()) {
-        return true;
+    int threads = gArgs.GetIntArg("-genproclimit", DEFAULT_GENERATE_THREADS);
+    if (threads <= 0) threads = std::max(GetNumCores(), 1);
+    const PoWSearchResult search{SearchNonce(block, nHeight, max_tries, threads, ShutdownRequested)};
+    max_tries -= search.hashes;
+    g_generate_hashps = search.HashRate();
+    if (!search.found) {
+        // Unless out of tries, the nonce space ran out: continue with the next extra nonce
+        return max_tries > 0 && !ShutdownRequested();
     }
 
     std::shared_ptr<const CBlock> shared_pblock = std::make_shared<const CBlock>(block);
@@ -423,6 +430,7 @@ static RPCHelpMan getmininginfo()
                         {RPCResult::Type::NUM, "currentblocktx", /*optional=*/true, "The number of block transactions of the last assembled block (only present if a block was ever assembled)"},
                         {RPCResult::Type::NUM, "difficulty", "The current difficulty"},
                         {RPCResult::Type::NUM, "networkhashps", "The network hashes per second"},
+                        {RPCResult::Type::NUM, "localhashps", /*optional=*/true, "The hashes per second of the last block search by the generate RPCs (only present if they were ever called)"},
                         {RPCResult::Type::NUM, "pooledtx", "The size of the mempool"},
                         {RPCResult::Type::STR, "chain", "current network name (main, test, signet, regtest)"},
                         {RPCResult::Type::STR, "warnings", "any network and blockchain warnings"},
@@ -445,6 +453,7 @@ static RPCHelpMan getmininginfo()
     if (BlockAssembler::m_last_block_num_txs) obj.pushKV("currentblocktx", *BlockAssembler::m_last_block_num_txs);
     obj.pushKV("difficulty",       (double)GetDifficulty(active_chain.Tip()));
     obj.pushKV("networkhashps",    getnetworkhashps().HandleRequest(request));
+    if (g_generate_hashps > 0) obj.pushKV("localhashps", g_generate_hashps.load());
     obj.pushKV("pooledtx",         (uint64_t)mempool.size());
     obj.pushKV("chain",            Params().NetworkIDString());
     obj.pushKV("warnings",         GetWarnings(false).original);
@@ -543,6 +552,7 @@ static RPCHelpMan getblocktemplate()
                     {"segwit", RPCArg::Type::STR, RPCArg::Optional::NO, "(literal) indicates client side segwit support"},
                     {"str", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "other client side supported softfork deployment"},
                 }},
+                {"fresh", RPCArg::Type::BOOL, RPCArg::Default{false}, "Select transactions from the whole mempool again, instead of updating the template kept since the last block"},
             },
                         "\"template_request\""},
         },
@@ -617,6 +627,7 @@ static RPCHelpMan getblocktemplate()
 
     std::string strMode = "template";
     UniValue lpval = NullUniValue;
+    bool fresh{false};
     std::set<std::string> setClientRules;
     int64_t nMaxVersionPreVB = -1;
     CChainState& active_chainstate = chainman.ActiveChainstate();
@@ -634,6 +645,10 @@ static RPCHelpMan getblocktemplate()
         else
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid mode");
         lpval = find_value(oparam, "longpollid");
+        const UniValue& freshval = find_value(oparam, "fresh");
+        if (!freshval.isNull()) {
+            fresh = freshval.get_bool();
+        }
 
         if (strMode == "proposal")
         {
@@ -718,6 +733,33 @@ static RPCHelpMan getblocktemplate()
             nTransactionsUpdatedLastLP = nTransactionsUpdatedLast;
         }
 
+        if (request.defer && active_chain.Tip()->GetBlockHash() == hashWatchedChain) {
+            // Have the template cache answer once the template changes,
+            // instead of blocking this thread
+            JSONRPCRequest next{request};
+            next.defer = nullptr;
+            UniValue next_param(UniValue::VOBJ);
+            const UniValue& oparam = request.params[0].get_obj();
+            for (size_t i = 0; i < oparam.size(); ++i) {
+                if (oparam.getKeys()[i] != "longpollid") next_param.pushKV(oparam.getKeys()[i], oparam.getValues()[i]);
+            }
+            next.params = UniValue(UniValue::VARR);
+            next.params.push_back(next_param);
+
+            BlockTemplateCache& cache{EnsureBlockTemplateCache(node)};
+            const RPCDeferredReply reply{request.defer()};
+            const auto deadline{std::chrono::steady_clock::now() + std::chrono::minutes(1)};
+            const auto work = [next] {
+                if (!IsRPCRunning())
+                    throw JSONRPCError(RPC_CLIENT_NOT_CONNECTED, "Shutting down");
+                return tableRPC.execute(next);
+            };
+            if (!cache.WaitForChange(hashWatchedChain, nTransactionsUpdatedLastLP, deadline, [reply, work] { reply(work); })) {
+                reply(work);
+            }
+            return NullUniValue;
+        }
+
         // Release lock while waiting
         LEAVE_CRITICAL_SECTION(cs_main);
         {
@@ -755,31 +797,15 @@ static RPCHelpMan getblocktemplate()
         throw JSONRPCError(RPC_INVALID_PARAMETER, "getblocktemplate must be called with the segwit rule set (call with {\"rules\": [\"segwit\"]})");
     }
 
-    // Update block
-    static CBlockIndex* pindexPrev;
-    static int64_t nStart;
-    static std::unique_ptr<CBlockTemplate> pblocktemplate;
-    if (pindexPrev != active_chain.Tip() ||
-        (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 5))
-    {
-        // Clear pindexPrev so future calls make a new block, despite any failures from here on
-        pindexPrev = nullptr;
-
-        // Store the pindexBest used before CreateNewBlock, to avoid races
-        nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
-        CBlockIndex* pindexPrevNew = active_chain.Tip();
-        nStart = GetTime();
-
-        // Create new block
-        CScript scriptDummy = CScript() << OP_TRUE;
-        pblocktemplate = BlockAssembler(active_chainstate, mempool, Params()).CreateNewBlock(scriptDummy);
-        if (!pblocktemplate)
-            throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
-
-        // Need to update only after we know CreateNewBlock succeeded
-        pindexPrev = pindexPrevNew;
-    }
+    // Update block. The cache keeps the template in step with the mempool,
+    // so this is cheap unless the tip changed or a fresh one was asked for.
+    nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
+    const CBlockIndex* pindexPrev = active_chain.Tip();
     CHECK_NONFATAL(pindexPrev);
+    CScript scriptDummy = CScript() << OP_TRUE;
+    std::unique_ptr<CBlockTemplate> pblocktemplate = EnsureBlockTemplateCache(node).GetTemplate(scriptDummy, fresh);
+    if (!pblocktemplate)
+        throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
     CBlock* pblock = &pblocktemplate->block; // pointer for convenience
 
     // Update nTime
@@ -949,6 +975,8 @@ public:
     uint256 hash;
     bool found;
     BlockValidationState state;
+    //! When the block was handed to peers (GetTimeMicros()), 0 if it was not
+    int64_t announced{0};
 
     explicit submitblock_StateCatcher(const uint256 &hashIn) : hash(hashIn), found(false), state() {}
 
@@ -959,6 +987,10 @@ protected:
         found = true;
         state = stateIn;
     }
+
+    void NewPoWValidBlock(const CBlockIndex* pindex, const std::shared_ptr<const CBlock>& block) override {
+        if (block->GetHash() == hash) announced = GetTimeMicros();
+    }
 };
 
 static RPCHelpMan submitblock()
@@ -970,10 +1002,23 @@ static RPCHelpMan submitblock()
         {
             {"hexdata", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "the hex-encoded block data to submit"},
             {"dummy", RPCArg::Type::STR, RPCArg::DefaultHint{"ignored"}, "dummy value, for compatibility with BIP22. This value is ignored."},
+            {"verbose", RPCArg::Type::BOOL, RPCArg::Default{false}, "Return an object with the result and the time spent in each phase"},
         },
         {
             RPCResult{"If the block was accepted", RPCResult::Type::NONE, "", ""},
             RPCResult{"Otherwise", RPCResult::Type::STR, "", "According to BIP22"},
+            RPCResult{"If verbose is set", RPCResult::Type::OBJ, "", "",
+                {
+                    {RPCResult::Type::STR, "result", /*optional=*/true, "According to BIP22, omitted if the block was accepted"},
+                    {RPCResult::Type::OBJ, "timings", "Microseconds spent",
+                        {
+                            {RPCResult::Type::NUM, "decode", "decoding the block"},
+                            {RPCResult::Type::NUM, "pow", "hashing the proof of work"},
+                            {RPCResult::Type::NUM, "announce", /*optional=*/true, "from the start of validation until the block was announced to high-bandwidth compact block peers, omitted if it was not"},
+                            {RPCResult::Type::NUM, "validation", "checking, storing and connecting the block"},
+                            {RPCResult::Type::NUM, "total", "the whole call"},
+                        }},
+                }},
         },
         RPCExamples{
                     HelpExampleCli("submitblock", "\"mydata\"")
@@ -981,6 +1026,9 @@ static RPCHelpMan submitblock()
                 },
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
+    const int64_t nTimeStart = GetTimeMicros();
+    const bool verbose{!request.params[2].isNull() && request.params[2].get_bool()};
+
     std::shared_ptr<CBlock> blockptr = std::make_shared<CBlock>();
     CBlock& block = *blockptr;
     if (!DecodeHexBlk(block, request.params[0].get_str())) {
@@ -990,6 +1038,25 @@ static RPCHelpMan submitblock()
     if (block.vtx.empty() || !block.vtx[0]->IsCoinBase()) {
         throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "Block does not start with a coinbase");
     }
+    const int64_t nTimeDecode = GetTimeMicros();
+    int64_t nTimePoW = nTimeDecode;
+    int64_t nTimeValidation = nTimeDecode;
+    int64_t announced = 0;
+
+    const auto reply = [&](UniValue result) {
+        const int64_t nTimeEnd = GetTimeMicros();
+        if (!verbose) return result;
+        UniValue timings(UniValue::VOBJ);
+        timings.pushKV("decode", nTimeDecode - nTimeStart);
+        timings.pushKV("pow", nTimePoW - nTimeDecode);
+        if (announced) timings.pushKV("announce", announced - nTimePoW);
+        timings.pushKV("validation", nTimeValidation - nTimePoW);
+        timings.pushKV("total", nTimeEnd - nTimeStart);
+        UniValue ret(UniValue::VOBJ);
+        if (!result.isNull()) ret.pushKV("result", result);
+        ret.pushKV("timings", timings);
+        return ret;
+    };
 
     ChainstateManager& chainman = EnsureAnyChainman(request.context);
     uint256 hash = block.GetHash();
@@ -998,34 +1065,47 @@ static RPCHelpMan submitblock()
         const CBlockIndex* pindex = chainman.m_blockman.LookupBlockIndex(hash);
         if (pindex) {
             if (pindex->IsValid(BLOCK_VALID_SCRIPTS)) {
-                return "duplicate";
+                return reply("duplicate");
             }
             if (pindex->nStatus & BLOCK_FAILED_MASK) {
-                return "duplicate-invalid";
+                return reply("duplicate-invalid");
             }
         }
     }
 
+    PrecomputedPoWHash pow_hash;
     {
         LOCK(cs_main);
         const CBlockIndex* pindex = chainman.m_blockman.LookupBlockIndex(block.hashPrevBlock);
         if (pindex) {
             UpdateUncommittedBlockStructures(block, pindex, Params().GetConsensus());
+            pow_hash.height = pindex->nHeight + 1;
         }
     }
 
+    // Hash the proof of work here, without holding cs_main, so that
+    // validation only has to check it before announcing the block
+    if (pow_hash.height >= 0) {
+        pow_hash.hash = block.GetPoWHash(pow_hash.height);
+    }
+    nTimePoW = GetTimeMicros();
+
     bool new_block;
     auto sc = std::make_shared<submitblock_StateCatcher>(block.GetHash());
     RegisterSharedValidationInterface(sc);
-    bool accepted = chainman.ProcessNewBlock(Params(), blockptr, /*force_processing=*/true, /*new_block=*/&new_block);
+    bool accepted = chainman.ProcessNewBlock(Params(), blockptr, /*force_processing=*/true, /*new_block=*/&new_block, pow_hash.height >= 0 ? &pow_hash : nullptr);
     UnregisterSharedValidationInterface(sc);
+    nTimeValidation = GetTimeMicros();
+    announced = sc->announced;
+    LogPrint(BCLog::BENCH, "submitblock %s: decode %.2fms, pow %.2fms, announce %.2fms, validation %.2fms\n", hash.ToString(),
+             0.001 * (nTimeDecode - nTimeStart), 0.001 * (nTimePoW - nTimeDecode), announced ? 0.001 * (announced - nTimePoW) : 0.0, 0.001 * (nTimeValidation - nTimePoW));
     if (!new_block && accepted) {
-        return "duplicate";
+        return reply("duplicate");
     }
     if (!sc->found) {
-        return "inconclusive";
+        return reply("inconclusive");
     }
-    return BIP22ValidationResult(sc->state);
+    return reply(BIP22ValidationResult(sc->state));
 },
     };
 }
@@ -7,6 +7,7 @@
 #define BITCOIN_RPC_REQUEST_H
 
 #include <any>
+#include <functional>
 #include <string>
 
 #include <univalue.h>
@@ -25,6 +26,10 @@ void DeleteAuthCookie();
 /** Parse JSON-RPC batch reply into a vector */
 std::vector<UniValue> JSONRPCProcessBatchReply(const UniValue& in);
 
+/** Finishes a deferred request: runs the function on a thread of the
+ * transport and replies with what it returns or throws. */
+typedef std::function<void(std::function<UniValue()>)> RPCDeferredReply;
+
 class JSONRPCRequest
 {
 public:
@@ -36,6 +41,10 @@ public:
     std::string authUser;
     std::string peerAddr;
     std::any context;
+    //! Set by transports that can reply after the handler returned. A handler
+    //! that would block calls it instead, arranges for the result to be passed
+    //! to the returned function, and returns without throwing.
+    std::function<RPCDeferredReply()> defer;
 
     void parse(const UniValue& valRequest);
 };
@@ -6,6 +6,7 @@
 
 #include <net_processing.h>
 #include <node/context.h>
+#include <node/miner.h>
 #include <policy/fees.h>
 #include <rpc/protocol.h>
 #include <rpc/request.h>
@@ -15,6 +16,7 @@
 
 #include <any>
 
+using node::BlockTemplateCache;
 using node::NodeContext;
 
 NodeContext& EnsureAnyNodeContext(const std::any& context)
@@ -93,3 +95,11 @@ PeerManager& EnsurePeerman(const NodeContext& node)
     }
     return *node.peerman;
 }
+
+BlockTemplateCache& EnsureBlockTemplateCache(const NodeContext& node)
+{
+    if (!node.block_template_cache) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block template cache not found");
+    }
+    return *node.block_template_cache;
+}
@@ -14,6 +14,7 @@ class CTxMemPool;
 class ChainstateManager;
 class PeerManager;
 namespace node {
+class BlockTemplateCache;
 struct NodeContext;
 } // namespace node
 
@@ -28,5 +29,6 @@ CBlockPolicyEstimator& EnsureFeeEstimator(const node::NodeContext& node);
 CBlockPolicyEstimator& EnsureAnyFeeEstimator(const std::any& context);
 CConnman& EnsureConnman(const node::NodeContext& node);
 PeerManager& EnsurePeerman(const node::NodeContext& node);
+node::BlockTemplateCache& EnsureBlockTemplateCache(const node::NodeContext& node);
 
 #endif // BITCOIN_RPC_SERVER_UTIL_H
@@ -0,0 +1,644 @@
+// Copyright (c) 2021 The Vertcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <stratum.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <consensus/merkle.h>
+#include <core_io.h>
+#include <crypto/common.h>
+#include <hash.h>
+#include <key_io.h>
+#include <logging.h>
+#include <netaddress.h>
+#include <netbase.h>
+#include <node/context.h>
+#include <node/miner.h>
+#include <pow.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/script.h>
+#include <script/standard.h>
+#include <serialize.h>
+#include <streams.h>
+#include <sync.h>
+#include <tinyformat.h>
+#include <txmempool.h>
+#include <univalue.h>
+#include <util/strencodings.h>
+#include <util/syscall_sandbox.h>
+#include <util/system.h>
+#include <util/thread.h>
+#include <util/time.h>
+#include <validation.h>
+#include <validationinterface.h>
+#include <version.h>
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/listener.h>
+#include <event2/thread.h>
+
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <limits>
+#include <map>
+#include <memory>
+#include <set>
+#include <thread>
+
+using node::CBlockTemplate;
+
+/** Maximum length of a line from a miner, submits are well below this */
+static const size_t MAX_STRATUM_LINE_LENGTH = 16384;
+/** Jobs kept for late submits within the same tip */
+static const size_t MAX_STRATUM_JOBS = 16;
+/** Shares remembered for duplicate detection before the oldest are forgotten */
+static const size_t MAX_STRATUM_SHARES = 100000;
+/** How often to hand out a new job with the latest mempool transactions */
+static constexpr std::chrono::seconds STRATUM_JOB_REFRESH_INTERVAL{30};
+
+StratumJob::StratumJob(const CBlock& block_in, int height_in) : height{height_in}, block{block_in}
+{
+    // The extra nonce goes right after the height that BIP34 puts first
+    CMutableTransaction coinbase{*block.vtx[0]};
+    coinbase.vin[0].scriptSig = CScript() << height << std::vector<unsigned char>(STRATUM_EXTRANONCE1_SIZE + STRATUM_EXTRANONCE2_SIZE);
+    assert(coinbase.vin[0].scriptSig.size() <= 100);
+    block.vtx[0] = MakeTransactionRef(coinbase);
+
+    // Miners hash the coinbase to its txid, so it is split without witness.
+    // The extra nonce ends the scriptSig of its only input.
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS);
+    stream << coinbase;
+    const auto serialized{MakeUCharSpan(stream)};
+    const size_t script_size{coinbase.vin[0].scriptSig.size()};
+    const size_t extranonce_end{4 + GetSizeOfCompactSize(1) + 36 + GetSizeOfCompactSize(script_size) + script_size};
+    const size_t extranonce_begin{extranonce_end - STRATUM_EXTRANONCE1_SIZE - STRATUM_EXTRANONCE2_SIZE};
+    coinbase1.assign(serialized.begin(), serialized.begin() + extranonce_begin);
+    coinbase2.assign(serialized.begin() + extranonce_end, serialized.end());
+
+    // Walk the merkle tree up from the coinbase, recording its sibling at
+    // every level. The coinbase's own path is left as a null placeholder.
+    std::vector<uint256> level;
+    level.reserve(block.vtx.size());
+    for (const auto& tx : block.vtx) {
+        level.push_back(tx->GetHash());
+    }
+    while (level.size() > 1) {
+        merkle_branch.push_back(level[1]);
+        if (level.size() & 1) level.push_back(level.back());
+        std::vector<uint256> next{uint256()};
+        for (size_t i = 2; i < level.size(); i += 2) {
+            next.push_back(Hash(level[i], level[i + 1]));
+        }
+        level = std::move(next);
+    }
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+}
+
+UniValue StratumJob::NotifyParams(const std::string& job_id, bool clean) const
+{
+    // The previous block hash goes out as eight 32-bit words, each of them
+    // byte swapped, which is how miners copy it into the header
+    uint256 prev_hash{block.hashPrevBlock};
+    for (unsigned char* word = prev_hash.begin(); word != prev_hash.end(); word += 4) {
+        std::reverse(word, word + 4);
+    }
+    UniValue branch(UniValue::VARR);
+    for (const uint256& hash : merkle_branch) {
+        branch.push_back(HexStr(hash));
+    }
+
+    UniValue params(UniValue::VARR);
+    params.push_back(job_id);
+    params.push_back(HexStr(prev_hash));
+    params.push_back(HexStr(coinbase1));
+    params.push_back(HexStr(coinbase2));
+    params.push_back(branch);
+    params.push_back(strprintf("%08x", (uint32_t)block.nVersion));
+    params.push_back(strprintf("%08x", block.nBits));
+    params.push_back(strprintf("%08x", block.nTime));
+    params.push_back(clean);
+    return params;
+}
+
+CBlock StratumJob::Solve(const std::vector<unsigned char>& extranonce, uint32_t time, uint32_t nonce) const
+{
+    assert(extranonce.size() == STRATUM_EXTRANONCE1_SIZE + STRATUM_EXTRANONCE2_SIZE);
+    CBlock solved{block};
+    CMutableTransaction coinbase{*block.vtx[0]};
+    coinbase.vin[0].scriptSig = CScript() << height << extranonce;
+    solved.vtx[0] = MakeTransactionRef(std::move(coinbase));
+
+    // Only the coinbase changed, so its branch gives the root without
+    // rehashing the other transactions
+    uint256 root{solved.vtx[0]->GetHash()};
+    for (const uint256& hash : merkle_branch) {
+        root = Hash(root, hash);
+    }
+    solved.hashMerkleRoot = root;
+    solved.nTime = time;
+    solved.nNonce = nonce;
+    return solved;
+}
+
+arith_uint256 StratumShareTarget(int64_t difficulty)
+{
+    assert(difficulty > 0);
+    // Difficulty 1 is the target getdifficulty measures against
+    arith_uint256 target;
+    target.SetCompact(0x1d00ffff);
+    target *= (uint32_t)STRATUM_DIFFICULTY_UNIT;
+    target /= arith_uint256((uint64_t)difficulty);
+    return target;
+}
+
+namespace {
+
+class StratumServer;
+
+/** A miner connected to the server */
+struct StratumClient {
+    StratumServer* server;
+    bufferevent* bev;
+    CService addr;
+    std::vector<unsigned char> extranonce1;
+    std::string worker;
+    bool subscribed{false};
+    bool authorized{false};
+};
+
+/** Stratum error as [code, message, traceback] */
+UniValue StratumError(int code, const std::string& message)
+{
+    UniValue error(UniValue::VARR);
+    error.push_back(code);
+    error.push_back(message);
+    error.push_back(NullUniValue);
+    return error;
+}
+
+/** Parse the 8 hex digits miners send 32-bit fields as */
+bool ParseHex32(const UniValue& value, uint32_t& out)
+{
+    if (!value.isStr() || value.get_str().size() != 8 || !IsHex(value.get_str())) return false;
+    out = ReadBE32(ParseHex(value.get_str()).data());
+    return true;
+}
+
+/**
+ * Hands out jobs to the miners connected to it and checks their shares.
+ * Everything but UpdatedBlockTip() runs on the stratum thread.
+ */
+class StratumServer final : public CValidationInterface
+{
+public:
+    StratumServer(event_base* base, node::NodeContext& node, CScript coinbase_script, int64_t difficulty);
+
+    bool Bind(const CService& addr);
+    /** Free the libevent objects, once the event loop has exited */
+    void Close();
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override;
+
+private:
+    event_base* const m_base;
+    node::NodeContext& m_node;
+    const CScript m_coinbase_script;
+    const int64_t m_difficulty;
+    const arith_uint256 m_share_target;
+
+    std::vector<evconnlistener*> m_listeners;
+    //! Clients by their buffer event, map nodes are stable for use as callback context
+    std::map<bufferevent*, StratumClient> m_clients;
+    uint32_t m_next_extranonce1;
+
+    //! Jobs handed out since the tip last changed, by id
+    std::map<uint64_t, std::shared_ptr<const StratumJob>> m_jobs;
+    uint64_t m_next_job_id{1};
+    //! Block hashes of the valid shares submitted for these jobs, with their
+    //! submission order so the oldest can be forgotten
+    std::set<uint256> m_shares;
+    std::deque<uint256> m_share_order;
+    unsigned int m_transactions_updated{0};
+
+    event* m_refresh_event{nullptr};
+    //! Guards m_tip_event against being freed while a new tip is signaled
+    Mutex m_tip_mutex;
+    event* m_tip_event GUARDED_BY(m_tip_mutex){nullptr};
+
+    static void acceptcb(evconnlistener* listener, evutil_socket_t fd, sockaddr* addr, int addr_len, void* ctx);
+    static void readcb(bufferevent* bev, void* ctx);
+    static void eventcb(bufferevent* bev, short what, void* ctx);
+    static void tipcb(evutil_socket_t, short, void* ctx);
+    static void refreshcb(evutil_socket_t, short, void* ctx);
+
+    void Disconnect(StratumClient& client);
+    void Send(StratumClient& client, const UniValue& message);
+    void SendWork(StratumClient& client);
+    /** Handle a line from the client, false if it should be disconnected */
+    bool HandleLine(StratumClient& client, const std::string& line);
+    UniValue Submit(StratumClient& client, const UniValue& params, UniValue& error);
+    /** Build a job from a new block template and send it to the subscribed clients */
+    void NewJob(bool clean);
+};
+
+StratumServer::StratumServer(event_base* base, node::NodeContext& node, CScript coinbase_script, int64_t difficulty)
+    : m_base{base}, m_node{node}, m_coinbase_script{std::move(coinbase_script)}, m_difficulty{difficulty},
+      m_share_target{StratumShareTarget(difficulty)}, m_next_extranonce1{(uint32_t)GetRand(std::numeric_limits<uint32_t>::max())}
+{
+    m_refresh_event = event_new(m_base, -1, EV_PERSIST, refreshcb, this);
+    const struct timeval refresh_interval{count_seconds(STRATUM_JOB_REFRESH_INTERVAL), 0};
+    event_add(m_refresh_event, &refresh_interval);
+    LOCK(m_tip_mutex);
+    m_tip_event = event_new(m_base, -1, 0, tipcb, this);
+}
+
+bool StratumServer::Bind(const CService& addr)
+{
+    struct sockaddr_storage sockaddr;
+    socklen_t len = sizeof(sockaddr);
+    if (!addr.GetSockAddr(reinterpret_cast<struct sockaddr*>(&sockaddr), &len)) {
+        return false;
+    }
+    evconnlistener* listener = evconnlistener_new_bind(m_base, acceptcb, this, LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE, -1,
+                                                       reinterpret_cast<struct sockaddr*>(&sockaddr), len);
+    if (!listener) {
+        return false;
+    }
+    m_listeners.push_back(listener);
+    return true;
+}
+
+void StratumServer::Close()
+{
+    {
+        LOCK(m_tip_mutex);
+        event_free(m_tip_event);
+        m_tip_event = nullptr;
+    }
+    event_free(m_refresh_event);
+    for (auto& [bev, client] : m_clients) {
+        bufferevent_free(bev);
+    }
+    m_clients.clear();
+    for (evconnlistener* listener : m_listeners) {
+        evconnlistener_free(listener);
+    }
+    m_listeners.clear();
+}
+
+void StratumServer::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload)
+{
+    // Hand the new tip over to the stratum thread
+    LOCK(m_tip_mutex);
+    if (m_tip_event) event_active(m_tip_event, EV_TIMEOUT, 0);
+}
+
+void StratumServer::acceptcb(evconnlistener* listener, evutil_socket_t fd, sockaddr* addr, int addr_len, void* ctx)
+{
+    StratumServer* self = static_cast<StratumServer*>(ctx);
+    bufferevent* bev = bufferevent_socket_new(self->m_base, fd, BEV_OPT_CLOSE_ON_FREE);
+    if (!bev) {
+        evutil_closesocket(fd);
+        return;
+    }
+    StratumClient& client = self->m_clients[bev];
+    client.server = self;
+    client.bev = bev;
+    client.addr.SetSockAddr(addr);
+    client.extranonce1.resize(STRATUM_EXTRANONCE1_SIZE);
+    WriteBE32(client.extranonce1.data(), self->m_next_extranonce1++);
+    LogPrint(BCLog::STRATUM, "stratum: Connection from %s\n", client.addr.ToString());
+
+    bufferevent_setcb(bev, readcb, nullptr, eventcb, &client);
+    bufferevent_enable(bev, EV_READ | EV_WRITE);
+}
+
+void StratumServer::readcb(bufferevent* bev, void* ctx)
+{
+    StratumClient& client = *static_cast<StratumClient*>(ctx);
+    evbuffer* input = bufferevent_get_input(bev);
+    size_t n_read_out = 0;
+    char* line;
+    // If there is not a whole line to read, evbuffer_readln returns nullptr
+    while ((line = evbuffer_readln(input, &n_read_out, EVBUFFER_EOL_CRLF)) != nullptr) {
+        std::string s(line, n_read_out);
+        free(line);
+        if (!client.server->HandleLine(client, s)) {
+            client.server->Disconnect(client);
+            return;
+        }
+    }
+    // Everything left is an incomplete line, protect against memory
+    // exhaustion with very long ones
+    if (evbuffer_get_length(input) > MAX_STRATUM_LINE_LENGTH) {
+        LogPrint(BCLog::STRATUM, "stratum: Disconnecting %s because MAX_STRATUM_LINE_LENGTH exceeded\n", client.addr.ToString());
+        client.server->Disconnect(client);
+    }
+}
+
+void StratumServer::eventcb(bufferevent* bev, short what, void* ctx)
+{
+    StratumClient& client = *static_cast<StratumClient*>(ctx);
+    if (what & (BEV_EVENT_EOF | BEV_EVENT_ERROR)) {
+        LogPrint(BCLog::STRATUM, "stratum: %s disconnected\n", client.addr.ToString());
+        client.server->Disconnect(client);
+    }
+}
+
+void StratumServer::tipcb(evutil_socket_t, short, void* ctx)
+{
+    static_cast<StratumServer*>(ctx)->NewJob(/*clean=*/true);
+}
+
+void StratumServer::refreshcb(evutil_socket_t, short, void* ctx)
+{
+    StratumServer* self = static_cast<StratumServer*>(ctx);
+    if (self->m_jobs.empty()) {
+        self->NewJob(/*clean=*/true);
+    } else if (self->m_node.mempool->GetTransactionsUpdated() != self->m_transactions_updated) {
+        self->NewJob(/*clean=*/false);
+    }
+}
+
+void StratumServer::Disconnect(StratumClient& client)
+{
+    bufferevent* bev = client.bev;
+    m_clients.erase(bev);
+    bufferevent_free(bev);
+}
+
+void StratumServer::Send(StratumClient& client, const UniValue& message)
+{
+    const std::string line{message.write() + "\n"};
+    evbuffer_add(bufferevent_get_output(client.bev), line.data(), line.size());
+}
+
+void StratumServer::SendWork(StratumClient& client)
+{
+    UniValue set_difficulty(UniValue::VOBJ);
+    set_difficulty.pushKV("id", NullUniValue);
+    set_difficulty.pushKV("method", "mining.set_difficulty");
+    UniValue params(UniValue::VARR);
+    params.push_back(ValueFromAmount(m_difficulty));
+    set_difficulty.pushKV("params", params);
+    Send(client, set_difficulty);
+
+    if (m_jobs.empty()) {
+        // Sends the job to every subscribed client, this one included
+        NewJob(/*clean=*/true);
+        return;
+    }
+    const auto& [job_id, job] = *m_jobs.rbegin();
+    UniValue notify(UniValue::VOBJ);
+    notify.pushKV("id", NullUniValue);
+    notify.pushKV("method", "mining.notify");
+    notify.pushKV("params", job->NotifyParams(ToString(job_id), /*clean=*/true));
+    Send(client, notify);
+}
+
+bool StratumServer::HandleLine(StratumClient& client, const std::string& line)
+{
+    UniValue request;
+    if (!request.read(line) || !request.isObject()) {
+        LogPrint(BCLog::STRATUM, "stratum: Disconnecting %s for sending invalid JSON\n", client.addr.ToString());
+        return false;
+    }
+    const UniValue& method = find_value(request, "method");
+    const UniValue& params = find_value(request, "params");
+
+    UniValue result;
+    UniValue error;
+    bool send_work{false};
+    if (!method.isStr() || !params.isArray()) {
+        error = StratumError(20, "Invalid request");
+    } else if (method.get_str() == "mining.subscribe") {
+        UniValue subscription(UniValue::VARR);
+        for (const std::string name : {"mining.set_difficulty", "mining.notify"}) {
+            UniValue pair(UniValue::VARR);
+            pair.push_back(name);
+            pair.push_back(HexStr(client.extranonce1));
+            subscription.push_back(pair);
+        }
+        result.setArray();
+        result.push_back(subscription);
+        result.push_back(HexStr(client.extranonce1));
+        result.push_back((uint64_t)STRATUM_EXTRANONCE2_SIZE);
+        client.subscribed = true;
+        send_work = true;
+    } else if (method.get_str() == "mining.authorize") {
+        // Anyone who can reach the server may mine, the payout goes to -stratumaddress
+        client.worker = params.size() > 0 && params[0].isStr() ? params[0].get_str() : "";
+        client.authorized = true;
+        result.setBool(true);
+        LogPrint(BCLog::STRATUM, "stratum: %s authorized as %s\n", client.addr.ToString(), SanitizeString(client.worker));
+    } else if (method.get_str() == "mining.submit") {
+        result = Submit(client, params, error);
+    } else {
+        error = StratumError(20, "Method not found");
+    }
+
+    UniValue reply(UniValue::VOBJ);
+    reply.pushKV("id", find_value(request, "id"));
+    reply.pushKV("result", result);
+    reply.pushKV("error", error);
+    Send(client, reply);
+    if (send_work) SendWork(client);
+    return true;
+}
+
+UniValue StratumServer::Submit(StratumClient& client, const UniValue& params, UniValue& error)
+{
+    if (!client.authorized) {
+        error = StratumError(24, "Unauthorized worker");
+        return NullUniValue;
+    }
+    // [worker, job id, extranonce2, time, nonce]
+    uint64_t job_id;
+    uint32_t time, nonce;
+    if (params.size() < 5 || !params[1].isStr() || !params[2].isStr() ||
+        !ParseHex32(params[3], time) || !ParseHex32(params[4], nonce) ||
+        params[2].get_str().size() != 2 * STRATUM_EXTRANONCE2_SIZE || !IsHex(params[2].get_str())) {
+        error = StratumError(20, "Invalid parameters");
+        return NullUniValue;
+    }
+    const auto job_it{ParseUInt64(params[1].get_str(), &job_id) ? m_jobs.find(job_id) : m_jobs.end()};
+    if (job_it == m_jobs.end()) {
+        error = StratumError(21, "Job not found");
+        return NullUniValue;
+    }
+    const StratumJob& job = *job_it->second;
+    // Same bounds as the block's time is checked against
+    if (time < job.block.nTime || time > job.block.nTime + MAX_FUTURE_BLOCK_TIME) {
+        error = StratumError(20, "Time out of range");
+        return NullUniValue;
+    }
+
+    std::vector<unsigned char> extranonce{client.extranonce1};
+    const std::vector<unsigned char> extranonce2{ParseHex(params[2].get_str())};
+    extranonce.insert(extranonce.end(), extranonce2.begin(), extranonce2.end());
+    CBlock block{job.Solve(extranonce, time, nonce)};
+
+    PrecomputedPoWHash pow_hash;
+    pow_hash.height = job.height;
+    pow_hash.hash = block.GetPoWHash(job.height);
+    const bool solves_block{CheckBlockProofOfWork(block, job.height, Params().GetConsensus(), &pow_hash.hash)};
+    // Only shares that cost their work are remembered, so junk submits
+    // cannot grow the duplicate set
+    if (!solves_block && UintToArith256(pow_hash.hash) > m_share_target) {
+        error = StratumError(23, "Low difficulty share");
+        return NullUniValue;
+    }
+    const uint256 block_hash{block.GetHash()};
+    if (!m_shares.insert(block_hash).second) {
+        error = StratumError(22, "Duplicate share");
+        return NullUniValue;
+    }
+    m_share_order.push_back(block_hash);
+    if (m_share_order.size() > MAX_STRATUM_SHARES) {
+        m_shares.erase(m_share_order.front());
+        m_share_order.pop_front();
+    }
+
+    if (solves_block) {
+        const auto block_ptr{std::make_shared<const CBlock>(std::move(block))};
+        bool new_block;
+        const bool accepted{m_node.chainman->ProcessNewBlock(Params(), block_ptr, /*force_processing=*/true, &new_block, &pow_hash)};
+        LogPrintf("stratum: Block %s at height %d from %s (job %d) %s\n", block_hash.ToString(), job.height,
+                  SanitizeString(client.worker), job_id, accepted ? "accepted" : "rejected");
+        if (!accepted) {
+            error = StratumError(20, "Block rejected");
+            return NullUniValue;
+        }
+    }
+    return true;
+}
+
+void StratumServer::NewJob(bool clean)
+{
+    ChainstateManager& chainman = *m_node.chainman;
+    if (clean) {
+        m_jobs.clear();
+        m_shares.clear();
+        m_share_order.clear();
+    }
+    // Only miners that are subscribed need work, the refresh timer and the
+    // next subscribe build it otherwise
+    if (std::none_of(m_clients.begin(), m_clients.end(), [](const auto& entry) { return entry.second.subscribed; })) return;
+    if (!Params().IsTestChain() && chainman.ActiveChainstate().IsInitialBlockDownload()) return;
+
+    std::unique_ptr<CBlockTemplate> block_template;
+    const unsigned int transactions_updated{m_node.mempool->GetTransactionsUpdated()};
+    try {
+        block_template = m_node.block_template_cache->GetTemplate(m_coinbase_script);
+    } catch (const std::exception& e) {
+        LogPrintf("stratum: Failed to create block template: %s\n", e.what());
+        return;
+    }
+    int height;
+    {
+        LOCK(cs_main);
+        const CBlockIndex* prev = chainman.m_blockman.LookupBlockIndex(block_template->block.hashPrevBlock);
+        if (!prev) return;
+        height = prev->nHeight + 1;
+    }
+    m_transactions_updated = transactions_updated;
+
+    const uint64_t job_id{m_next_job_id++};
+    const auto job{std::make_shared<const StratumJob>(block_template->block, height)};
+    m_jobs.emplace(job_id, job);
+    while (m_jobs.size() > MAX_STRATUM_JOBS) {
+        m_jobs.erase(m_jobs.begin());
+    }
+    LogPrint(BCLog::STRATUM, "stratum: New job %d at height %d with %u transactions\n", job_id, height, job->block.vtx.size());
+
+    UniValue notify(UniValue::VOBJ);
+    notify.pushKV("id", NullUniValue);
+    notify.pushKV("method", "mining.notify");
+    notify.pushKV("params", job->NotifyParams(ToString(job_id), clean));
+    for (auto& [bev, client] : m_clients) {
+        if (client.subscribed) Send(client, notify);
+    }
+}
+
+} // namespace
+
+/****** Thread ********/
+static struct event_base* g_stratum_base;
+static std::thread g_stratum_thread;
+static std::shared_ptr<StratumServer> g_stratum;
+
+bool StartStratum(node::NodeContext& node)
+{
+    assert(!g_stratum_base);
+    const ArgsManager& args = *node.args;
+    // Checked by AppInitParameterInteraction()
+    const CScript coinbase_script{GetScriptForDestination(DecodeDestination(args.GetArg("-stratumaddress", "")))};
+    int64_t difficulty;
+    if (!ParseFixedPoint(args.GetArg("-stratumdifficulty", DEFAULT_STRATUM_DIFFICULTY), 8, &difficulty) || difficulty <= 0) {
+        return false;
+    }
+
+#ifdef WIN32
+    evthread_use_windows_threads();
+#else
+    evthread_use_pthreads();
+#endif
+    g_stratum_base = event_base_new();
+    if (!g_stratum_base) {
+        LogPrintf("stratum: Unable to create event_base\n");
+        return false;
+    }
+    g_stratum = std::make_shared<StratumServer>(g_stratum_base, node, coinbase_script, difficulty);
+
+    const uint16_t port{static_cast<uint16_t>(args.GetIntArg("-stratumport", DEFAULT_STRATUM_PORT))};
+    std::vector<std::string> binds{args.GetArgs("-stratumbind")};
+    if (binds.empty()) binds.push_back(DEFAULT_STRATUM_BIND);
+    for (const std::string& bind : binds) {
+        CService addr;
+        if (!Lookup(bind, addr, port, false) || !g_stratum->Bind(addr)) {
+            LogPrintf("stratum: Unable to bind to %s\n", bind);
+            g_stratum->Close();
+            g_stratum.reset();
+            event_base_free(g_stratum_base);
+            g_stratum_base = nullptr;
+            return false;
+        }
+        LogPrintf("stratum: Listening on %s\n", addr.ToString());
+    }
+    RegisterSharedValidationInterface(g_stratum);
+
+    g_stratum_thread = std::thread(&util::TraceThread, "stratum", [] {
+        SetSyscallSandboxPolicy(SyscallSandboxPolicy::STRATUM);
+        event_base_dispatch(g_stratum_base);
+    });
+    return true;
+}
+
+void InterruptStratum()
+{
+    if (g_stratum_base) {
+        LogPrintf("stratum: Thread interrupt\n");
+        event_base_once(g_stratum_base, -1, EV_TIMEOUT, [](evutil_socket_t, short, void*) {
+            event_base_loopbreak(g_stratum_base);
+        }, nullptr, nullptr);
+    }
+}
+
+void StopStratum()
+{
+    if (g_stratum_base) {
+        UnregisterSharedValidationInterface(g_stratum);
+        g_stratum_thread.join();
+        g_stratum->Close();
+        g_stratum.reset();
+        event_base_free(g_stratum_base);
+        g_stratum_base = nullptr;
+    }
+}
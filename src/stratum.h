@@ -0,0 +1,64 @@
+// Copyright (c) 2021 The Vertcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+/**
+ * Stratum v1 server handing out work built from the node's own block
+ * templates, for pools and miners running next to the node.
+ */
+#ifndef BITCOIN_STRATUM_H
+#define BITCOIN_STRATUM_H
+
+#include <arith_uint256.h>
+#include <primitives/block.h>
+#include <uint256.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class UniValue;
+
+namespace node {
+struct NodeContext;
+} // namespace node
+
+static const bool DEFAULT_STRATUM = false;
+static const std::string DEFAULT_STRATUM_BIND{"127.0.0.1"};
+static const uint16_t DEFAULT_STRATUM_PORT = 5890;
+/** Share difficulty, on the same scale as getdifficulty */
+static const std::string DEFAULT_STRATUM_DIFFICULTY{"1"};
+/** Difficulties are handled in units of 1e-8, like amounts in satoshis */
+static const int64_t STRATUM_DIFFICULTY_UNIT = 100000000;
+/** Bytes of extra nonce chosen by the server (per connection) and by the miner */
+static const size_t STRATUM_EXTRANONCE1_SIZE = 4;
+static const size_t STRATUM_EXTRANONCE2_SIZE = 4;
+
+/** Block template cut up the way mining.notify sends it */
+struct StratumJob {
+    int height;
+    //! The template, its coinbase carrying a zeroed extra nonce
+    CBlock block;
+    //! Coinbase serialized without witness, before and after the extra nonce
+    std::vector<unsigned char> coinbase1;
+    std::vector<unsigned char> coinbase2;
+    //! Hashes combined with the coinbase txid, from the leaves up, to get the merkle root
+    std::vector<uint256> merkle_branch;
+
+    StratumJob(const CBlock& block, int height);
+
+    /** Parameters of mining.notify for this job */
+    UniValue NotifyParams(const std::string& job_id, bool clean) const;
+
+    /** The template with the miner's extra nonce (extranonce1 || extranonce2), time and nonce filled in */
+    CBlock Solve(const std::vector<unsigned char>& extranonce, uint32_t time, uint32_t nonce) const;
+};
+
+/** Target a share must meet at the given difficulty, in units of STRATUM_DIFFICULTY_UNIT */
+arith_uint256 StratumShareTarget(int64_t difficulty);
+
+bool StartStratum(node::NodeContext& node);
+void InterruptStratum();
+void StopStratum();
+
+#endif // BITCOIN_STRATUM_H
@@ -0,0 +1,123 @@
+// Copyright (c) 2021 The Vertcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <node/blockstorage.h>
+#include <pow.h>
+#include <test/util/logging.h>
+#include <test/util/setup_common.h>
+#include <validation.h>
+#include <versionbits.h>
+
+#include <boost/test/unit_test.hpp>
+
+using node::ReadBlockFromDisk;
+
+namespace {
+/** Regtest hashing with scrypt, so that headers need no Verthash datafile */
+struct BlockIndexPoWTestingSetup : public TestingSetup {
+    BlockIndexPoWTestingSetup() : TestingSetup{CBaseChainParams::REGTEST, {"-testpowalgorithm=scrypt@0"}} {}
+
+    /** A header at height with valid proof of work, or with bad if bad is set */
+    CBlockHeader MakeHeader(int height, bool bad = false)
+    {
+        CBlockHeader header{Params().GenesisBlock().GetBlockHeader()};
+        header.nVersion = VERSIONBITS_TOP_BITS;
+        header.hashMerkleRoot = InsecureRand256();
+        header.nNonce = 0;
+        while (CheckProofOfWork(header.GetPoWHash(height), header.nBits, Params().GetConsensus()) == bad) {
+            ++header.nNonce;
+        }
+        return header;
+    }
+};
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(blockindex_pow_tests, BlockIndexPoWTestingSetup)
+
+BOOST_AUTO_TEST_CASE(full_startup_verify)
+{
+    node::BlockManager& blockman{m_node.chainman->m_blockman};
+    const auto add_entry = [&](int height, bool bad) EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
+        const CBlockHeader header{MakeHeader(height, bad)};
+        CBlockIndex* pindex{blockman.InsertBlockIndex(header.GetHash())};
+        pindex->nVersion = header.nVersion;
+        pindex->hashMerkleRoot = header.hashMerkleRoot;
+        pindex->nTime = header.nTime;
+        pindex->nBits = header.nBits;
+        pindex->nNonce = header.nNonce;
+        pindex->nHeight = height;
+        return pindex;
+    };
+
+    // Unrelated entries spanning several chunks of the verification
+    {
+        LOCK(cs_main);
+        for (int height = 1; height <= 3000; ++height) {
+            add_entry(height, /*bad=*/false);
+        }
+    }
+    BOOST_CHECK(blockman.CheckBlockIndexPoW(Params().GetConsensus()));
+
+    // Bad entries in different chunks: the lowest one is reported, whichever
+    // worker finds which
+    const CBlockIndex* first_bad{WITH_LOCK(cs_main, return add_entry(1500, /*bad=*/true))};
+    WITH_LOCK(cs_main, add_entry(2900, /*bad=*/true));
+    {
+        ASSERT_DEBUG_LOG("hashBlock=" + first_bad->GetBlockHash().ToString());
+        BOOST_CHECK(!blockman.CheckBlockIndexPoW(Params().GetConsensus()));
+    }
+
+    // Headers pending a checkpoint are left to it
+    {
+        LOCK(cs_main);
+        for (auto& [hash, pindex] : blockman.m_block_index) {
+            if (pindex->nHeight == 1500 || pindex->nHeight == 2900) pindex->nStatus |= BLOCK_POW_PENDING;
+        }
+    }
+    BOOST_CHECK(blockman.CheckBlockIndexPoW(Params().GetConsensus()));
+}
+
+BOOST_AUTO_TEST_CASE(read_block_trusts_index)
+{
+    const PoWCacheStats stats_before{GetPoWCacheStats()};
+    BOOST_REQUIRE(stats_before.max_elements > 0);
+    const auto pow_lookups = [] { const PoWCacheStats stats{GetPoWCacheStats()}; return stats.hits + stats.misses; };
+
+    CBlock block{Params().GenesisBlock()};
+    static_cast<CBlockHeader&>(block) = MakeHeader(1);
+    CBlock bad_block{Params().GenesisBlock()};
+    static_cast<CBlockHeader&>(bad_block) = MakeHeader(1, /*bad=*/true);
+    const FlatFilePos pos{m_node.chainman->m_blockman.SaveBlockToDisk(block, 1, m_node.chainman->ActiveChain(), Params(), nullptr)};
+    const FlatFilePos bad_pos{m_node.chainman->m_blockman.SaveBlockToDisk(bad_block, 1, m_node.chainman->ActiveChain(), Params(), nullptr)};
+    BOOST_REQUIRE(!pos.IsNull() && !bad_pos.IsNull());
+
+    const uint256 hash{block.GetHash()};
+    CBlockIndex index{block};
+    index.phashBlock = &hash;
+    index.nHeight = 1;
+    index.nFile = pos.nFile;
+    index.nDataPos = pos.nPos;
+    index.nStatus = BLOCK_VALID_TREE | BLOCK_HAVE_DATA;
+
+    // An entry whose header was validated is read without its PoW hash
+    const uint64_t lookups{pow_lookups()};
+    CBlock read;
+    BOOST_CHECK(ReadBlockFromDisk(read, &index, Params().GetConsensus()));
+    BOOST_CHECK_EQUAL(read.GetHash(), hash);
+    BOOST_CHECK_EQUAL(pow_lookups(), lookups);
+
+    // Any other entry has its header checked
+    index.nStatus = BLOCK_HAVE_DATA;
+    BOOST_CHECK(ReadBlockFromDisk(read, &index, Params().GetConsensus()));
+    BOOST_CHECK_EQUAL(pow_lookups(), lookups + 1);
+
+    // Reads by position always check the header
+    BOOST_CHECK(ReadBlockFromDisk(read, pos, 1, Params().GetConsensus()));
+    BOOST_CHECK(!ReadBlockFromDisk(read, bad_pos, 1, Params().GetConsensus()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
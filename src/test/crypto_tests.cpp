@@ -10,6 +10,7 @@
 #include <crypto/hmac_sha512.h>
 #include <crypto/poly1305.h>
 #include <crypto/ripemd160.h>
+#include <crypto/scrypt.h>
 #include <crypto/sha1.h>
 #include <crypto/sha256.h>
 #include <crypto/sha3.h>
@@ -947,4 +948,27 @@ BOOST_AUTO_TEST_CASE(muhash_tests)
     BOOST_CHECK_EQUAL(HexStr(out4), "3a31e6903aff0de9f62f9a9f7f8b861de76ce2cda09822b90014319ae5dc2271");
 }
 
+BOOST_AUTO_TEST_CASE(scrypt_batch)
+{
+    std::vector<std::vector<unsigned char>> headers;
+    for (int i = 0; i < 10; i++) headers.push_back(g_insecure_rand_ctx.randbytes(80));
+
+    // Single hashes, partial and full groups of eight lanes, and a leftover header
+    for (size_t count : {0, 1, 2, 5, 8, 9, 10}) {
+        std::vector<const char*> inputs;
+        std::vector<uint256> hashes(count);
+        std::vector<char*> outputs;
+        for (size_t i = 0; i < count; i++) {
+            inputs.push_back((const char*)headers[i].data());
+            outputs.push_back((char*)hashes[i].begin());
+        }
+        scrypt_N_1_1_256_batch(inputs.data(), outputs.data(), count, 10);
+        for (size_t i = 0; i < count; i++) {
+            uint256 expected;
+            scrypt_N_1_1_256((const char*)headers[i].data(), (char*)expected.begin(), 10);
+            BOOST_CHECK_EQUAL(hashes[i], expected);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -135,6 +135,7 @@ const std::vector<std::string> RPC_COMMANDS_SAFE_FOR_FUZZING{
     "getnetworkinfo",
     "getnodeaddresses",
     "getpeerinfo",
+    "getpowcacheinfo",
     "getrawmempool",
     "getrawtransaction",
     "getrpcinfo",
@@ -0,0 +1,242 @@
+// Copyright (c) 2021 The Vertcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <pow.h>
+#include <primitives/block.h>
+#include <test/util/setup_common.h>
+#include <validation.h>
+#include <versionbits.h>
+
+#include <set>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+/** Regtest hashing with scrypt, so that headers need no Verthash datafile */
+struct HeadersTestingSetup : public TestingSetup {
+    HeadersTestingSetup() : TestingSetup{CBaseChainParams::REGTEST, {"-testpowalgorithm=scrypt@0"}} {}
+
+    /** Build count headers on top of the genesis block's header, each with
+     *  valid proof of work unless its index is in bad */
+    std::vector<CBlockHeader> BuildHeaders(size_t count, const std::set<size_t>& bad = {}, const std::vector<CBlockHeader>& base = {})
+    {
+        const Consensus::Params& consensus{Params().GetConsensus()};
+        CBlockHeader prev{base.empty() ? Params().GenesisBlock().GetBlockHeader() : base.back()};
+        int height{static_cast<int>(base.size())};
+        std::vector<CBlockHeader> headers;
+        for (size_t i = 0; i < count; ++i) {
+            CBlockHeader header;
+            header.nVersion = VERSIONBITS_TOP_BITS;
+            header.hashPrevBlock = prev.GetHash();
+            header.hashMerkleRoot = InsecureRand256();
+            header.nTime = prev.nTime + 1;
+            header.nBits = prev.nBits;
+            ++height;
+            while (CheckProofOfWork(header.GetPoWHash(height), header.nBits, consensus) == (bad.count(i) > 0)) {
+                ++header.nNonce;
+            }
+            headers.push_back(header);
+            prev = header;
+        }
+        return headers;
+    }
+
+    bool Known(const CBlockHeader& header)
+    {
+        return WITH_LOCK(::cs_main, return m_node.chainman->m_blockman.LookupBlockIndex(header.GetHash()) != nullptr);
+    }
+
+    bool PoWPending(const CBlockHeader& header)
+    {
+        LOCK(::cs_main);
+        const CBlockIndex* pindex{m_node.chainman->m_blockman.LookupBlockIndex(header.GetHash())};
+        BOOST_REQUIRE(pindex);
+        return pindex->nStatus & BLOCK_POW_PENDING;
+    }
+
+    uint256 BestHeader()
+    {
+        return WITH_LOCK(::cs_main, return pindexBestHeader->GetBlockHash());
+    }
+};
+
+/** Chain params with checkpoints of the test's choosing */
+class CheckpointParams : public CChainParams
+{
+public:
+    explicit CheckpointParams(const CChainParams& params) : CChainParams{params} {}
+    void AddCheckpoint(int height, const uint256& hash) { checkpointData.mapCheckpoints[height] = hash; }
+};
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(headers_tests, HeadersTestingSetup)
+
+BOOST_AUTO_TEST_CASE(checkpoint_skips_pow)
+{
+    // Headers 4 and 13 (heights 5 and 14) have bad proof of work, height 10 is checkpointed
+    const std::vector<CBlockHeader> headers{BuildHeaders(15, {4, 13})};
+    CheckpointParams params{Params()};
+    params.AddCheckpoint(10, headers[9].GetHash());
+
+    // Without the checkpoint the batch fails at the first bad header
+    {
+        BlockValidationState state;
+        BOOST_CHECK(!m_node.chainman->ProcessNewBlockHeaders(headers, state, Params()));
+        BOOST_CHECK_EQUAL(state.GetRejectReason(), "high-hash");
+        BOOST_CHECK(Known(headers[3]));
+        BOOST_CHECK(!Known(headers[4]));
+    }
+
+    // The checkpoint commits to the headers leading to it, but not to the ones after it
+    {
+        BlockValidationState state;
+        BOOST_CHECK(!m_node.chainman->ProcessNewBlockHeaders(headers, state, params));
+        BOOST_CHECK_EQUAL(state.GetRejectReason(), "high-hash");
+        BOOST_CHECK(Known(headers[12]));
+        BOOST_CHECK(!Known(headers[13]));
+        BOOST_CHECK(!PoWPending(headers[4]));
+        BOOST_CHECK_EQUAL(BestHeader(), headers[12].GetHash());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(checkpoint_across_batches)
+{
+    // Header 2 has bad proof of work, and the checkpoint it leads to arrives
+    // in a later batch
+    const std::vector<CBlockHeader> headers{BuildHeaders(10, {2})};
+    CheckpointParams params{Params()};
+    params.AddCheckpoint(10, headers[9].GetHash());
+    const std::vector<CBlockHeader> first{headers.begin(), headers.begin() + 5};
+    const std::vector<CBlockHeader> second{headers.begin() + 5, headers.end()};
+
+    // The first batch is neither hashed nor checked, and its work does not count yet
+    for (const PrecomputedPoWHash& hash : PrecomputeHeaderPoWHashes(m_node.chainman->m_blockman, first, &params.Checkpoints())) {
+        BOOST_CHECK_EQUAL(hash.height, -1);
+    }
+    BlockValidationState state;
+    BOOST_CHECK(m_node.chainman->ProcessNewBlockHeaders(first, state, params));
+    BOOST_CHECK(PoWPending(headers[0]));
+    BOOST_CHECK(PoWPending(headers[4]));
+    BOOST_CHECK_EQUAL(WITH_LOCK(::cs_main, return m_node.chainman->m_blockman.m_pow_pending_headers), 5U);
+    BOOST_CHECK_EQUAL(BestHeader(), Params().GenesisBlock().GetHash());
+
+    // The checkpoint closes the chain leading to it
+    BOOST_CHECK(m_node.chainman->ProcessNewBlockHeaders(second, state, params));
+    for (const CBlockHeader& header : headers) {
+        BOOST_CHECK(!PoWPending(header));
+    }
+    BOOST_CHECK_EQUAL(WITH_LOCK(::cs_main, return m_node.chainman->m_blockman.m_pow_pending_headers), 0U);
+    BOOST_CHECK_EQUAL(BestHeader(), headers[9].GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(unproven_fork_stays_pending)
+{
+    const std::vector<CBlockHeader> headers{BuildHeaders(10)};
+    CheckpointParams params{Params()};
+    params.AddCheckpoint(10, headers[9].GetHash());
+
+    // Without checkpoints to leave it to, the proof of work is checked
+    const std::vector<CBlockHeader> checked{BuildHeaders(5, {2})};
+    BlockValidationState state;
+    BOOST_CHECK(!m_node.chainman->ProcessNewBlockHeaders(checked, state, Params()));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "high-hash");
+    BOOST_CHECK(!Known(checked[2]));
+
+    // A fork below the checkpoint is accepted, but its work counts toward nothing
+    const std::vector<CBlockHeader> fork{BuildHeaders(5, {2})};
+    const uint256 best_header{BestHeader()};
+    state = BlockValidationState{};
+    BOOST_CHECK(m_node.chainman->ProcessNewBlockHeaders(fork, state, params));
+    BOOST_CHECK(PoWPending(fork[4]));
+    BOOST_CHECK_EQUAL(BestHeader(), best_header);
+
+    // Once the checkpoint is in, the fork stays pending and cannot grow
+    BOOST_CHECK(m_node.chainman->ProcessNewBlockHeaders(headers, state, params));
+    BOOST_CHECK_EQUAL(BestHeader(), headers[9].GetHash());
+    BOOST_CHECK(PoWPending(fork[4]));
+    BOOST_CHECK(!m_node.chainman->ProcessNewBlockHeaders(BuildHeaders(1, {}, fork), state, params));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-fork-prior-to-checkpoint");
+}
+
+BOOST_AUTO_TEST_CASE(checkpoint_lock_in)
+{
+    const std::vector<CBlockHeader> headers{BuildHeaders(10)};
+    CheckpointParams params{Params()};
+    params.AddCheckpoint(10, headers[9].GetHash());
+
+    // Only the checkpointed header is accepted at the checkpoint's height
+    const std::vector<CBlockHeader> base{headers.begin(), headers.begin() + 9};
+    const std::vector<CBlockHeader> other{BuildHeaders(1, {}, base)};
+    BlockValidationState state;
+    BOOST_CHECK(m_node.chainman->ProcessNewBlockHeaders(base, state, params));
+    BOOST_CHECK(!m_node.chainman->ProcessNewBlockHeaders(other, state, params));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "checkpoint-mismatch");
+    BOOST_CHECK(!Known(other[0]));
+
+    state = BlockValidationState{};
+    BOOST_CHECK(m_node.chainman->ProcessNewBlockHeaders({headers[9]}, state, params));
+    BOOST_CHECK(Known(headers[9]));
+}
+
+BOOST_AUTO_TEST_CASE(full_checkpoint_pow)
+{
+    const std::vector<CBlockHeader> headers{BuildHeaders(10, {4})};
+    CheckpointParams params{Params()};
+    params.AddCheckpoint(10, headers[9].GetHash());
+
+    fFullCheckpointPoW = true;
+    BlockValidationState state;
+    BOOST_CHECK(!m_node.chainman->ProcessNewBlockHeaders(headers, state, params));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "high-hash");
+    BOOST_CHECK(!Known(headers[4]));
+    fFullCheckpointPoW = DEFAULT_FULL_CHECKPOINT_POW;
+
+    state = BlockValidationState{};
+    BOOST_CHECK(m_node.chainman->ProcessNewBlockHeaders(headers, state, params));
+    BOOST_CHECK(Known(headers[9]));
+}
+
+BOOST_AUTO_TEST_CASE(precomputed_hashes)
+{
+    // A bad header in the middle of a batch: everything up to it is hashed
+    // like GetPoWHash() does, and acceptance stops at it
+    const std::vector<CBlockHeader> headers{BuildHeaders(60, {30})};
+    const std::vector<PrecomputedPoWHash> hashes{PrecomputeHeaderPoWHashes(m_node.chainman->m_blockman, headers)};
+    BOOST_REQUIRE_EQUAL(hashes.size(), headers.size());
+    for (size_t i = 0; i < headers.size(); ++i) {
+        if (i <= 30) BOOST_CHECK_EQUAL(hashes[i].height, static_cast<int>(i) + 1);
+        if (hashes[i].height >= 0) BOOST_CHECK_EQUAL(hashes[i].hash, headers[i].GetPoWHash(hashes[i].height));
+    }
+
+    BlockValidationState state;
+    BOOST_CHECK(!m_node.chainman->ProcessNewBlockHeaders(headers, state, Params()));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "high-hash");
+    BOOST_CHECK(Known(headers[29]));
+    BOOST_CHECK(!Known(headers[30]));
+
+    // Known headers are not hashed again
+    for (const PrecomputedPoWHash& hash : PrecomputeHeaderPoWHashes(m_node.chainman->m_blockman, {headers.begin(), headers.begin() + 30})) {
+        BOOST_CHECK_EQUAL(hash.height, -1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(precompute_stops_early)
+{
+    // A bad header among the first few stops hashing before the workers start
+    const std::vector<CBlockHeader> headers{BuildHeaders(100, {2})};
+    const std::vector<PrecomputedPoWHash> hashes{PrecomputeHeaderPoWHashes(m_node.chainman->m_blockman, headers)};
+    for (size_t i = 0; i < headers.size(); ++i) {
+        BOOST_CHECK_EQUAL(hashes[i].height, i <= 2 ? static_cast<int>(i) + 1 : -1);
+    }
+
+    BlockValidationState state;
+    BOOST_CHECK(!m_node.chainman->ProcessNewBlockHeaders(headers, state, Params()));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "high-hash");
+    BOOST_CHECK(Known(headers[1]));
+    BOOST_CHECK(!Known(headers[2]));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
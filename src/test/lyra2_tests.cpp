@@ -0,0 +1,162 @@
+// Copyright (c) 2021 The Vertcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crypto/Lyra2RE/Lyra2.h>
+#include <crypto/Lyra2RE/Lyra2RE.h>
+#include <crypto/Lyra2RE/Sponge.h>
+#include <crypto/Lyra2RE/cubehash32.h>
+#include <random.h>
+#include <test/util/setup_common.h>
+#include <uint256.h>
+#include <util/strencodings.h>
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(lyra2_tests, BasicTestingSetup)
+
+static std::string HashHex(void (*hash)(const char*, char*), int k)
+{
+    unsigned char input[80];
+    unsigned char output[32];
+    for (int i = 0; i < 80; i++) input[i] = i * 7 + k * 13 + 1;
+    hash((const char*)input, (char*)output);
+    return HexStr(output);
+}
+
+static void CheckVectors()
+{
+    // Produced by the implementation from before the matrices moved to the stack
+    BOOST_CHECK_EQUAL(HashHex(lyra2re_hash, 0), "423f4f4f3d0ec6cae3f2db73bcd70395864b5843ec8bebfc6f0b0888cd8b7031");
+    BOOST_CHECK_EQUAL(HashHex(lyra2re_hash, 1), "9a2619b626c161ef8097001920dca6c9d779c2005d613f1d4a5b879328aae05a");
+    BOOST_CHECK_EQUAL(HashHex(lyra2re_hash, 2), "d30c1137f70a520adbc112fff3fb66da922eb202eb37d375f6ca61d26a592034");
+    BOOST_CHECK_EQUAL(HashHex(lyra2re2_hash, 0), "35f98d993225d75b417ed7cc3d8c582bd7119a3303a27d7badfc644a59ea94c0");
+    BOOST_CHECK_EQUAL(HashHex(lyra2re2_hash, 1), "fe224d1f0206bd7e2333e1751e022417f52a4c10e3e71913c69a80fe9fd3bd38");
+    BOOST_CHECK_EQUAL(HashHex(lyra2re2_hash, 2), "5309c8594dde9c5fe188c1533fc3cded69c385b373cd9f2523db19bd8698b04c");
+    BOOST_CHECK_EQUAL(HashHex(lyra2re3_hash, 0), "131b8427ae55e2fc9c9f0c76e26d0a50a29d51a0fc10e7c3298feec2561a09d2");
+    BOOST_CHECK_EQUAL(HashHex(lyra2re3_hash, 1), "0967062efeed9df6ba5647672a657a75cd93f7b6cea7d6632eb27320bd177e24");
+    BOOST_CHECK_EQUAL(HashHex(lyra2re3_hash, 2), "c278ea99aa4937e2dc10560ec9deec8105506b7a7add55d88dc8117dd171561a");
+}
+
+BOOST_AUTO_TEST_CASE(lyra2re_vectors)
+{
+    // The fixture selected the fastest sponge; check the generic one too
+    CheckVectors();
+    reducedDuplexRow1 = reducedDuplexRow1_generic;
+    reducedDuplexRowSetup = reducedDuplexRowSetup_generic;
+    reducedDuplexRow = reducedDuplexRow_generic;
+    cubehash256_32 = cubehash256_32_generic;
+    cubehash256_32_x4 = cubehash256_32_x4_generic;
+    CheckVectors();
+    Lyra2AutoDetect();
+}
+
+static void CheckBatch(void (*hash)(const char*, char*), void (*batch)(const char* const*, char* const*, size_t))
+{
+    std::vector<std::vector<unsigned char>> headers;
+    for (int i = 0; i < 10; i++) headers.push_back(g_insecure_rand_ctx.randbytes(80));
+
+    // Every count from none to more than two full groups of lanes
+    for (size_t count = 0; count <= headers.size(); count++) {
+        std::vector<const char*> inputs;
+        std::vector<uint256> hashes(count);
+        std::vector<char*> outputs;
+        for (size_t i = 0; i < count; i++) {
+            inputs.push_back((const char*)headers[i].data());
+            outputs.push_back((char*)hashes[i].begin());
+        }
+        batch(inputs.data(), outputs.data(), count);
+        for (size_t i = 0; i < count; i++) {
+            uint256 expected;
+            hash((const char*)headers[i].data(), (char*)expected.begin());
+            BOOST_CHECK_EQUAL(hashes[i], expected);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(lyra2re_batch)
+{
+    CheckBatch(lyra2re2_hash, lyra2re2_hash_batch);
+    CheckBatch(lyra2re3_hash, lyra2re3_hash_batch);
+}
+
+BOOST_AUTO_TEST_CASE(cubehash_implementations_agree)
+{
+    const std::string algo = Lyra2AutoDetect();
+    if (algo == "standard") return; // nothing to compare against
+
+    for (int iter = 0; iter < 16; iter++) {
+        uint256 in[4], expected[4], out[4];
+        for (uint256& message : in) message = InsecureRand256();
+        for (int i = 0; i < 4; i++) cubehash256_32_generic(in[i].begin(), expected[i].begin());
+
+        const void* const ins[4] = {in[0].begin(), in[1].begin(), in[2].begin(), in[3].begin()};
+        void* const outs[4] = {out[0].begin(), out[1].begin(), out[2].begin(), out[3].begin()};
+        cubehash256_32_x4(ins, outs);
+        for (int i = 0; i < 4; i++) BOOST_CHECK_EQUAL(out[i], expected[i]);
+
+        cubehash256_32(in[iter % 4].begin(), out[0].begin());
+        BOOST_CHECK_EQUAL(out[0], expected[iter % 4]);
+    }
+}
+
+/** A matrix of nRows rows of nCols columns plus a sponge state, filled with random words */
+struct SpongeTestState {
+    static constexpr uint64_t nRows = 4;
+    static constexpr uint64_t nCols = 4;
+    std::vector<uint64_t> matrix;
+    uint64_t state[16];
+
+    SpongeTestState()
+    {
+        matrix.resize(nRows * nCols * BLOCK_LEN_INT64);
+        for (uint64_t& word : matrix) word = g_insecure_rand_ctx.rand64();
+        for (uint64_t& word : state) word = g_insecure_rand_ctx.rand64();
+    }
+    uint64_t* Row(int row) { return matrix.data() + row * nCols * BLOCK_LEN_INT64; }
+    bool operator==(const SpongeTestState& other) const
+    {
+        return matrix == other.matrix && std::equal(state, state + 16, other.state);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(sponge_implementations_agree)
+{
+    const std::string algo = Lyra2AutoDetect();
+    if (algo == "standard") return; // nothing to compare against
+    BOOST_TEST_MESSAGE("Comparing the '" << algo << "' Lyra2 sponge with the generic one");
+
+    for (int iter = 0; iter < 16; iter++) {
+        const SpongeTestState start;
+
+        {
+            SpongeTestState a = start, b = start;
+            reducedDuplexRow1_generic(a.state, a.Row(0), a.Row(1), a.nCols);
+            reducedDuplexRow1(b.state, b.Row(0), b.Row(1), b.nCols);
+            BOOST_CHECK(a == b);
+        }
+
+        // Setup reads M[prev] and updates M[row*], which may be the same row
+        for (const auto& rows : std::vector<std::array<int, 3>>{{1, 0, 2}, {2, 2, 3}}) {
+            SpongeTestState a = start, b = start;
+            reducedDuplexRowSetup_generic(a.state, a.Row(rows[0]), a.Row(rows[1]), a.Row(rows[2]), a.nCols);
+            reducedDuplexRowSetup(b.state, b.Row(rows[0]), b.Row(rows[1]), b.Row(rows[2]), b.nCols);
+            BOOST_CHECK(a == b);
+        }
+
+        // Wandering may pick row* equal to prev or to the row being updated
+        for (const auto& rows : std::vector<std::array<int, 3>>{{3, 1, 0}, {3, 3, 0}, {3, 0, 0}, {2, 2, 2}}) {
+            SpongeTestState a = start, b = start;
+            reducedDuplexRow_generic(a.state, a.Row(rows[0]), a.Row(rows[1]), a.Row(rows[2]), a.nCols);
+            reducedDuplexRow(b.state, b.Row(rows[0]), b.Row(rows[1]), b.Row(rows[2]), b.nCols);
+            BOOST_CHECK(a == b);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -16,15 +16,19 @@
 #include <util/system.h>
 #include <util/time.h>
 #include <validation.h>
+#include <validationinterface.h>
 #include <versionbits.h>
 
 #include <test/util/setup_common.h>
 
+#include <atomic>
+#include <chrono>
 #include <memory>
 
 #include <boost/test/unit_test.hpp>
 
 using node::BlockAssembler;
+using node::BlockTemplateCache;
 using node::CBlockTemplate;
 
 namespace miner_tests {
@@ -37,6 +41,11 @@ struct MinerTestingSetup : public TestingSetup {
     }
     BlockAssembler AssemblerForTest(const CChainParams& params);
 };
+
+/** Long polls end once the template's fees grow by 0.015 */
+struct LongPollTestingSetup : public TestChain100Setup {
+    LongPollTestingSetup() : TestChain100Setup{{"-longpollfeedelta=0.015"}} {}
+};
 } // namespace miner_tests
 
 BOOST_FIXTURE_TEST_SUITE(miner_tests, MinerTestingSetup)
@@ -518,4 +527,120 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     fCheckpointsEnabled = true;
 }
 
+BOOST_FIXTURE_TEST_CASE(block_template_cache, TestChain100Setup)
+{
+    BlockTemplateCache cache{*m_node.chainman, *m_node.mempool, Params()};
+    RegisterValidationInterface(&cache);
+    const CScript script_pub_key{CScript() << OP_TRUE};
+    const CScript coinbase_script{GetScriptForRawPubKey(coinbaseKey.GetPubKey())};
+
+    BOOST_CHECK_EQUAL(cache.GetTemplate(script_pub_key)->block.vtx.size(), 1U);
+
+    // Transactions entering the mempool are appended, parents first
+    const CAmount value{m_coinbase_txns[0]->vout[0].nValue};
+    const CMutableTransaction parent{CreateValidMempoolTransaction(m_coinbase_txns[0], 0, 1, coinbaseKey, coinbase_script, value - CENT)};
+    const CMutableTransaction child{CreateValidMempoolTransaction(MakeTransactionRef(parent), 0, 101, coinbaseKey, coinbase_script, value - 2 * CENT)};
+    SyncWithValidationInterfaceQueue();
+
+    std::unique_ptr<CBlockTemplate> block_template{cache.GetTemplate(script_pub_key)};
+    BOOST_REQUIRE_EQUAL(block_template->block.vtx.size(), 3U);
+    BOOST_CHECK(block_template->block.vtx[1]->GetHash() == parent.GetHash());
+    BOOST_CHECK(block_template->block.vtx[2]->GetHash() == child.GetHash());
+    BOOST_CHECK_EQUAL(block_template->vTxFees[1] + block_template->vTxFees[2], 2 * CENT);
+    {
+        LOCK(cs_main);
+        BlockValidationState state;
+        BOOST_CHECK(TestBlockValidity(state, Params(), m_node.chainman->ActiveChainstate(), block_template->block, m_node.chainman->ActiveChain().Tip(), false, false));
+    }
+
+    // A full build selects the same transactions and pays the same
+    const std::unique_ptr<CBlockTemplate> fresh{cache.GetTemplate(script_pub_key, /*fresh=*/true)};
+    BOOST_REQUIRE_EQUAL(fresh->block.vtx.size(), 3U);
+    for (size_t i = 0; i < 3; ++i) {
+        BOOST_CHECK(fresh->block.vtx[i]->GetHash() == block_template->block.vtx[i]->GetHash());
+    }
+
+    // Transactions leaving the mempool take their descendants along
+    {
+        LOCK(m_node.mempool->cs);
+        m_node.mempool->removeRecursive(CTransaction{parent}, MemPoolRemovalReason::CONFLICT);
+    }
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(cache.GetTemplate(script_pub_key)->block.vtx.size(), 1U);
+
+    // A new tip starts over
+    CreateAndProcessBlock({}, script_pub_key);
+    block_template = cache.GetTemplate(script_pub_key);
+    BOOST_CHECK(block_template->block.hashPrevBlock == WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Tip()->GetBlockHash()));
+
+    // Waits end on a new tip, and all at once when interrupted
+    std::atomic<int> woken{0};
+    const auto later{std::chrono::steady_clock::now() + std::chrono::hours{1}};
+    uint256 tip_hash{block_template->block.hashPrevBlock};
+    BOOST_CHECK(cache.WaitForChange(tip_hash, m_node.mempool->GetTransactionsUpdated(), later, [&] { ++woken; }));
+    BOOST_CHECK(cache.WaitForChange(tip_hash, m_node.mempool->GetTransactionsUpdated(), later, [&] { ++woken; }));
+    cache.CheckWaits();
+    BOOST_CHECK_EQUAL(woken, 0);
+    tip_hash = CreateAndProcessBlock({}, script_pub_key).GetHash();
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(woken, 2);
+    BOOST_CHECK(cache.WaitForChange(tip_hash, m_node.mempool->GetTransactionsUpdated(), later, [&] { ++woken; }));
+    cache.InterruptWaits();
+    BOOST_CHECK_EQUAL(woken, 3);
+    BOOST_CHECK(!cache.WaitForChange(tip_hash, m_node.mempool->GetTransactionsUpdated(), later, [&] { ++woken; }));
+    BOOST_CHECK_EQUAL(woken, 3);
+
+    UnregisterValidationInterface(&cache);
+}
+
+BOOST_FIXTURE_TEST_CASE(block_template_cache_waits, LongPollTestingSetup)
+{
+    BlockTemplateCache cache{*m_node.chainman, *m_node.mempool, Params()};
+    RegisterValidationInterface(&cache);
+    const CScript script_pub_key{CScript() << OP_TRUE};
+    const CScript coinbase_script{GetScriptForRawPubKey(coinbaseKey.GetPubKey())};
+    const uint256 tip_hash{cache.GetTemplate(script_pub_key)->block.hashPrevBlock};
+    const auto now{std::chrono::steady_clock::now()};
+    const auto later{now + std::chrono::hours{1}};
+
+    // A wait ends once the template's fees grew by -longpollfeedelta, not
+    // on the first transaction
+    std::atomic<int> fee_woken{0};
+    BOOST_CHECK(cache.WaitForChange(tip_hash, m_node.mempool->GetTransactionsUpdated(), later, [&] { ++fee_woken; }));
+    const CAmount value{m_coinbase_txns[0]->vout[0].nValue};
+    const CMutableTransaction parent{CreateValidMempoolTransaction(m_coinbase_txns[0], 0, 1, coinbaseKey, coinbase_script, value - CENT)};
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(fee_woken, 0);
+    CreateValidMempoolTransaction(MakeTransactionRef(parent), 0, 101, coinbaseKey, coinbase_script, value - 2 * CENT);
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(fee_woken, 1);
+
+    // Past its deadline, a wait ends on the next check if the mempool changed
+    // in any other way since the caller's template
+    const unsigned int transactions_updated{m_node.mempool->GetTransactionsUpdated()};
+    std::atomic<int> stale_woken{0};
+    std::atomic<int> current_woken{0};
+    std::atomic<int> early_woken{0};
+    BOOST_CHECK(cache.WaitForChange(tip_hash, transactions_updated - 1, now, [&] { ++stale_woken; }));
+    BOOST_CHECK(cache.WaitForChange(tip_hash, transactions_updated, now, [&] { ++current_woken; }));
+    BOOST_CHECK(cache.WaitForChange(tip_hash, transactions_updated - 1, later, [&] { ++early_woken; }));
+    cache.CheckWaits();
+    BOOST_CHECK_EQUAL(stale_woken, 1);
+    BOOST_CHECK_EQUAL(current_woken, 0);
+    BOOST_CHECK_EQUAL(early_woken, 0);
+
+    // An unchanged mempool pushes the deadline back by LONGPOLL_RECHECK_INTERVAL,
+    // so a change right after is only noticed then
+    m_node.mempool->AddTransactionsUpdated(1);
+    cache.CheckWaits();
+    BOOST_CHECK_EQUAL(current_woken, 0);
+
+    cache.InterruptWaits();
+    BOOST_CHECK_EQUAL(current_woken, 1);
+    BOOST_CHECK_EQUAL(early_woken, 1);
+    BOOST_CHECK_EQUAL(stale_woken, 1);
+
+    UnregisterValidationInterface(&cache);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
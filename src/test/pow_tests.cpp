@@ -2,10 +2,17 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <bignum.h>
 #include <chain.h>
 #include <chainparams.h>
+#include <chainparamsbase.h>
+#include <crypto/verthash.h>
 #include <pow.h>
 #include <test/util/setup_common.h>
+#include <util/system.h>
+
+#include <cmath>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
@@ -182,4 +189,224 @@ BOOST_AUTO_TEST_CASE(ChainParams_SIGNET_sanity)
     sanity_check_chainparams(*m_node.args, CBaseChainParams::SIGNET);
 }
 
+/* The algorithm selection GetPoWHash() hardcoded before the schedule moved into Consensus::Params */
+static Consensus::PoWAlgorithm LegacyPoWAlgorithm(const std::string& chain, int nHeight)
+{
+    if ((chain == CBaseChainParams::TESTNET && nHeight >= VERTHASH_FORKBLOCK_TESTNET) ||
+        (chain == CBaseChainParams::MAIN && nHeight >= VERTHASH_FORKBLOCK_MAINNET) ||
+        chain == CBaseChainParams::REGTEST) {
+        return Consensus::PoWAlgorithm::VERTHASH;
+    } else if ((chain == CBaseChainParams::TESTNET && nHeight > 158220) || nHeight > 1080000) {
+        return Consensus::PoWAlgorithm::LYRA2REV3;
+    } else if (chain == CBaseChainParams::TESTNET || nHeight >= 347000) {
+        return Consensus::PoWAlgorithm::LYRA2REV2;
+    } else if (nHeight >= 208301) {
+        return Consensus::PoWAlgorithm::LYRA2RE;
+    }
+    return Consensus::PoWAlgorithm::SCRYPT_N;
+}
+
+BOOST_AUTO_TEST_CASE(pow_algorithm_schedule)
+{
+    for (const std::string& chain : {CBaseChainParams::MAIN, CBaseChainParams::TESTNET, CBaseChainParams::SIGNET, CBaseChainParams::REGTEST}) {
+        const auto consensus = CreateChainParams(*m_node.args, chain)->GetConsensus();
+        for (int fork : {0, 158221, 208301, 231000, 347000, 1080001, 1500000}) {
+            for (int height : {fork - 1, fork, fork + 1}) {
+                if (height < 0) continue;
+                BOOST_CHECK(consensus.GetPoWAlgorithm(height) == LegacyPoWAlgorithm(chain, height));
+            }
+        }
+        BOOST_CHECK(consensus.GetPoWAlgorithm(std::numeric_limits<int>::max()) == LegacyPoWAlgorithm(chain, std::numeric_limits<int>::max()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(pow_algorithm_schedule_args)
+{
+    ArgsManager args;
+    SetupChainParamsBaseOptions(args);
+    const char* argv[] = {"test", "-testpowalgorithm=scrypt@0", "-testpowalgorithm=lyra2rev3@10", "-testpowalgorithm=verthash@20"};
+    std::string error;
+    BOOST_REQUIRE(args.ParseParameters(std::size(argv), argv, error));
+    const auto consensus = CreateChainParams(args, CBaseChainParams::REGTEST)->GetConsensus();
+    BOOST_CHECK(consensus.GetPoWAlgorithm(0) == Consensus::PoWAlgorithm::SCRYPT_N);
+    BOOST_CHECK(consensus.GetPoWAlgorithm(9) == Consensus::PoWAlgorithm::SCRYPT_N);
+    BOOST_CHECK(consensus.GetPoWAlgorithm(10) == Consensus::PoWAlgorithm::LYRA2REV3);
+    BOOST_CHECK(consensus.GetPoWAlgorithm(20) == Consensus::PoWAlgorithm::VERTHASH);
+
+    ArgsManager bad_args;
+    SetupChainParamsBaseOptions(bad_args);
+    const char* bad_argv[] = {"test", "-testpowalgorithm=scrypt@5"};
+    BOOST_REQUIRE(bad_args.ParseParameters(std::size(bad_argv), bad_argv, error));
+    BOOST_CHECK_THROW(CreateChainParams(bad_args, CBaseChainParams::REGTEST), std::runtime_error);
+}
+
+/** KimotoGravityWell() as it was written on CBigNum, to check the fixed-width one against */
+static unsigned int KimotoGravityWellBigNum(const CBlockIndex* pindexLast, uint64_t TargetBlocksSpacingSeconds, uint64_t PastBlocksMin, uint64_t PastBlocksMax, const Consensus::Params& params)
+{
+    const CBlockIndex* BlockLastSolved = pindexLast;
+    const CBlockIndex* BlockReading = pindexLast;
+    uint64_t PastBlocksMass = 0;
+    int64_t PastRateActualSeconds = 0;
+    int64_t PastRateTargetSeconds = 0;
+    double PastRateAdjustmentRatio = double(1);
+    CBigNum PastDifficultyAverage;
+    CBigNum PastDifficultyAveragePrev;
+    const CBigNum bnProofOfWorkLimit(params.powLimit);
+    const CBigNum bnPreVerthashProofOfWorkLimit(params.preVerthashPowLimit);
+
+    if (BlockLastSolved == nullptr || BlockLastSolved->nHeight == 0 || static_cast<uint64_t>(BlockLastSolved->nHeight) < PastBlocksMin) return UintToArith256(params.powLimit).GetCompact();
+
+    for (unsigned int i = 1; BlockReading && BlockReading->nHeight > 0; i++) {
+        if (PastBlocksMax > 0 && i > PastBlocksMax) break;
+        PastBlocksMass++;
+        if (i == 1) {
+            PastDifficultyAverage.SetCompact(BlockReading->nBits);
+        } else {
+            PastDifficultyAverage = ((CBigNum().SetCompact(BlockReading->nBits) - PastDifficultyAveragePrev) / i) + PastDifficultyAveragePrev;
+        }
+        PastDifficultyAveragePrev = PastDifficultyAverage;
+
+        PastRateActualSeconds = BlockLastSolved->GetBlockTime() - BlockReading->GetBlockTime();
+        PastRateTargetSeconds = TargetBlocksSpacingSeconds * PastBlocksMass;
+        PastRateAdjustmentRatio = double(1);
+        if (PastRateActualSeconds < 0) PastRateActualSeconds = 0;
+        if (PastRateActualSeconds != 0 && PastRateTargetSeconds != 0) {
+            PastRateAdjustmentRatio = double(PastRateTargetSeconds) / double(PastRateActualSeconds);
+        }
+        const double EventHorizonDeviation = 1 + (0.7084 * std::pow((double(PastBlocksMass) / double(144)), -1.228));
+        if (PastBlocksMass >= PastBlocksMin) {
+            if ((PastRateAdjustmentRatio <= 1 / EventHorizonDeviation) || (PastRateAdjustmentRatio >= EventHorizonDeviation)) break;
+        }
+        if (BlockReading->pprev == nullptr ||
+            std::find(params.kgwResetHeights.begin(), params.kgwResetHeights.end(), BlockReading->nHeight) != params.kgwResetHeights.end()) {
+            break;
+        }
+        BlockReading = BlockReading->pprev;
+    }
+
+    CBigNum bnNew(PastDifficultyAverage);
+    if (PastRateActualSeconds != 0 && PastRateTargetSeconds != 0) {
+        bnNew *= PastRateActualSeconds;
+        bnNew /= PastRateTargetSeconds;
+    }
+    if (params.GetPoWAlgorithm(BlockLastSolved->nHeight + 1) == Consensus::PoWAlgorithm::VERTHASH) {
+        if (bnNew > bnProofOfWorkLimit) return bnProofOfWorkLimit.GetCompact();
+    } else if (bnNew > bnPreVerthashProofOfWorkLimit) {
+        return bnPreVerthashProofOfWorkLimit.GetCompact();
+    }
+    return bnNew.GetCompact();
+}
+
+static void CheckKimotoGravityWell(const ArgsManager& args, const std::string& chain_name, int start_height)
+{
+    const auto chainParams = CreateChainParams(args, chain_name);
+    const Consensus::Params& params = chainParams->GetConsensus();
+    const unsigned int limit = UintToArith256(params.preVerthashPowLimit).GetCompact();
+
+    // A chain that crosses the reset heights, with stretches of steady
+    // blocks, bursts, stalls, timestamps going backwards and odd targets
+    std::vector<CBlockIndex> blocks(3000);
+    for (size_t i = 0; i < blocks.size(); i++) {
+        CBlockIndex& block = blocks[i];
+        block.pprev = i ? &blocks[i - 1] : nullptr;
+        block.nHeight = start_height + i;
+        if (i == 0) {
+            block.nTime = 1600000000;
+            block.nBits = 0x1b0ffff0;
+            continue;
+        }
+        int64_t spacing;
+        switch ((i / 200) % 4) {
+        case 0: spacing = 150; break;
+        case 1: spacing = InsecureRandRange(40); break;
+        case 2: spacing = 150 + InsecureRandRange(3000); break;
+        default: spacing = int64_t(InsecureRandRange(1200)) - 300; break;
+        }
+        block.nTime = blocks[i - 1].nTime + spacing;
+        if (InsecureRandBool()) {
+            block.nBits = KimotoGravityWell(&blocks[i - 1], nullptr, 150, 144, 4032, params);
+        } else {
+            // Any exponent and mantissa up to the limit
+            block.nBits = std::min<unsigned int>(limit, (0x03 + InsecureRandRange(0x1d)) << 24 | InsecureRandBits(23));
+        }
+    }
+
+    for (size_t i = 0; i < blocks.size(); i += 1 + InsecureRandRange(4)) {
+        BOOST_CHECK_EQUAL(KimotoGravityWell(&blocks[i], nullptr, 150, 144, 4032, params), KimotoGravityWellBigNum(&blocks[i], 150, 144, 4032, params));
+    }
+    // Short windows, and none at all
+    BOOST_CHECK_EQUAL(KimotoGravityWell(&blocks.back(), nullptr, 150, 10, 20, params), KimotoGravityWellBigNum(&blocks.back(), 150, 10, 20, params));
+    BOOST_CHECK_EQUAL(KimotoGravityWell(&blocks.back(), nullptr, 150, 0, 0, params), KimotoGravityWellBigNum(&blocks.back(), 150, 0, 0, params));
+}
+
+BOOST_AUTO_TEST_CASE(kimoto_gravity_well_matches_bignum)
+{
+    CheckKimotoGravityWell(*m_node.args, CBaseChainParams::MAIN, 1080000 - 1500);
+    CheckKimotoGravityWell(*m_node.args, CBaseChainParams::MAIN, VERTHASH_FORKBLOCK_MAINNET - 1500);
+    CheckKimotoGravityWell(*m_node.args, CBaseChainParams::TESTNET, VERTHASH_FORKBLOCK_TESTNET - 1500);
+}
+
+BOOST_AUTO_TEST_CASE(kimoto_gravity_well_window_cache)
+{
+    const auto chainParams = CreateChainParams(*m_node.args, CBaseChainParams::MAIN);
+    const Consensus::Params& params = chainParams->GetConsensus();
+
+    // Blocks with hashes, so KGW keeps their window between calls: a chain
+    // of 6000 blocks and a fork of 200 blocks off its 5000th
+    std::vector<CBlockIndex> blocks(6200);
+    std::vector<uint256> hashes(blocks.size());
+    for (size_t i = 0; i < blocks.size(); i++) {
+        CBlockIndex& block = blocks[i];
+        hashes[i] = InsecureRand256();
+        block.phashBlock = &hashes[i];
+        block.pprev = i == 6000 ? &blocks[4999] : i ? &blocks[i - 1] : nullptr;
+        block.nHeight = block.pprev ? block.pprev->nHeight + 1 : VERTHASH_FORKBLOCK_MAINNET + 100;
+        block.nTime = block.pprev ? block.pprev->nTime + InsecureRandRange(600) : 1600000000;
+        block.nBits = block.pprev ? KimotoGravityWell(block.pprev, nullptr, 150, 144, 4032, params) : 0x1c07fff8;
+    }
+
+    // Following the chain, jumping around in it, and switching to the fork and back
+    std::vector<size_t> tips;
+    for (size_t i = 4000; i < 6200; i++) tips.push_back(i);
+    for (int i = 0; i < 50; i++) tips.push_back(InsecureRandRange(blocks.size()));
+    for (size_t i = 5000; i < 5100; i++) tips.push_back(i);
+    // Alternating between the chain and the fork, as callers on competing tips do
+    for (size_t i = 0; i < 200; i++) {
+        tips.push_back(5000 + i);
+        tips.push_back(6000 + i);
+    }
+    for (size_t tip : tips) {
+        BOOST_CHECK_EQUAL(KimotoGravityWell(&blocks[tip], nullptr, 150, 144, 4032, params), KimotoGravityWellBigNum(&blocks[tip], 150, 144, 4032, params));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(pow_cache)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    CBlockHeader header;
+    header.nBits = UintToArith256(params.powLimit).GetCompact();
+    header.nTime = 1400000000;
+    while (CheckProofOfWork(header.GetPoWHash(1), header.nBits, params)) header.nNonce++;
+
+    const PoWCacheStats before = GetPoWCacheStats();
+    BOOST_CHECK(before.max_elements > 0);
+
+    // Failures are not remembered
+    BOOST_CHECK(!CheckBlockProofOfWork(header, 1, params));
+    BOOST_CHECK(!CheckBlockProofOfWork(header, 1, params));
+
+    // Claim a PoW hash that passes: from now on the header is answered
+    // from the cache, without hashing it
+    const uint256 zero;
+    BOOST_CHECK(CheckBlockProofOfWork(header, 1, params, &zero));
+    BOOST_CHECK(CheckBlockProofOfWork(header, 1, params));
+
+    // At another height the header is a different entry
+    BOOST_CHECK(!CheckBlockProofOfWork(header, 2, params));
+
+    const PoWCacheStats after = GetPoWCacheStats();
+    BOOST_CHECK_EQUAL(after.hits - before.hits, 1U);
+    BOOST_CHECK_EQUAL(after.misses - before.misses, 4U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
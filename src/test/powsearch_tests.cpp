@@ -0,0 +1,85 @@
+// Copyright (c) 2021 The Vertcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <chainparams.h>
+#include <powsearch.h>
+#include <primitives/block.h>
+#include <test/util/setup_common.h>
+
+#include <atomic>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(powsearch_tests, BasicTestingSetup)
+
+// Mainnet's first blocks are scrypt-N, which needs no datafile
+static constexpr int SCRYPT_HEIGHT{1};
+
+static bool MeetsTarget(const CBlockHeader& header)
+{
+    arith_uint256 target;
+    target.SetCompact(header.nBits);
+    return UintToArith256(header.GetPoWHash(SCRYPT_HEIGHT)) <= target;
+}
+
+static CBlockHeader EasyHeader()
+{
+    CBlockHeader header;
+    header.nTime = 1400000000;
+    // About one hash in 16 passes
+    header.nBits = 0x200fffff;
+    return header;
+}
+
+BOOST_AUTO_TEST_CASE(search_finds_lowest_nonce)
+{
+    for (int threads : {1, 4}) {
+        CBlockHeader header = EasyHeader();
+        const PoWSearchResult result = SearchNonce(header, SCRYPT_HEIGHT, 10000, threads);
+        BOOST_REQUIRE(result.found);
+        BOOST_CHECK(MeetsTarget(header));
+        BOOST_CHECK(result.hashes > header.nNonce);
+
+        // No lower nonce passes, whatever the number of threads
+        CBlockHeader lower = header;
+        for (lower.nNonce = 0; lower.nNonce < header.nNonce; lower.nNonce++) {
+            BOOST_CHECK(!MeetsTarget(lower));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(search_limits)
+{
+    CBlockHeader header = EasyHeader();
+    // A target nothing meets
+    header.nBits = 0x03000001;
+
+    // Stops after max_tries, even when that is not a multiple of the batch size
+    PoWSearchResult result = SearchNonce(header, SCRYPT_HEIGHT, 100, 3);
+    BOOST_CHECK(!result.found);
+    BOOST_CHECK_EQUAL(result.hashes, 100U);
+    BOOST_CHECK_EQUAL(header.nNonce, 0U);
+
+    // Stops at the end of the nonce space
+    header.nNonce = std::numeric_limits<uint32_t>::max() - 9;
+    result = SearchNonce(header, SCRYPT_HEIGHT, 1000, 2);
+    BOOST_CHECK(!result.found);
+    BOOST_CHECK_EQUAL(result.hashes, 10U);
+
+    // Stops when interrupted, after the batches in progress
+    header.nNonce = 0;
+    std::atomic<int> calls{0};
+    result = SearchNonce(header, SCRYPT_HEIGHT, 100000, 2, [&] { return ++calls >= 3; });
+    BOOST_CHECK(!result.found);
+    BOOST_CHECK(result.hashes <= 4 * POW_SEARCH_BATCH_SIZE);
+
+    // Targets that cannot be met are not searched
+    header.nBits = 0;
+    result = SearchNonce(header, SCRYPT_HEIGHT, 1000, 2);
+    BOOST_CHECK(!result.found);
+    BOOST_CHECK_EQUAL(result.hashes, 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
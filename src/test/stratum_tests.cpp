@@ -0,0 +1,112 @@
+// Copyright (c) 2021 The Vertcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <consensus/merkle.h>
+#include <hash.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <stratum.h>
+#include <test/util/setup_common.h>
+#include <univalue.h>
+#include <util/strencodings.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(stratum_tests, BasicTestingSetup)
+
+static CBlock TemplateBlock(int height, size_t num_txs)
+{
+    CBlock block;
+    block.nVersion = 0x20000000;
+    block.hashPrevBlock = InsecureRand256();
+    block.nTime = 1600000000;
+    block.nBits = 0x1e0fffff;
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].scriptSig = CScript() << height << OP_0;
+    coinbase.vin[0].scriptWitness.stack.push_back(std::vector<unsigned char>(32, 0));
+    coinbase.vout.resize(2);
+    coinbase.vout[0].nValue = 25 * COIN;
+    coinbase.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    coinbase.vout[1].scriptPubKey = CScript() << OP_RETURN << std::vector<unsigned char>(36, 0xaa);
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+
+    for (size_t i = 0; i < num_txs; ++i) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(InsecureRand256(), i);
+        tx.vout.resize(1);
+        tx.vout[0].nValue = i;
+        block.vtx.push_back(MakeTransactionRef(tx));
+    }
+    return block;
+}
+
+BOOST_AUTO_TEST_CASE(stratum_job_solve)
+{
+    const int height{1234567};
+    for (size_t num_txs : {0, 1, 2, 4, 6, 11}) {
+        const CBlock tmpl{TemplateBlock(height, num_txs)};
+        const StratumJob job(tmpl, height);
+        BOOST_CHECK_EQUAL(job.block.hashMerkleRoot, BlockMerkleRoot(job.block));
+
+        const std::vector<unsigned char> extranonce{ParseHex("0102030405060708")};
+        const CBlock solved{job.Solve(extranonce, tmpl.nTime + 5, 0xdeadbeef)};
+        BOOST_CHECK_EQUAL(solved.nTime, tmpl.nTime + 5);
+        BOOST_CHECK_EQUAL(solved.nNonce, 0xdeadbeef);
+        BOOST_CHECK(solved.hashPrevBlock == tmpl.hashPrevBlock);
+        BOOST_CHECK_EQUAL(solved.vtx.size(), tmpl.vtx.size());
+        BOOST_CHECK_EQUAL(solved.hashMerkleRoot, BlockMerkleRoot(solved));
+        BOOST_CHECK(solved.vtx[0]->vin[0].scriptSig == (CScript() << height << extranonce));
+        // The witness commitment and nonce of the template are kept
+        BOOST_CHECK(solved.vtx[0]->vin[0].scriptWitness.stack == tmpl.vtx[0]->vin[0].scriptWitness.stack);
+        BOOST_CHECK(solved.vtx[0]->vout == tmpl.vtx[0]->vout);
+
+        // What a miner computes from mining.notify gives the same block
+        std::vector<unsigned char> coinbase{job.coinbase1};
+        coinbase.insert(coinbase.end(), extranonce.begin(), extranonce.end());
+        coinbase.insert(coinbase.end(), job.coinbase2.begin(), job.coinbase2.end());
+        BOOST_CHECK_EQUAL(Hash(coinbase), solved.vtx[0]->GetHash());
+        uint256 root{Hash(coinbase)};
+        for (const uint256& hash : job.merkle_branch) {
+            root = Hash(root, hash);
+        }
+        BOOST_CHECK_EQUAL(root, solved.hashMerkleRoot);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(stratum_notify_params)
+{
+    CBlock tmpl{TemplateBlock(100, 2)};
+    tmpl.hashPrevBlock = uint256S("00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff");
+    const StratumJob job(tmpl, 100);
+    const UniValue params{job.NotifyParams("7", /*clean=*/true)};
+    BOOST_REQUIRE_EQUAL(params.size(), 9U);
+    BOOST_CHECK_EQUAL(params[0].get_str(), "7");
+    // Internal byte order with every 32-bit word byte swapped
+    BOOST_CHECK_EQUAL(params[1].get_str(), "ccddeeff8899aabb4455667700112233ccddeeff8899aabb4455667700112233");
+    BOOST_CHECK_EQUAL(params[2].get_str(), HexStr(job.coinbase1));
+    BOOST_CHECK_EQUAL(params[3].get_str(), HexStr(job.coinbase2));
+    BOOST_REQUIRE_EQUAL(params[4].size(), 2U);
+    BOOST_CHECK_EQUAL(params[4][0].get_str(), HexStr(tmpl.vtx[1]->GetHash()));
+    BOOST_CHECK_EQUAL(params[5].get_str(), "20000000");
+    BOOST_CHECK_EQUAL(params[6].get_str(), "1e0fffff");
+    BOOST_CHECK_EQUAL(params[7].get_str(), "5f5e1000");
+    BOOST_CHECK(params[8].get_bool());
+}
+
+BOOST_AUTO_TEST_CASE(stratum_share_target)
+{
+    arith_uint256 diff1;
+    diff1.SetCompact(0x1d00ffff);
+    BOOST_CHECK(StratumShareTarget(STRATUM_DIFFICULTY_UNIT) == diff1);
+    BOOST_CHECK(StratumShareTarget(2 * STRATUM_DIFFICULTY_UNIT) == diff1 / 2);
+    BOOST_CHECK(StratumShareTarget(STRATUM_DIFFICULTY_UNIT / 4) == diff1 * 4);
+    BOOST_CHECK(StratumShareTarget(1) == diff1 * (uint32_t)STRATUM_DIFFICULTY_UNIT);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -10,7 +10,10 @@
 #include <consensus/consensus.h>
 #include <consensus/params.h>
 #include <consensus/validation.h>
+#include <crypto/Lyra2RE/Lyra2RE.h>
+#include <crypto/scrypt.h>
 #include <crypto/sha256.h>
+#include <crypto/sha3.h>
 #include <init.h>
 #include <interfaces/chain.h>
 #include <net.h>
@@ -53,6 +56,8 @@ using node::fPruneMode;
 using node::fReindex;
 
 const std::function<std::string(const char*)> G_TRANSLATION_FUN = nullptr;
+
+extern ChainstateManager* g_chainman;
 UrlDecodeFn* const URL_DECODE = nullptr;
 
 FastRandomContext g_insecure_rand_ctx;
@@ -124,11 +129,15 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName, const std::ve
     AppInitParameterInteraction(*m_node.args);
     LogInstance().StartLogging();
     SHA256AutoDetect();
+    SHA3AutoDetect();
+    Lyra2AutoDetect();
+    ScryptAutoDetect();
     ECC_Start();
     SetupEnvironment();
     SetupNetworking();
     InitSignatureCache();
     InitScriptExecutionCache();
+    InitPoWCache();
     m_node.chain = interfaces::MakeChain(m_node);
     fCheckBlockIndex = true;
     static bool noui_connected = false;
@@ -162,6 +171,7 @@ ChainTestingSetup::ChainTestingSetup(const std::string& chainName, const std::ve
     m_cache_sizes = CalculateCacheSizes(m_args);
 
     m_node.chainman = std::make_unique<ChainstateManager>();
+    g_chainman = m_node.chainman.get();
     m_node.chainman->m_blockman.m_block_tree_db = std::make_unique<CBlockTreeDB>(m_cache_sizes.block_tree_db, true);
 
     // Start script-checking threads. Set g_parallel_script_checks to true so they are used.
@@ -184,6 +194,7 @@ ChainTestingSetup::~ChainTestingSetup()
     m_node.mempool.reset();
     m_node.scheduler.reset();
     m_node.chainman->Reset();
+    g_chainman = nullptr;
     m_node.chainman.reset();
 }
 
@@ -239,7 +250,9 @@ TestingSetup::TestingSetup(const std::string& chainName, const std::vector<const
 }
 
 TestChain100Setup::TestChain100Setup(const std::vector<const char*>& extra_args)
-    : TestingSetup{CBaseChainParams::REGTEST, extra_args}
+    // Regtest hashes with Verthash from genesis, which needs the datafile;
+    // mine the test chain with scrypt instead
+    : TestingSetup{CBaseChainParams::REGTEST, Cat({"-testpowalgorithm=scrypt@0"}, extra_args)}
 {
     SetMockTime(1598887952);
     constexpr std::array<unsigned char, 32> vchKey = {
@@ -253,7 +266,7 @@ TestChain100Setup::TestChain100Setup(const std::vector<const char*>& extra_args)
         LOCK(::cs_main);
         assert(
             m_node.chainman->ActiveChain().Tip()->GetBlockHash().ToString() ==
-            "571d80a9967ae599cec0448b0b0ba1cfb606f584d8069bd7166b86854ba7a191");
+            "efa0eea22b7ed549190837a75d815c85231c9365b8d2fa35a90abcbd88b44239");
     }
 }
 
@@ -283,7 +296,8 @@ CBlock TestChain100Setup::CreateBlock(
     }
     RegenerateCommitments(block, *Assert(m_node.chainman));
 
-    while (!CheckProofOfWork(block.GetHash(), block.nBits, chainparams.GetConsensus())) ++block.nNonce;
+    const int height{WITH_LOCK(::cs_main, return chainstate.m_chain.Height() + 1)};
+    while (!CheckProofOfWork(block.GetPoWHash(height), block.nBits, chainparams.GetConsensus())) ++block.nNonce;
 
     return block;
 }
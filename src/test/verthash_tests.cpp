@@ -0,0 +1,279 @@
+// Copyright (c) 2021 The Vertcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crypto/sha256.h>
+#include <crypto/sha3.h>
+#include <crypto/verthash.h>
+#include <crypto/verthash_datfile.h>
+#include <fs.h>
+#include <primitives/block.h>
+#include <random.h>
+#include <test/util/setup_common.h>
+#include <uint256.h>
+#include <util/system.h>
+
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(verthash_tests, BasicTestingSetup)
+
+/** Write a small deterministic stand-in for verthash.dat into the datadir.
+ *  The odd size makes sure the last slot is addressed correctly. */
+static void WriteTestDatFile(size_t size)
+{
+    FastRandomContext rng(uint256{});
+    const std::vector<unsigned char> data = rng.randbytes(size);
+    FILE* file = fsbridge::fopen(gArgs.GetDataDirNet() / "verthash.dat", "wb");
+    BOOST_REQUIRE(file != nullptr);
+    BOOST_REQUIRE_EQUAL(fwrite(data.data(), 1, data.size(), file), data.size());
+    fclose(file);
+}
+
+static uint256 HashHeader(const std::vector<unsigned char>& header)
+{
+    uint256 hash;
+    Verthash::Hash((const char*)header.data(), (char*)hash.begin());
+    return hash;
+}
+
+BOOST_AUTO_TEST_CASE(verthash_backends_agree)
+{
+    WriteTestDatFile((1 << 20) + 48);
+    std::vector<unsigned char> header(80);
+    for (size_t i = 0; i < header.size(); i++) header[i] = i;
+
+    const uint256 expected = uint256S("ec033431249d5c0d53041abce307e22a55ad600480d55ae922ba9ea33978b12f");
+    BOOST_CHECK_EQUAL(HashHeader(header), expected);
+
+    Verthash::LoadInRam();
+    BOOST_CHECK_EQUAL(HashHeader(header), expected);
+    Verthash::LoadInRam(/* fHugePages */ true);
+    BOOST_CHECK_EQUAL(HashHeader(header), expected);
+    Verthash::MapFile();
+    BOOST_CHECK_EQUAL(HashHeader(header), expected);
+    Verthash::MapFile(/* fHugePages */ true);
+    BOOST_CHECK_EQUAL(HashHeader(header), expected);
+    Verthash::MapFile(/* fHugePages */ false, /* fPopulate */ true);
+    BOOST_CHECK_EQUAL(HashHeader(header), expected);
+
+    // A synthetic datafile must never pass verification
+    BOOST_CHECK(!Verthash::VerifyDatFile());
+    BOOST_CHECK(!Verthash::VerifyDatFile(/* fForce */ true));
+    BOOST_CHECK(!fs::exists(gArgs.GetDataDirNet() / "verthash.dat.verified"));
+    Verthash::Unload();
+}
+
+BOOST_AUTO_TEST_CASE(verthash_diskonly_concurrent)
+{
+    WriteTestDatFile((1 << 16) + 16);
+    Verthash::OpenFile();
+
+    std::vector<std::vector<unsigned char>> headers;
+    std::vector<uint256> expected;
+    for (int i = 0; i < 8; i++) {
+        headers.push_back(std::vector<unsigned char>(80, i));
+        expected.push_back(HashHeader(headers.back()));
+    }
+
+    // The shared handle must give the same results when hashed from many threads at once
+    std::vector<uint256> results(headers.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < headers.size(); i++) {
+        threads.emplace_back([&, i] { results[i] = HashHeader(headers[i]); });
+    }
+    for (auto& thread : threads) thread.join();
+    BOOST_CHECK(results == expected);
+
+    Verthash::LoadInRam();
+    for (size_t i = 0; i < headers.size(); i++) {
+        BOOST_CHECK_EQUAL(HashHeader(headers[i]), expected[i]);
+    }
+    Verthash::Unload();
+}
+
+BOOST_AUTO_TEST_CASE(verthash_shared_file)
+{
+    WriteTestDatFile((1 << 20) + 48);
+    std::vector<unsigned char> header(80);
+    for (size_t i = 0; i < header.size(); i++) header[i] = i;
+    const uint256 expected = uint256S("ec033431249d5c0d53041abce307e22a55ad600480d55ae922ba9ea33978b12f");
+
+    // Move the datafile out of the datadir, as if another node had created it
+    const fs::path shared_dir = gArgs.GetDataDirNet() / "shared";
+    fs::create_directories(shared_dir);
+    fs::rename(gArgs.GetDataDirNet() / "verthash.dat", shared_dir / "verthash.dat");
+    BOOST_CHECK_EQUAL(Verthash::GetDatFilePath(), gArgs.GetDataDirNet() / "verthash.dat");
+
+    // Relative paths are resolved against the datadir
+    gArgs.ForceSetArg("-verthashfile", "shared/verthash.dat");
+    BOOST_CHECK_EQUAL(Verthash::GetDatFilePath(), shared_dir / "verthash.dat");
+    gArgs.ForceSetArg("-verthashfile", fs::PathToString(shared_dir / "verthash.dat"));
+    BOOST_CHECK_EQUAL(Verthash::GetDatFilePath(), shared_dir / "verthash.dat");
+
+    Verthash::MapFile();
+    BOOST_CHECK_EQUAL(HashHeader(header), expected);
+    Verthash::OpenFile();
+    BOOST_CHECK_EQUAL(HashHeader(header), expected);
+    Verthash::LoadInRam();
+    BOOST_CHECK_EQUAL(HashHeader(header), expected);
+
+    // Verification is remembered in the datadir, not next to the shared file
+    BOOST_CHECK(!Verthash::VerifyDatFile());
+    BOOST_CHECK(!fs::exists(shared_dir / "verthash.dat.verified"));
+
+    Verthash::Unload();
+    gArgs.ForceSetArg("-verthashfile", "");
+    BOOST_CHECK_EQUAL(Verthash::GetDatFilePath(), gArgs.GetDataDirNet() / "verthash.dat");
+}
+
+BOOST_AUTO_TEST_CASE(verthash_numa_placement)
+{
+    BOOST_CHECK(Verthash::ParseNumaPolicy("none") == Verthash::NumaPolicy::NONE);
+    BOOST_CHECK(Verthash::ParseNumaPolicy("interleave") == Verthash::NumaPolicy::INTERLEAVE);
+    BOOST_CHECK(Verthash::ParseNumaPolicy("replicate") == Verthash::NumaPolicy::REPLICATE);
+    BOOST_CHECK(!Verthash::ParseNumaPolicy("all"));
+
+    WriteTestDatFile((1 << 20) + 48);
+    std::vector<unsigned char> header(80);
+    for (size_t i = 0; i < header.size(); i++) header[i] = i;
+    const uint256 expected = uint256S("ec033431249d5c0d53041abce307e22a55ad600480d55ae922ba9ea33978b12f");
+
+    // Whatever the number of nodes here, the placement must not change the hashes
+    const size_t nodes = std::max<size_t>(Verthash::GetNumaNodes().size(), 1);
+    for (auto policy : {Verthash::NumaPolicy::NONE, Verthash::NumaPolicy::INTERLEAVE, Verthash::NumaPolicy::REPLICATE}) {
+        Verthash::LoadInRam();
+        const size_t placed = Verthash::PlaceOnNumaNodes(policy);
+        BOOST_CHECK(placed >= 1 && placed <= nodes);
+        BOOST_CHECK_EQUAL(HashHeader(header), expected);
+        std::vector<const char*> inputs(3, (const char*)header.data());
+        std::vector<uint256> outputs(inputs.size());
+        Verthash::HashBatch(inputs, outputs);
+        for (const uint256& output : outputs) BOOST_CHECK_EQUAL(output, expected);
+    }
+
+    // Placing a datafile that is not in memory is a no-op
+    Verthash::Unload();
+    Verthash::OpenFile();
+    BOOST_CHECK_EQUAL(Verthash::PlaceOnNumaNodes(Verthash::NumaPolicy::REPLICATE), 1U);
+    BOOST_CHECK_EQUAL(HashHeader(header), expected);
+    Verthash::Unload();
+}
+
+static void CheckBatchMatchesSingle(const std::vector<std::vector<unsigned char>>& headers)
+{
+    std::vector<const char*> inputs;
+    std::vector<uint256> expected;
+    for (const auto& header : headers) {
+        inputs.push_back((const char*)header.data());
+        expected.push_back(HashHeader(header));
+    }
+    std::vector<uint256> outputs(inputs.size());
+    Verthash::HashBatch(inputs, outputs);
+    BOOST_CHECK(outputs == expected);
+}
+
+BOOST_AUTO_TEST_CASE(sha3_4way)
+{
+    // Cover empty input, exact multiples of both rates and inputs spanning several blocks
+    for (size_t len : {0, 1, 32, 64, 71, 72, 80, 96, 128, 135, 136, 137, 200, 300}) {
+        for (size_t mdlen : {32, 64}) {
+            std::vector<unsigned char> data[4], out[4];
+            const unsigned char* in[4];
+            unsigned char* outp[4];
+            for (int i = 0; i < 4; i++) {
+                data[i] = g_insecure_rand_ctx.randbytes(len);
+                out[i].resize(mdlen);
+                in[i] = data[i].data();
+                outp[i] = out[i].data();
+            }
+            SHA3_4way(in, len, outp, mdlen);
+            for (int i = 0; i < 4; i++) {
+                std::vector<unsigned char> expected(mdlen);
+                sha3(data[i].data(), len, expected.data(), mdlen);
+                BOOST_CHECK(out[i] == expected);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(verthash_batch)
+{
+    WriteTestDatFile((1 << 20) + 48);
+
+    // Not a multiple of BATCH_LANES, so the last group is partial
+    std::vector<std::vector<unsigned char>> headers;
+    for (size_t i = 0; i < Verthash::BATCH_LANES * 2 + 3; i++) {
+        headers.push_back(g_insecure_rand_ctx.randbytes(80));
+    }
+
+    CheckBatchMatchesSingle(headers);
+    Verthash::LoadInRam();
+    CheckBatchMatchesSingle(headers);
+    CheckBatchMatchesSingle({headers[0]});
+    CheckBatchMatchesSingle({});
+    Verthash::Unload();
+}
+
+BOOST_AUTO_TEST_CASE(pow_hash_batch)
+{
+    WriteTestDatFile((1 << 16) + 16);
+    Verthash::LoadInRam();
+
+    // One header from every mainnet PoW era: scrypt-N, Lyra2RE, Lyra2REv2, Lyra2REv3 and Verthash
+    const std::vector<int> heights{0, 208301, 347000, 1080001, 1500000, 1500001, 2000000};
+    std::vector<CBlockHeader> headers(heights.size());
+    for (size_t i = 0; i < headers.size(); i++) {
+        headers[i].nVersion = 4;
+        headers[i].hashPrevBlock = InsecureRand256();
+        headers[i].hashMerkleRoot = InsecureRand256();
+        headers[i].nTime = 1600000000 + i;
+        headers[i].nBits = 0x1b0ffff0;
+        headers[i].nNonce = InsecureRand32();
+    }
+
+    std::vector<uint256> hashes(headers.size());
+    GetPoWHashes(headers, heights, hashes);
+    for (size_t i = 0; i < headers.size(); i++) {
+        BOOST_CHECK_EQUAL(hashes[i], headers[i].GetPoWHash(heights[i]));
+    }
+    Verthash::Unload();
+}
+
+static uint256 GenerateAndHash(int64_t index, int threads)
+{
+    const fs::path path = gArgs.GetDataDirNet() / "graph.dat";
+    int last_progress = -1;
+    VerthashDatFile::GenerateDataFile(path, index, threads, [&](int progress) {
+        BOOST_CHECK(progress > last_progress && progress <= 100);
+        last_progress = progress;
+    });
+    BOOST_CHECK_EQUAL(last_progress, 100);
+
+    FILE* file = fsbridge::fopen(path, "rb");
+    BOOST_REQUIRE(file != nullptr);
+    std::vector<unsigned char> data(fs::file_size(path));
+    BOOST_REQUIRE_EQUAL(fread(data.data(), 1, data.size(), file), data.size());
+    fclose(file);
+    fs::remove(path);
+
+    uint256 hash;
+    CSHA256().Write(data.data(), data.size()).Finalize(hash.begin());
+    return hash;
+}
+
+BOOST_AUTO_TEST_CASE(verthash_datfile_generation)
+{
+    // Reference hashes of small graphs as built by the original file-backed generator
+    BOOST_CHECK_EQUAL(GenerateAndHash(1, 1), uint256S("df4d94b4f2bb2fcd051affc6f16db63e0c7485a80376f4a81d6e504640b5b1a4"));
+    BOOST_CHECK_EQUAL(GenerateAndHash(2, 1), uint256S("ad8992d5574ca8c8dc61831da398001f9a576409b12fd322dec4fa7f6c8d9f66"));
+    BOOST_CHECK_EQUAL(GenerateAndHash(3, 1), uint256S("6bce702ad3cb823447313d029f5d10de9c065d0e3d9f93657678b9c03645e2f3"));
+    BOOST_CHECK_EQUAL(GenerateAndHash(4, 1), uint256S("195b0ab612dd390de084c07e2c1ac1b20676ed36743aeb5b3dd6905308c0bd0e"));
+    BOOST_CHECK_EQUAL(GenerateAndHash(6, 2), uint256S("1a8c40ab95bace3de10c8b4af9ef2956ed0d25fb6d1e43d6fa53989c64946efd"));
+    // Large enough for the levels to be split across threads
+    BOOST_CHECK_EQUAL(GenerateAndHash(12, 4), uint256S("f0c3dfb1127df338b4b7d111d8bb518f849362b8e0153e9a03f4cd93c2f09091"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
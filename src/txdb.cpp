@@ -300,8 +300,6 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
     AssertLockHeld(::cs_main);
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
-    const bool fullChainVerification = gArgs.GetBoolArg("-full-startup-verify", false);
-
     const CChainParams& chainparams = Params();
     MapCheckpoints checkPoints = chainparams.Checkpoints().mapCheckpoints;
     int highestCheckpointHeight = checkPoints.rbegin()->first;
@@ -337,13 +335,6 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
                     if(pindexNew->GetBlockHash() != it->second)
                         return error("%s: Block hash mismatches checkpoint: %s\n", __func__, pindexNew->ToString());
                 }
-                if(fullChainVerification)
-                {
-                    if(pindexNew->nHeight % 10000 == 0) LogPrintf("Checking PoW for block %i\n", pindexNew->nHeight);
-                    if (!CheckProofOfWork(pindexNew->GetBlockPoWHash(), pindexNew->nBits, consensusParams)) {
-                        return error("%s: CheckProofOfWork failed: %s\n", __func__, pindexNew->ToString());
-                    }
-                }
                 pcursor->Next();
             } else {
                 return error("%s: failed to read value", __func__);
@@ -551,6 +551,7 @@ public:
     {
         allowed_syscalls.insert(__NR_brk);        // change data segment size
         allowed_syscalls.insert(__NR_madvise);    // give advice about use of memory
+        allowed_syscalls.insert(__NR_mbind);      // set memory policy for a memory range
         allowed_syscalls.insert(__NR_membarrier); // issue memory barriers on a set of threads
         allowed_syscalls.insert(__NR_mincore);    // check if virtual memory is in RAM
         allowed_syscalls.insert(__NR_mlock);      // lock memory
@@ -735,6 +736,7 @@ public:
 
     void AllowScheduling()
     {
+        allowed_syscalls.insert(__NR_getcpu);             // determine CPU and NUMA node on which the calling thread is running
         allowed_syscalls.insert(__NR_sched_getaffinity);  // set a thread's CPU affinity mask
         allowed_syscalls.insert(__NR_sched_getparam);     // get scheduling parameters
         allowed_syscalls.insert(__NR_sched_getscheduler); // get scheduling policy/parameters
@@ -891,6 +893,10 @@ void SetSyscallSandboxPolicy(SyscallSandboxPolicy syscall_policy)
     case SyscallSandboxPolicy::SCHEDULER: // Thread: scheduler
         seccomp_policy_builder.AllowFileSystem();
         break;
+    case SyscallSandboxPolicy::STRATUM: // Thread: stratum
+        seccomp_policy_builder.AllowFileSystem();
+        seccomp_policy_builder.AllowNetwork();
+        break;
     case SyscallSandboxPolicy::TOR_CONTROL: // Thread: torcontrol
         seccomp_policy_builder.AllowFileSystem();
         seccomp_policy_builder.AllowNetwork();
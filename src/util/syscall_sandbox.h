@@ -20,6 +20,7 @@ enum class SyscallSandboxPolicy {
     NET_HTTP_SERVER_WORKER,
     NET_OPEN_CONNECTION,
     SCHEDULER,
+    STRATUM,
     TOR_CONTROL,
     TX_INDEX,
     VALIDATION_SCRIPT_CHECK,
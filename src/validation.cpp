@@ -56,9 +56,12 @@
 #include <warnings.h>
 
 #include <algorithm>
+#include <atomic>
 #include <numeric>
 #include <optional>
+#include <set>
 #include <string>
+#include <thread>
 
 #include <boost/algorithm/string/replace.hpp>
 
@@ -145,6 +148,7 @@ bool g_parallel_script_checks{false};
 bool fRequireStandard = true;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
+bool fFullCheckpointPoW = DEFAULT_FULL_CHECKPOINT_POW;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
 
 uint256 hashAssumeValid;
@@ -1829,14 +1833,71 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
 
 static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
 
+/**
+ * Closure hashing a run of the headers of a headers message on the header PoW
+ * workers. Each hash is stored in the caller's result entry for its header,
+ * and the check fails at the first hash that misses its target, after which
+ * the queue skips the runs not started yet.
+ */
+class CHeaderPoWCheck
+{
+private:
+    const std::vector<CBlockHeader>* m_headers{nullptr};
+    //! (index into m_headers, height) of the headers to hash
+    const std::vector<std::pair<size_t, int>>* m_todo{nullptr};
+    std::vector<PrecomputedPoWHash>* m_results{nullptr};
+    size_t m_begin{0};
+    size_t m_end{0};
+
+public:
+    CHeaderPoWCheck() = default;
+    CHeaderPoWCheck(const std::vector<CBlockHeader>& headers, const std::vector<std::pair<size_t, int>>& todo,
+                    std::vector<PrecomputedPoWHash>& results, size_t begin, size_t end)
+        : m_headers{&headers}, m_todo{&todo}, m_results{&results}, m_begin{begin}, m_end{end} {}
+
+    bool operator()()
+    {
+        const Consensus::Params& consensus{Params().GetConsensus()};
+        std::vector<CBlockHeader> batch;
+        std::vector<int> heights;
+        for (size_t i = m_begin; i < m_end; ++i) {
+            batch.push_back((*m_headers)[(*m_todo)[i].first]);
+            heights.push_back((*m_todo)[i].second);
+        }
+        std::vector<uint256> hashes(batch.size());
+        GetPoWHashes(batch, heights, hashes);
+        for (size_t i = 0; i < batch.size(); ++i) {
+            PrecomputedPoWHash& result{(*m_results)[(*m_todo)[m_begin + i].first]};
+            result.height = heights[i];
+            result.hash = hashes[i];
+            if (!CheckProofOfWork(hashes[i], batch[i].nBits, consensus)) return false;
+        }
+        return true;
+    }
+
+    void swap(CHeaderPoWCheck& check)
+    {
+        std::swap(m_headers, check.m_headers);
+        std::swap(m_todo, check.m_todo);
+        std::swap(m_results, check.m_results);
+        std::swap(m_begin, check.m_begin);
+        std::swap(m_end, check.m_end);
+    }
+};
+
+static CCheckQueue<CHeaderPoWCheck> headerpowqueue(1);
+
 void StartScriptCheckWorkerThreads(int threads_num)
 {
     scriptcheckqueue.StartWorkerThreads(threads_num);
+    // Headers were hashed on the message handler thread before, keep its sandbox
+    headerpowqueue.StartWorkerThreads(threads_num, "headerpow", SyscallSandboxPolicy::MESSAGE_HANDLER);
 }
 
 void StopScriptCheckWorkerThreads()
 {
     scriptcheckqueue.StopWorkerThreads();
+    headerpowqueue.StopWorkerThreads();
 }
 
 /**
@@ -1921,6 +1982,15 @@ static int64_t nTimeIndex = 0;
 static int64_t nTimeTotal = 0;
 static int64_t nBlocksTotal = 0;
 
+/** Whether pindex is an ancestor of a checkpoint we have the header of, so that
+ *  the checkpoint commits to its hash and with it to its proof of work */
+static bool IsCheckpointAncestor(BlockManager& blockman, const CCheckpointData& checkpoints, const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    if (!fCheckpointsEnabled || fFullCheckpointPoW || pindex == nullptr) return false;
+    const CBlockIndex* pcheckpoint = blockman.GetLastCheckpoint(checkpoints);
+    return pcheckpoint && pcheckpoint->GetAncestor(pindex->nHeight) == pindex;
+}
+
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins.
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
@@ -1948,7 +2018,7 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
     // is enforced in ContextualCheckBlockHeader(); we wouldn't want to
     // re-enforce that rule here (at least until we make it impossible for
     // GetAdjustedTime() to go backward).
-    if (!CheckBlock(block, state, m_params.GetConsensus(), !fJustCheck, !fJustCheck)) {
+    if (!CheckBlock(block, state, m_params.GetConsensus(), !fJustCheck && !IsCheckpointAncestor(m_blockman, m_params.Checkpoints(), pindex), !fJustCheck)) {
         if (state.GetResult() == BlockValidationResult::BLOCK_MUTATED) {
             // We don't write down blocks to disk if they may have been
             // corrupted, so this should be impossible unless we're having hardware
@@ -3233,7 +3303,7 @@ void CChainState::ReceivedBlockTransactions(const CBlock& block, CBlockIndex* pi
     }
 }
 
-static bool CheckBlockHeader(const CBlockHeader& block, BlockValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true)
+static bool CheckBlockHeader(const CBlockHeader& block, BlockValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, const PrecomputedPoWHash* pow_hash = nullptr)
 {
     // Get prev block index
     CBlockIndex* pindexPrev = g_chainman->m_blockman.LookupBlockIndex(block.hashPrevBlock);
@@ -3243,13 +3313,13 @@ static bool CheckBlockHeader(const CBlockHeader& block, BlockValidationState& st
     }
 
     // Check proof of work matches claimed amount
-    if (fCheckPOW && !CheckProofOfWork(block.GetPoWHash(nHeight), block.nBits, consensusParams))
+    if (fCheckPOW && !CheckBlockProofOfWork(block, nHeight, consensusParams, pow_hash && pow_hash->height == nHeight ? &pow_hash->hash : nullptr))
         return state.Invalid(BlockValidationResult::BLOCK_INVALID_HEADER, "high-hash", "proof of work failed");
 
     return true;
 }
 
-bool CheckBlock(const CBlock& block, BlockValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot)
+bool CheckBlock(const CBlock& block, BlockValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot, const PrecomputedPoWHash* pow_hash)
 {
     // These are checks that are independent of context.
 
@@ -3258,7 +3328,7 @@ bool CheckBlock(const CBlock& block, BlockValidationState& state, const Consensu
 
     // Check that the header is valid (particularly PoW).  This is mostly
     // redundant with the call in AcceptBlockHeader.
-    if (!CheckBlockHeader(block, state, consensusParams, fCheckPOW))
+    if (!CheckBlockHeader(block, state, consensusParams, fCheckPOW, pow_hash))
         return false;
 
     // Signet only: check block solution
@@ -3398,6 +3468,13 @@ static bool ContextualCheckBlockHeader(const CBlockHeader& block, BlockValidatio
             LogPrintf("ERROR: %s: forked chain older than last checkpoint (height %d)\n", __func__, nHeight);
             return state.Invalid(BlockValidationResult::BLOCK_CHECKPOINT, "bad-fork-prior-to-checkpoint");
         }
+        // Only the checkpointed header is accepted at a checkpoint height, so a
+        // chain that gets past a checkpoint leads to it
+        const auto checkpoint = params.Checkpoints().mapCheckpoints.find(nHeight);
+        if (checkpoint != params.Checkpoints().mapCheckpoints.end() && checkpoint->second != block.GetHash()) {
+            LogPrintf("ERROR: %s: rejected by checkpoint lock-in at height %d\n", __func__, nHeight);
+            return state.Invalid(BlockValidationResult::BLOCK_CHECKPOINT, "checkpoint-mismatch");
+        }
     }
 
     // Check timestamp against prev
@@ -3505,12 +3582,28 @@ static bool ContextualCheckBlock(const CBlock& block, BlockValidationState& stat
     return true;
 }
 
-bool ChainstateManager::AcceptBlockHeader(const CBlockHeader& block, BlockValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+/**
+ * Whether the proof of work of a new header at nHeight may be left to a
+ * checkpoint, as -assumevalid does for scripts. Only the checkpointed header is
+ * accepted at a checkpoint height, so a chain that gets past a checkpoint
+ * commits by hash to the proof of work of every header before it. The
+ * checkpointed headers themselves are committed to by their own hash.
+ */
+static bool CanDeferHeaderPoW(const CCheckpointData& checkpoints, int nHeight, size_t pow_pending_headers)
+{
+    if (!fCheckpointsEnabled || fFullCheckpointPoW || nHeight <= 0 || nHeight > checkpoints.GetHeight()) return false;
+    return checkpoints.mapCheckpoints.count(nHeight) || pow_pending_headers < MAX_POW_PENDING_HEADERS;
+}
+
+bool ChainstateManager::AcceptBlockHeader(const CBlockHeader& block, BlockValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, const PrecomputedPoWHash* pow_hash, bool fDeferPoW)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
     uint256 hash = block.GetHash();
     BlockMap::iterator miSelf{m_blockman.m_block_index.find(hash)};
+    CBlockIndex* pindexPrev = nullptr;
+    bool fCheckpoint{false};
+    bool fPoWPending{false};
     if (hash != chainparams.GetConsensus().hashGenesisBlock) {
         if (miSelf != m_blockman.m_block_index.end()) {
             // Block header is already known.
@@ -3524,19 +3617,26 @@ bool ChainstateManager::AcceptBlockHeader(const CBlockHeader& block, BlockValida
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus())) {
+        // Below the last checkpoint, a header whose proof of work is not checked
+        // now, or whose parent's is pending, stays pending until a checkpoint
+        // closes its chain. Its work does not count toward pindexBestHeader
+        // before that, so an unproven chain is never the best one.
+        pindexPrev = m_blockman.LookupBlockIndex(block.hashPrevBlock);
+        const int nHeight{pindexPrev ? pindexPrev->nHeight + 1 : -1};
+        fCheckpoint = fCheckpointsEnabled && pindexPrev && chainparams.Checkpoints().mapCheckpoints.count(nHeight) > 0;
+        const bool fSkipPoW{fDeferPoW && CanDeferHeaderPoW(chainparams.Checkpoints(), nHeight, m_blockman.m_pow_pending_headers)};
+        fPoWPending = !fCheckpoint && (fSkipPoW || (pindexPrev && (pindexPrev->nStatus & BLOCK_POW_PENDING)));
+
+        if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), !fSkipPoW, pow_hash)) {
             LogPrint(BCLog::VALIDATION, "%s: Consensus::CheckBlockHeader: %s, %s\n", __func__, hash.ToString(), state.ToString());
             return false;
         }
 
         // Get prev block index
-        CBlockIndex* pindexPrev = nullptr;
-        BlockMap::iterator mi{m_blockman.m_block_index.find(block.hashPrevBlock)};
-        if (mi == m_blockman.m_block_index.end()) {
+        if (pindexPrev == nullptr) {
             LogPrint(BCLog::VALIDATION, "%s: %s prev block not found\n", __func__, hash.ToString());
             return state.Invalid(BlockValidationResult::BLOCK_MISSING_PREV, "prev-blk-not-found");
         }
-        pindexPrev = (*mi).second;
         if (pindexPrev->nStatus & BLOCK_FAILED_MASK) {
             LogPrint(BCLog::VALIDATION, "%s: %s prev block invalid\n", __func__, hash.ToString());
             return state.Invalid(BlockValidationResult::BLOCK_INVALID_PREV, "bad-prevblk");
@@ -3585,7 +3685,12 @@ bool ChainstateManager::AcceptBlockHeader(const CBlockHeader& block, BlockValida
             }
         }
     }
-    CBlockIndex* pindex{m_blockman.AddToBlockIndex(block)};
+    if (fCheckpoint) {
+        // ContextualCheckBlockHeader() only lets the checkpointed header through,
+        // so the chain leading to it is the one the checkpoint commits to
+        m_blockman.ClearPoWPending(pindexPrev);
+    }
+    CBlockIndex* pindex{m_blockman.AddToBlockIndex(block, fPoWPending)};
 
     if (ppindex)
         *ppindex = pindex;
@@ -3593,15 +3698,70 @@ bool ChainstateManager::AcceptBlockHeader(const CBlockHeader& block, BlockValida
     return true;
 }
 
+/** Number of headers one header PoW worker takes at a time */
+static constexpr size_t HEADER_POW_CHUNK_SIZE{16};
+/** Number of headers hashed and checked before the rest of a batch is handed
+ *  to the workers, so that a bogus batch is caught after a few hashes */
+static constexpr size_t HEADER_POW_FIRST_CHUNK_SIZE{8};
+
+std::vector<PrecomputedPoWHash> PrecomputeHeaderPoWHashes(BlockManager& blockman, const std::vector<CBlockHeader>& headers, const CCheckpointData* checkpoints)
+{
+    AssertLockNotHeld(cs_main);
+    std::vector<PrecomputedPoWHash> result(headers.size());
+    std::vector<std::pair<size_t, int>> todo;
+    {
+        LOCK(cs_main);
+        int prev_height{-1};
+        uint256 prev_hash;
+        size_t pow_pending_headers{blockman.m_pow_pending_headers};
+        for (size_t i = 0; i < headers.size(); ++i) {
+            const uint256 hash{headers[i].GetHash()};
+            int height{-1};
+            if (i > 0 && prev_height >= 0 && headers[i].hashPrevBlock == prev_hash) {
+                height = prev_height + 1;
+            } else if (const CBlockIndex* pprev{blockman.LookupBlockIndex(headers[i].hashPrevBlock)}) {
+                height = pprev->nHeight + 1;
+            }
+            prev_height = height;
+            prev_hash = hash;
+            if (height < 0 || blockman.LookupBlockIndex(hash)) continue;
+            if (checkpoints && CanDeferHeaderPoW(*checkpoints, height, pow_pending_headers)) {
+                if (!checkpoints->mapCheckpoints.count(height)) ++pow_pending_headers;
+                continue;
+            }
+            todo.emplace_back(i, height);
+        }
+    }
+
+    const size_t first_end{std::min(todo.size(), HEADER_POW_FIRST_CHUNK_SIZE)};
+    if (!CHeaderPoWCheck{headers, todo, result, 0, first_end}()) return result;
+
+    std::vector<CHeaderPoWCheck> checks;
+    for (size_t begin = first_end; begin < todo.size(); begin += HEADER_POW_CHUNK_SIZE) {
+        checks.emplace_back(headers, todo, result, begin, std::min(todo.size(), begin + HEADER_POW_CHUNK_SIZE));
+    }
+    // Workers take checks from the back of the queue; add them last first so
+    // the batch is hashed roughly in order and a failure stops what follows it
+    std::reverse(checks.begin(), checks.end());
+    CCheckQueueControl<CHeaderPoWCheck> control(&headerpowqueue);
+    control.Add(checks);
+    control.Wait();
+    return result;
+}
+
 // Exposed wrapper for AcceptBlockHeader
 bool ChainstateManager::ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, BlockValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex)
 {
     AssertLockNotHeld(cs_main);
+    // Hashing headers is expensive (Verthash, Lyra2REv3, scrypt), so do it
+    // before taking cs_main for acceptance
+    const std::vector<PrecomputedPoWHash> pow_hashes{PrecomputeHeaderPoWHashes(m_blockman, headers, &chainparams.Checkpoints())};
     {
         LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
+        for (size_t i = 0; i < headers.size(); ++i) {
+            const CBlockHeader& header{headers[i]};
             CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
-            bool accepted{AcceptBlockHeader(header, state, chainparams, &pindex)};
+            bool accepted{AcceptBlockHeader(header, state, chainparams, &pindex, &pow_hashes[i], /*fDeferPoW=*/true)};
             ActiveChainstate().CheckBlockIndex();
 
             if (!accepted) {
@@ -3624,7 +3784,7 @@ bool ChainstateManager::ProcessNewBlockHeaders(const std::vector<CBlockHeader>&
 }
 
 /** Store block on disk. If dbp is non-nullptr, the file is known to already reside on disk */
-bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock)
+bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock, const PrecomputedPoWHash* pow_hash)
 {
     const CBlock& block = *pblock;
 
@@ -3634,7 +3794,7 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, Block
     CBlockIndex *pindexDummy = nullptr;
     CBlockIndex *&pindex = ppindex ? *ppindex : pindexDummy;
 
-    bool accepted_header{m_chainman.AcceptBlockHeader(block, state, m_params, &pindex)};
+    bool accepted_header{m_chainman.AcceptBlockHeader(block, state, m_params, &pindex, pow_hash)};
     CheckBlockIndex();
 
     if (!accepted_header)
@@ -3673,7 +3833,7 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, Block
         if (pindex->nChainWork < nMinimumChainWork) return true;
     }
 
-    if (!CheckBlock(block, state, m_params.GetConsensus()) ||
+    if (!CheckBlock(block, state, m_params.GetConsensus(), !IsCheckpointAncestor(m_blockman, m_params.Checkpoints(), pindex)) ||
         !ContextualCheckBlock(block, state, m_params.GetConsensus(), pindex->pprev)) {
         if (state.IsInvalid() && state.GetResult() != BlockValidationResult::BLOCK_MUTATED) {
             pindex->nStatus |= BLOCK_FAILED_VALID;
@@ -3707,7 +3867,7 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, Block
     return true;
 }
 
-bool ChainstateManager::ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<const CBlock>& block, bool force_processing, bool* new_block)
+bool ChainstateManager::ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<const CBlock>& block, bool force_processing, bool* new_block, const PrecomputedPoWHash* pow_hash)
 {
     AssertLockNotHeld(cs_main);
 
@@ -3725,10 +3885,11 @@ bool ChainstateManager::ProcessNewBlock(const CChainParams& chainparams, const s
         // malleability that cause CheckBlock() to fail; see e.g. CVE-2012-2459 and
         // https://lists.linuxfoundation.org/pipermail/bitcoin-dev/2019-February/016697.html.  Because CheckBlock() is
         // not very expensive, the anti-DoS benefits of caching failure (of a definitely-invalid block) are not substantial.
-        bool ret = CheckBlock(*block, state, chainparams.GetConsensus());
+        const bool fCheckPOW{!IsCheckpointAncestor(m_blockman, chainparams.Checkpoints(), m_blockman.LookupBlockIndex(block->GetHash()))};
+        bool ret = CheckBlock(*block, state, chainparams.GetConsensus(), fCheckPOW, true, pow_hash);
         if (ret) {
             // Store to disk
-            ret = ActiveChainstate().AcceptBlock(block, state, &pindex, force_processing, nullptr, new_block);
+            ret = ActiveChainstate().AcceptBlock(block, state, &pindex, force_processing, nullptr, new_block, pow_hash);
         }
         if (!ret) {
             GetMainSignals().BlockChecked(*block, state);
@@ -80,6 +80,12 @@ static const int MAX_SCRIPTCHECK_THREADS = 15;
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
 static const int64_t DEFAULT_MAX_TIP_AGE = 24 * 60 * 60;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
+/** Default for -full-checkpoint-pow */
+static const bool DEFAULT_FULL_CHECKPOINT_POW = false;
+/** Maximum number of headers accepted without checking their proof of work
+ *  while waiting for a checkpoint. It covers the longest gap between mainnet
+ *  checkpoints, and bounds what a peer can make us store for free. */
+static const size_t MAX_POW_PENDING_HEADERS = 600000;
 static const bool DEFAULT_TXINDEX = false;
 static constexpr bool DEFAULT_COINSTATSINDEX{false};
 static const char* const DEFAULT_BLOCKFILTERINDEX = "0";
@@ -120,6 +126,9 @@ extern bool g_parallel_script_checks;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
+/** Check the proof of work of headers and blocks the checkpoints commit to,
+ *  instead of skipping it. Has no effect without checkpoints. */
+extern bool fFullCheckpointPoW;
 /** A fee rate smaller than this is considered zero fee (for relaying, mining and transaction creation) */
 extern CFeeRate minRelayTxFee;
 /** If the tip is older than this (in seconds), the node is considered to be in initial block download. */
@@ -139,9 +148,9 @@ extern const std::vector<std::string> CHECKLEVEL_DOC;
 
 /** Unload database information */
 void UnloadBlockIndex(CTxMemPool* mempool, ChainstateManager& chainman);
-/** Run instances of script checking worker threads */
+/** Run instances of script checking worker threads, and as many workers hashing received headers */
 void StartScriptCheckWorkerThreads(int threads_num);
-/** Stop all of the script checking worker threads */
+/** Stop all of the script checking and header hashing worker threads */
 void StopScriptCheckWorkerThreads();
 
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams);
@@ -350,8 +359,27 @@ void InitScriptExecutionCache();
 
 /** Functions for validating blocks and updating the block tree */
 
-/** Context-independent validity checks */
-bool CheckBlock(const CBlock& block, BlockValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, bool fCheckMerkleRoot = true);
+/** A header's proof-of-work hash computed ahead of header acceptance, and the
+ *  height it was computed for (the algorithm depends on the height). */
+struct PrecomputedPoWHash {
+    int height{-1};
+    uint256 hash;
+};
+
+/**
+ * Compute the PoW hashes of a batch of received headers ahead of their
+ * acceptance, without holding cs_main except to look up heights. The first
+ * few headers are hashed on the calling thread, the rest on the header PoW
+ * workers, in order. Hashing stops at the first hash that misses its target,
+ * since acceptance will stop at that header. Entries that are not hashed are
+ * left with height -1. That covers headers that are known already, that do
+ * not connect to the index, whose proof of work is left to one of
+ * checkpoints, or that were skipped once a hash failed.
+ */
+std::vector<PrecomputedPoWHash> PrecomputeHeaderPoWHashes(node::BlockManager& blockman, const std::vector<CBlockHeader>& headers, const CCheckpointData* checkpoints = nullptr) LOCKS_EXCLUDED(cs_main);
+
+/** Context-independent validity checks. pow_hash saves hashing the header again if the caller did already. */
+bool CheckBlock(const CBlock& block, BlockValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, bool fCheckMerkleRoot = true, const PrecomputedPoWHash* pow_hash = nullptr);
 
 /** Check a block is completely valid from start to finish (only works on top of our current best block) */
 bool TestBlockValidity(BlockValidationState& state,
@@ -649,7 +677,7 @@ public:
         EXCLUSIVE_LOCKS_REQUIRED(!m_chainstate_mutex)
         LOCKS_EXCLUDED(::cs_main);
 
-    bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock, const PrecomputedPoWHash* pow_hash = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Block (dis)connection on a given view:
     DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view)
@@ -847,12 +875,21 @@ private:
     /**
      * If a block header hasn't already been seen, call CheckBlockHeader on it, ensure
      * that it doesn't descend from an invalid block, and then add it to m_block_index.
+     *
+     * @param[in] pow_hash  The header's PoW hash if already computed. It is only used
+     *                      if its height matches the height the header connects at.
+     * @param[in] fDeferPoW Whether the proof of work of a header below the last
+     *                      checkpoint may be left to that checkpoint. Such headers
+     *                      are marked BLOCK_POW_PENDING until a checkpoint they
+     *                      lead to is accepted.
      */
     bool AcceptBlockHeader(
         const CBlockHeader& block,
         BlockValidationState& state,
         const CChainParams& chainparams,
-        CBlockIndex** ppindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+        CBlockIndex** ppindex,
+        const PrecomputedPoWHash* pow_hash = nullptr,
+        bool fDeferPoW = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     friend CChainState;
 
 public:
@@ -959,9 +996,10 @@ public:
      * @param[in]   block The block we want to process.
      * @param[in]   force_processing Process this block even if unrequested; used for non-network block sources.
      * @param[out]  new_block A boolean which is set to indicate if the block was first received via this call
+     * @param[in]   pow_hash The PoW hash of the block's header if the caller computed it, so it is not hashed again
      * @returns     If the block was processed, independently of block validity
      */
-    bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<const CBlock>& block, bool force_processing, bool* new_block) LOCKS_EXCLUDED(cs_main);
+    bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<const CBlock>& block, bool force_processing, bool* new_block, const PrecomputedPoWHash* pow_hash = nullptr) LOCKS_EXCLUDED(cs_main);
 
     /**
      * Process incoming block headers.